@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include <glibmm.h>
+#include <gstreamermm.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capture_engine.hpp"
+#include "corpus.hpp"
+#include "thumbnailer.hpp"
+
+namespace {
+
+/** Asks for evenly spread positions and only counts the frames, so
+    that the measurement is about getting the frames out of the
+    pipeline, not about compositing them */
+class CountingThumbnailer : public Thumbnailer
+{
+private:
+  int m_num;
+  int m_count;
+
+public:
+  CountingThumbnailer(int num) : m_num(num), m_count(0) {}
+
+  std::vector<gint64> get_thumbnail_pos(gint64 duration) override
+  {
+    std::vector<gint64> lst;
+    for(int i = 0; i < m_num; ++i)
+    {
+      lst.push_back(duration / m_num / 2 + duration / m_num * i);
+    }
+    return lst;
+  }
+
+  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> /*img*/, gint64 /*pos*/, int /*index*/) override
+  {
+    m_count += 1;
+  }
+
+  void save(const std::string& /*filename*/, ImageWriter const& /*writer*/) override {}
+
+  int get_count() const { return m_count; }
+};
+
+void BM_Capture(benchmark::State& state, CaptureEngineType engine, bool accurate)
+{
+  std::string const& filename = get_test_video();
+  if (filename.empty())
+  {
+    state.SkipWithError("no encoder available to create the test video");
+    return;
+  }
+
+  int const num = static_cast<int>(state.range(0));
+
+  Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::create();
+  g_main_context_push_thread_default(context->gobj());
+  Glib::RefPtr<Glib::MainLoop> mainloop = Glib::MainLoop::create(context, false);
+
+  VideoProcessorOptions opts;
+  opts.width = 160;
+  opts.sampling = SamplingMode::kSeek;
+
+  for(auto _ : state)
+  {
+    CountingThumbnailer thumbnailer(num);
+    std::unique_ptr<CaptureEngine> processor = create_capture_engine(engine, context, thumbnailer);
+    processor->set_options(opts);
+    processor->set_accurate(accurate);
+    processor->signal_finished().connect([&mainloop]{ mainloop->quit(); });
+    processor->open(filename);
+    mainloop->run();
+
+    if (processor->has_error() || thumbnailer.get_count() != num)
+    {
+      state.SkipWithError(("capture failed: " + processor->get_error()).c_str());
+      break;
+    }
+  }
+
+  // seconds per thumbnail
+  state.counters["per_thumbnail"] = benchmark::Counter(static_cast<double>(num),
+                                                       benchmark::Counter::kIsIterationInvariantRate |
+                                                       benchmark::Counter::kInvert);
+
+  g_main_context_pop_thread_default(context->gobj());
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Capture, handoff, CaptureEngineType::kHandoff, false)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Capture, appsink, CaptureEngineType::kAppSink, false)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Capture, handoff_accurate, CaptureEngineType::kHandoff, true)->Arg(16)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Capture, appsink_accurate, CaptureEngineType::kAppSink, true)->Arg(16)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+  Gst::init(argc, argv);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
+
+/* EOF */
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+
+# VidThumb - Video Thumbnailer
+# Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Compares two Google Benchmark JSON results, e.g. of suite_benchmark
+from the last release and from the current tree, and exits with 1 when
+a benchmark got slower than the threshold allows.
+
+    check_regression.py BASELINE.json CURRENT.json
+    check_regression.py --run ./suite_benchmark --out CURRENT.json BASELINE.json
+"""
+
+import argparse
+import json
+import re
+import subprocess
+import sys
+
+# time_unit to seconds
+TIME_UNITS = {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}
+
+# counters that are checked besides real_time, True when higher is better
+COUNTERS = {
+    "thumbnails_per_second": True,
+    "items_per_second": True,
+    "bytes_per_second": True,
+    "seek_p90_ms": False,
+    "seek_p99_ms": False,
+    "peak_rss_kb": False,
+}
+
+
+def load(filename):
+    """Returns {name: benchmark} of a result file, the median when the
+    benchmarks were repeated, failed benchmarks are kept with their
+    error_occurred flag"""
+    with open(filename) as fin:
+        data = json.load(fin)
+
+    results = {}
+    medians = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[bench["run_name"]] = bench
+        else:
+            results.setdefault(bench.get("run_name", bench["name"]), bench)
+    results.update(medians)
+    return results
+
+
+def compare(baseline, current, threshold, name_filter=None):
+    """Prints a line per metric, returns the number of regressions. A
+    benchmark that fails or is gone counts as a regression, only those
+    matching name_filter are expected when it is given."""
+    regressions = 0
+    for name in sorted(baseline):
+        old = baseline[name]
+        if old.get("error_occurred"):
+            print("{:<11} {}: failed in the baseline".format("skipped:", name))
+            continue
+
+        if name not in current:
+            if name_filter is None or re.search(name_filter, name):
+                print("REGRESSION: {}: missing".format(name))
+                regressions += 1
+            continue
+
+        new = current[name]
+        if new.get("error_occurred"):
+            print("REGRESSION: {}: failed: {}".format(name, new.get("error_message", "")))
+            regressions += 1
+            continue
+
+        metrics = [("real_time",
+                    old["real_time"] * TIME_UNITS[old.get("time_unit", "ns")],
+                    new["real_time"] * TIME_UNITS[new.get("time_unit", "ns")],
+                    False)]
+        for counter, higher_is_better in COUNTERS.items():
+            if counter in old and counter in new:
+                metrics.append((counter, old[counter], new[counter], higher_is_better))
+
+        for metric, old_value, new_value, higher_is_better in metrics:
+            if old_value <= 0:
+                continue
+
+            change = (new_value - old_value) / old_value
+            worse = -change if higher_is_better else change
+            status = "REGRESSION" if worse > threshold else "ok"
+            if worse > threshold:
+                regressions += 1
+            print("{:<11} {} {}: {:.6g} -> {:.6g} ({:+.1%})".format(
+                status + ":", name, metric, old_value, new_value, change))
+
+    for name in sorted(set(current) - set(baseline)):
+        print("new:        {}".format(name))
+
+    return regressions
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Check Google Benchmark results for regressions")
+    parser.add_argument("baseline", help="JSON result to compare against")
+    parser.add_argument("current", nargs="?", help="JSON result to check, see --run")
+    parser.add_argument("--run", metavar="BENCHMARK",
+                        help="Run BENCHMARK and check its result instead of reading CURRENT")
+    parser.add_argument("--out", metavar="FILE", default="benchmark_result.json",
+                        help="Where --run writes the result, default benchmark_result.json")
+    parser.add_argument("--filter", metavar="REGEX",
+                        help="Only run the benchmarks matching REGEX")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="Allowed relative slowdown, default 0.10")
+    args = parser.parse_args(argv[1:])
+
+    if args.run:
+        cmd = [args.run,
+               "--benchmark_out=" + args.out,
+               "--benchmark_out_format=json",
+               "--benchmark_repetitions=3",
+               "--benchmark_report_aggregates_only=true"]
+        if args.filter:
+            cmd.append("--benchmark_filter=" + args.filter)
+        subprocess.run(cmd, check=True)
+        current_file = args.out
+    elif args.current:
+        current_file = args.current
+    else:
+        parser.error("either CURRENT or --run is required")
+
+    # a filtered run can't be expected to contain the other benchmarks
+    name_filter = args.filter if args.run else None
+    regressions = compare(load(args.baseline), load(current_file), args.threshold, name_filter)
+    if regressions:
+        print("{} regression(s) beyond {:.0%}".format(regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
+
+
+# EOF #
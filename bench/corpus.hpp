@@ -0,0 +1,163 @@
+#ifndef HEADER_BENCH_CORPUS_HPP
+#define HEADER_BENCH_CORPUS_HPP
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+/** A generated clip of the benchmark corpus */
+struct CorpusClip
+{
+  /** e.g. "h264-640x360-gop50-60s", used in the benchmark names */
+  std::string name;
+  std::string filename;
+  int width;
+  int height;
+  int gop;
+  int seconds;
+};
+
+/** Returns the directory the corpus is kept in, $VIDTHUMB_BENCH_CORPUS
+    or a directory in the temp directory, clips are only encoded once */
+inline std::filesystem::path get_corpus_directory()
+{
+  char const* dir = std::getenv("VIDTHUMB_BENCH_CORPUS");
+  std::filesystem::path const path = dir ? std::filesystem::path(dir) :
+    std::filesystem::temp_directory_path() / "vidthumb-bench-corpus";
+  std::filesystem::create_directories(path);
+  return path;
+}
+
+/** Encodes a 25fps videotestsrc clip with \a encoder, a gst-launch
+    fragment, into a Matroska file at \a location. Returns false when
+    an element is missing or encoding fails. */
+inline bool encode_clip(std::string const& location, std::string const& encoder,
+                        int width, int height, int seconds)
+{
+  if (std::filesystem::exists(location))
+  {
+    return true;
+  }
+
+  std::string const desc =
+    "videotestsrc num-buffers=" + std::to_string(seconds * 25) + " pattern=ball "
+    "  ! video/x-raw,width=" + std::to_string(width) + ",height=" + std::to_string(height) + ",framerate=25/1 "
+    "  ! videoconvert ! " + encoder + " ! matroskamux "
+    "  ! filesink location=" + location + ".tmp";
+
+  // without FATAL_ERRORS a missing element still gives a pipeline
+  GError* error = nullptr;
+  GstElement* pipeline = gst_parse_launch_full(desc.c_str(), nullptr, GST_PARSE_FLAG_FATAL_ERRORS, &error);
+  g_clear_error(&error);
+  if (!pipeline)
+  {
+    return false;
+  }
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                               static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+  bool const ok = msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS;
+  if (msg)
+  {
+    gst_message_unref(msg);
+  }
+  gst_object_unref(bus);
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+
+  if (!ok)
+  {
+    std::filesystem::remove(location + ".tmp");
+    return false;
+  }
+
+  std::filesystem::rename(location + ".tmp", location);
+  return true;
+}
+
+/** Encodes the corpus: several codecs, resolutions, GOP sizes and
+    durations. Clips whose encoder isn't installed are left out. */
+inline std::vector<CorpusClip> const& get_corpus()
+{
+  static std::vector<CorpusClip> const corpus = [] {
+    struct Spec
+    {
+      char const* codec;
+      char const* encoder;
+      int width;
+      int height;
+      int gop;
+      int seconds;
+    };
+
+    // {gop} is replaced by the keyframe interval
+    Spec const specs[] = {
+      { "h264", "x264enc speed-preset=ultrafast key-int-max={gop}", 640, 360, 50, 60 },
+      { "h264", "x264enc speed-preset=ultrafast key-int-max={gop}", 1280, 720, 12, 30 },
+      { "h264", "x264enc speed-preset=ultrafast key-int-max={gop}", 1920, 1080, 250, 20 },
+      { "h264", "x264enc speed-preset=ultrafast key-int-max={gop}", 320, 180, 250, 600 },
+      { "h265", "x265enc speed-preset=ultrafast key-int-max={gop} ! h265parse", 1280, 720, 50, 20 },
+      { "vp8", "vp8enc deadline=1 keyframe-max-dist={gop}", 640, 360, 120, 60 },
+      { "vp9", "vp9enc deadline=1 cpu-used=8 keyframe-max-dist={gop}", 1280, 720, 250, 20 },
+      { "mpeg4", "avenc_mpeg4 gop-size={gop}", 640, 360, 12, 10 },
+    };
+
+    std::filesystem::path const directory = get_corpus_directory();
+
+    std::vector<CorpusClip> clips;
+    for(auto const& spec : specs)
+    {
+      std::string encoder = spec.encoder;
+      encoder.replace(encoder.find("{gop}"), 5, std::to_string(spec.gop));
+
+      std::string const name = std::string(spec.codec) + "-" +
+        std::to_string(spec.width) + "x" + std::to_string(spec.height) +
+        "-gop" + std::to_string(spec.gop) + "-" + std::to_string(spec.seconds) + "s";
+      std::string const location = (directory / (name + ".mkv")).string();
+
+      if (encode_clip(location, encoder, spec.width, spec.height, spec.seconds))
+      {
+        clips.push_back(CorpusClip{name, location, spec.width, spec.height, spec.gop, spec.seconds});
+      }
+    }
+    return clips;
+  }();
+
+  return corpus;
+}
+
+/** Encodes a 60 second 640x360 test clip with the first encoder that
+    is available, returns an empty string when there is none */
+inline std::string const& get_test_video()
+{
+  static std::string const filename = []() -> std::string {
+    std::string const location = (get_corpus_directory() / "test-640x360-gop50-60s.mkv").string();
+
+    char const* encoders[] = {
+      "x264enc key-int-max=50 speed-preset=ultrafast",
+      "avenc_mpeg4 gop-size=50",
+      "vp8enc keyframe-max-dist=50 deadline=1",
+    };
+
+    for(char const* encoder : encoders)
+    {
+      if (encode_clip(location, encoder, 640, 360, 60))
+      {
+        return location;
+      }
+    }
+
+    return {};
+  }();
+
+  return filename;
+}
+
+#endif
+
+/* EOF */
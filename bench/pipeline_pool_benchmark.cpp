@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <glibmm.h>
+#include <gstreamermm.h>
+#include <string>
+
+#include "corpus.hpp"
+#include "pipeline_pool.hpp"
+
+namespace {
+
+/** Time from asking for a pipeline until it has prerolled the first
+    frame, which is what every file pays before the first seek */
+void BM_FirstPreroll(benchmark::State& state, PipelineSink sink, bool recycled)
+{
+  std::string const& filename = get_test_video();
+  if (filename.empty())
+  {
+    state.SkipWithError("no encoder available to create the test video");
+    return;
+  }
+
+  std::string const uri = Glib::filename_to_uri(filename);
+
+  VideoProcessorOptions opts;
+  opts.width = 160;
+
+  PipelinePool pool(1);
+  PipelinePool* const pool_ptr = recycled ? &pool : nullptr;
+
+  for(auto _ : state)
+  {
+    auto const start = std::chrono::steady_clock::now();
+
+    GstElement* pipeline = PipelinePool::acquire(pool_ptr, opts, sink);
+    GstElement* source = gst_bin_get_by_name(GST_BIN(pipeline), "mysource");
+    g_object_set(source, "uri", uri.c_str(), nullptr);
+    gst_object_unref(source);
+
+    gst_element_set_state(pipeline, GST_STATE_PAUSED);
+    GstBus* bus = gst_element_get_bus(pipeline);
+    GstMessage* msg = gst_bus_timed_pop_filtered(bus, 10 * GST_SECOND,
+                                                 static_cast<GstMessageType>(GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_ERROR));
+    bool const ok = msg && GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ASYNC_DONE;
+    if (msg)
+    {
+      gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+
+    auto const end = std::chrono::steady_clock::now();
+    state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+
+    // shutting down isn't part of the measurement, with the pool it is
+    // mostly the PAUSED to READY transition
+    PipelinePool::release(pool_ptr, pipeline, ok);
+
+    if (!ok)
+    {
+      state.SkipWithError("pipeline failed to preroll");
+      break;
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_FirstPreroll, handoff_fresh, PipelineSink::kFakeSink, false)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_FirstPreroll, handoff_recycled, PipelineSink::kFakeSink, true)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_FirstPreroll, appsink_fresh, PipelineSink::kAppSink, false)->UseManualTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_FirstPreroll, appsink_recycled, PipelineSink::kAppSink, true)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+  Gst::init(argc, argv);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
+
+/* EOF */
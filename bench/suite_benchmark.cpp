@@ -0,0 +1,297 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <glibmm.h>
+#include <gstreamermm.h>
+#include <gst/video/video.h>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "capture_engine.hpp"
+#include "capture_stats.hpp"
+#include "corpus.hpp"
+#include "directory_thumbnailer.hpp"
+#include "fourd_thumbnailer.hpp"
+#include "grid_thumbnailer.hpp"
+#include "image_writer.hpp"
+#include "video_frame.hpp"
+
+namespace {
+
+using Clock = CaptureStats::Clock;
+
+double to_msec(Clock::duration duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/** Returns the \a p quantile of \a values, which get sorted */
+double percentile(std::vector<double>& values, double p)
+{
+  if (values.empty())
+  {
+    return 0.0;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t const idx = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())));
+  return values[idx];
+}
+
+std::filesystem::path get_output_directory()
+{
+  std::filesystem::path const path = std::filesystem::temp_directory_path() / "vidthumb-bench-output";
+  std::filesystem::create_directories(path);
+  return path;
+}
+
+struct Mode
+{
+  char const* name;
+  char const* output;
+  std::function<std::unique_ptr<Thumbnailer>()> create;
+};
+
+/** The thumbnailer modes with the defaults of the command line */
+std::vector<Mode> const& get_modes()
+{
+  static std::vector<Mode> const modes = {
+    { "grid", "grid.png", []{ return std::make_unique<GridThumbnailer>(4, 4); } },
+    { "fourd", "fourd.png", []{ return std::make_unique<FourdThumbnailer>(100); } },
+    { "directory", "directory", []{ return std::make_unique<DirectoryThumbnailer>(16); } },
+  };
+  return modes;
+}
+
+/** Whole files, from opening the pipeline to the saved output, with
+    the seek latency distribution and the per frame cost of conversion
+    and compositing taken from CaptureStats */
+void BM_EndToEnd(benchmark::State& state, Mode const& mode, CorpusClip const& clip)
+{
+  Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::create();
+  g_main_context_push_thread_default(context->gobj());
+  Glib::RefPtr<Glib::MainLoop> mainloop = Glib::MainLoop::create(context, false);
+
+  VideoProcessorOptions opts;
+  opts.width = 320;
+
+  ImageWriter const writer;
+  std::string const output = (get_output_directory() / mode.output).string();
+
+  int frames = 0;
+  std::vector<double> seeks;
+  Clock::duration convert{};
+  Clock::duration receive_frame{};
+  Clock::duration save{};
+
+  bool const peak_rss_valid = reset_peak_rss();
+
+  for(auto _ : state)
+  {
+    std::unique_ptr<Thumbnailer> thumbnailer = mode.create();
+    auto stats = std::make_shared<CaptureStats>();
+
+    thumbnailer->prepare(output, writer);
+
+    std::unique_ptr<CaptureEngine> processor = create_capture_engine(CaptureEngineType::kHandoff, context, *thumbnailer);
+    processor->set_options(opts);
+    processor->set_stats(stats);
+    processor->signal_finished().connect([&mainloop]{ mainloop->quit(); });
+    processor->open(clip.filename);
+    mainloop->run();
+
+    if (processor->has_error())
+    {
+      state.SkipWithError(("capture failed: " + processor->get_error()).c_str());
+      break;
+    }
+    processor.reset();
+
+    auto const save_start = Clock::now();
+    thumbnailer->save(output, writer);
+    save += Clock::now() - save_start;
+
+    frames += stats->get_frames_delivered();
+    for(auto const& seek : stats->get_seeks())
+    {
+      seeks.push_back(to_msec(seek));
+    }
+    convert += stats->get_convert();
+    receive_frame += stats->get_receive_frame();
+  }
+
+  double const per_frame = frames ? 1.0 / frames : 0.0;
+  double const iterations = static_cast<double>(std::max<benchmark::IterationCount>(1, state.iterations()));
+
+  state.counters["thumbnails_per_second"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+  state.counters["seek_p50_ms"] = percentile(seeks, 0.50);
+  state.counters["seek_p90_ms"] = percentile(seeks, 0.90);
+  state.counters["seek_p99_ms"] = percentile(seeks, 0.99);
+  state.counters["seek_max_ms"] = seeks.empty() ? 0.0 : seeks.back();
+  state.counters["convert_ms_per_frame"] = to_msec(convert) * per_frame;
+  state.counters["composite_ms_per_frame"] = to_msec(receive_frame) * per_frame;
+  state.counters["save_ms"] = to_msec(save) / iterations;
+  long const peak_rss = peak_rss_valid ? get_peak_rss() : -1;
+  if (peak_rss >= 0)
+  {
+    state.counters["peak_rss_kb"] = static_cast<double>(peak_rss);
+  }
+
+  g_main_context_pop_thread_default(context->gobj());
+}
+
+/** Turning a decoded buffer into a Cairo surface, what buffer2cairo
+    used to do, for the formats the pipeline hands out */
+void BM_Convert(benchmark::State& state, char const* format, int width, int height, std::optional<int> target_width)
+{
+  GstVideoInfo info;
+  gst_video_info_set_format(&info, gst_video_format_from_string(format), width, height);
+  Glib::RefPtr<Gst::Caps> caps = Glib::wrap(gst_video_info_to_caps(&info), false);
+
+  GstBuffer* raw_buffer = gst_buffer_new_allocate(nullptr, GST_VIDEO_INFO_SIZE(&info), nullptr);
+  {
+    GstMapInfo map;
+    gst_buffer_map(raw_buffer, &map, GST_MAP_WRITE);
+    // not a flat color, which could make some paths look cheaper than
+    // they are with real frames
+    for(gsize i = 0; i < map.size; ++i)
+    {
+      map.data[i] = static_cast<guint8>(i * 7 + i / 4096);
+    }
+    gst_buffer_unmap(raw_buffer, &map);
+  }
+  Glib::RefPtr<Gst::Buffer> buffer = Glib::wrap(raw_buffer, false);
+
+  for(auto _ : state)
+  {
+    if (target_width)
+    {
+      VideoFrame frame(buffer, caps, target_width, std::nullopt);
+      benchmark::DoNotOptimize(frame.get_surface()->get_data());
+    }
+    else
+    {
+      VideoFrame frame(buffer, caps);
+      benchmark::DoNotOptimize(frame.get_surface()->get_data());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(GST_VIDEO_INFO_SIZE(&info)));
+}
+
+Cairo::RefPtr<Cairo::ImageSurface> create_test_image(int width, int height)
+{
+  auto img = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, width, height);
+  auto cr = Cairo::Context::create(img);
+  auto gradient = Cairo::LinearGradient::create(0, 0, width, height);
+  gradient->add_color_stop_rgb(0.0, 0.1, 0.2, 0.8);
+  gradient->add_color_stop_rgb(1.0, 0.9, 0.6, 0.1);
+  cr->set_source(gradient);
+  cr->paint();
+  for(int i = 0; i < 64; ++i)
+  {
+    cr->set_source_rgb((i % 3) / 2.0, (i % 5) / 4.0, (i % 7) / 6.0);
+    cr->arc((i * 37) % width, (i * 53) % height, 5 + i % 20, 0, 2 * G_PI);
+    cr->fill();
+  }
+  img->flush();
+  return img;
+}
+
+/** Placing frames into the grid, as they are and when they have to be
+    scaled to the cell */
+void BM_Composite(benchmark::State& state, int frame_width, int frame_height)
+{
+  GridThumbnailer grid(4, 4);
+  grid.set_frame_size(320, 180);
+  auto const img = create_test_image(frame_width, frame_height);
+
+  int index = 0;
+  for(auto _ : state)
+  {
+    grid.receive_frame(img, index * GST_SECOND, index % 16);
+    index += 1;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** Encoding a 4x4 sheet of 320x180 cells */
+void BM_Encode(benchmark::State& state, ImageFormat format)
+{
+  ImageWriterOptions writer_opts;
+  writer_opts.format = format;
+  ImageWriter const writer(writer_opts);
+
+  auto const img = create_test_image(1280, 720);
+  std::string const filename = (get_output_directory() / ("encode." + get_extension(format))).string();
+
+  for(auto _ : state)
+  {
+    try
+    {
+      writer.write(img, filename);
+    }
+    catch(std::exception const& err)
+    {
+      state.SkipWithError(err.what());
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Convert, bgrx_passthrough, "BGRx", 320, 180, std::nullopt);
+BENCHMARK_CAPTURE(BM_Convert, bgrx_1080p_to_320, "BGRx", 1920, 1080, 320);
+BENCHMARK_CAPTURE(BM_Convert, i420_1080p_to_320, "I420", 1920, 1080, 320);
+BENCHMARK_CAPTURE(BM_Convert, nv12_1080p_to_320, "NV12", 1920, 1080, 320);
+BENCHMARK_CAPTURE(BM_Convert, i420_2160p_to_320, "I420", 3840, 2160, 320);
+
+BENCHMARK_CAPTURE(BM_Composite, exact, 320, 180);
+BENCHMARK_CAPTURE(BM_Composite, scaled, 640, 360);
+BENCHMARK_CAPTURE(BM_Composite, letterboxed, 240, 180);
+
+BENCHMARK_CAPTURE(BM_Encode, png, ImageFormat::kPNG)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Encode, jpeg, ImageFormat::kJPEG)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Encode, webp, ImageFormat::kWebP)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Encode, qoi, ImageFormat::kQOI)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+  Gst::init(argc, argv);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+
+  // the corpus depends on the installed encoders, so the end-to-end
+  // benchmarks are registered at runtime, one per mode and clip
+  for(auto const& mode : get_modes())
+  {
+    for(auto const& clip : get_corpus())
+    {
+      benchmark::RegisterBenchmark((std::string("BM_EndToEnd/") + mode.name + "/" + clip.name).c_str(),
+                                   [&mode, &clip](benchmark::State& state) { BM_EndToEnd(state, mode, clip); })
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    }
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
+
+/* EOF */
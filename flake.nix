@@ -39,7 +39,11 @@
             buildInputs = with pkgs; [
               cairomm
               fmt
+              gst_all_1.gst-plugins-base
               gst_all_1.gstreamermm
+              libjpeg
+              libpng
+              libwebp
             ] ++ [
               tinycmmc.packages.${system}.default
               logmich.packages.${system}.default
@@ -0,0 +1,627 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "appsink_processor.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+#include <stdexcept>
+
+#include <gst/video/video.h>
+
+#include "capture_stats.hpp"
+#include "frame_consumer.hpp"
+#include "keyframe_index.hpp"
+#include "pipeline_pool.hpp"
+#include "preroll_guard.hpp"
+#include "thumbnailer.hpp"
+#include "tracer.hpp"
+#include "video_frame.hpp"
+
+namespace {
+
+// the longest a pull blocks before checking for errors, timeout and
+// cancellation
+constexpr GstClockTime kPollInterval = 100 * GST_MSECOND;
+
+// same as for VideoProcessor, a few frames absorb a slow thumbnailer
+constexpr size_t kFrameQueueSize = 4;
+
+} // namespace
+
+AppSinkProcessor::AppSinkProcessor(Glib::RefPtr<Glib::MainContext> context,
+                                   Thumbnailer& thumbnailer) :
+  m_context(context),
+  m_thumbnailer(thumbnailer),
+  m_opts(),
+  m_accurate(false),
+  m_timeout(-1),
+  m_keyframe_index(),
+  m_stats(),
+  m_open_time(),
+  m_pool(),
+  m_pipeline(nullptr),
+  m_sink(nullptr),
+  m_consumer(),
+  m_preroll_guard(),
+  m_thread(),
+  m_cancel(false),
+  m_error(),
+  m_error_code(ErrorCode::kNone),
+  m_frame_count(0),
+  m_duration(0),
+  m_degraded(),
+  m_gop_interval(-1),
+  m_gop_probed(false),
+  m_sig_finished()
+{
+}
+
+AppSinkProcessor::~AppSinkProcessor()
+{
+  m_cancel = true;
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+
+  m_consumer.reset();
+
+  if (m_sink)
+  {
+    gst_object_unref(m_sink);
+  }
+
+  if (m_pipeline)
+  {
+    m_preroll_guard.reset();
+    PipelinePool::release(m_pool.get(), m_pipeline, !has_error());
+  }
+}
+
+void
+AppSinkProcessor::set_accurate(bool accurate)
+{
+  m_accurate = accurate;
+}
+
+void
+AppSinkProcessor::set_timeout(int timeout)
+{
+  m_timeout = timeout;
+}
+
+void
+AppSinkProcessor::set_options(const VideoProcessorOptions opts)
+{
+  m_opts = opts;
+}
+
+void
+AppSinkProcessor::set_keyframe_index(std::shared_ptr<KeyframeIndex const> index)
+{
+  m_keyframe_index = std::move(index);
+}
+
+void
+AppSinkProcessor::set_stats(std::shared_ptr<CaptureStats> stats)
+{
+  m_stats = std::move(stats);
+}
+
+void
+AppSinkProcessor::set_pipeline_pool(std::shared_ptr<PipelinePool> pool)
+{
+  m_pool = std::move(pool);
+}
+
+void
+AppSinkProcessor::open(const std::string& filename)
+{
+  TraceSpan span("AppSinkProcessor::open");
+  span.set_arg("file", filename);
+
+  m_open_time = std::chrono::steady_clock::now();
+
+  log_info("Using pipeline: {}",
+           get_pipeline_desc(m_opts, "appsink name=mysink sync=False max-buffers=2 enable-last-sample=False"));
+  m_pipeline = PipelinePool::acquire(m_pool.get(), m_opts, PipelineSink::kAppSink);
+
+  m_sink = GST_APP_SINK(gst_bin_get_by_name(GST_BIN(m_pipeline), "mysink"));
+  if (m_stats)
+  {
+    CaptureStats::watch_pipeline(m_stats, m_pipeline);
+  }
+
+  if (Tracer::get())
+  {
+    Tracer::watch_pipeline(m_pipeline);
+  }
+
+  m_preroll_guard = std::make_unique<PrerollGuard>(m_pipeline, m_opts.preroll_timeout, m_opts.preroll_max_bytes);
+
+  Glib::ustring const uri = Glib::filename_to_uri(Glib::canonicalize_filename(filename));
+  GstElement* source = gst_bin_get_by_name(GST_BIN(m_pipeline), "mysource");
+  g_object_set(source, "uri", uri.c_str(), nullptr);
+  gst_object_unref(source);
+
+  m_thread = std::thread(&AppSinkProcessor::run, this);
+}
+
+void
+AppSinkProcessor::run()
+{
+  Tracer::set_thread_name("appsink capture");
+
+  try
+  {
+    capture();
+  }
+  catch(std::exception const& err)
+  {
+    set_error(ErrorCode::kFailed, err.what());
+  }
+  catch(Glib::Error const& err)
+  {
+    set_error(error_code_from_gerror(err.domain(), err.code()), err.what().raw());
+  }
+
+  gst_element_set_state(m_pipeline, GST_STATE_READY);
+  m_preroll_guard.reset();
+
+  if (m_consumer)
+  {
+    m_consumer->finish();
+    std::string const error = m_consumer->get_error();
+    if (!error.empty())
+    {
+      set_error(ErrorCode::kFailed, error);
+    }
+  }
+
+  m_context->signal_idle().connect(sigc::mem_fun(*this, &AppSinkProcessor::on_idle_finished));
+}
+
+void
+AppSinkProcessor::capture()
+{
+  gst_element_set_state(m_pipeline, GST_STATE_PAUSED);
+
+  GstSample* preroll = pull(true);
+  if (!preroll)
+  {
+    set_error(ErrorCode::kCorrupt, "no video frames");
+    return;
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+  if (m_stats)
+  {
+    m_stats->add_preroll(now - m_open_time);
+  }
+
+  if (Tracer* tracer = Tracer::get())
+  {
+    tracer->async("preroll", "vidthumb", m_open_time, now);
+  }
+
+  // where the GOP probe starts from
+  gint64 const preroll_pos = get_stream_time(preroll).first;
+
+  // the caps of the preroll frame size the thumbnailer's canvas
+  {
+    GstVideoInfo info;
+    GstCaps* caps = gst_sample_get_caps(preroll);
+    if (caps && gst_video_info_from_caps(&info, caps))
+    {
+      auto const [width, height] = get_frame_size(info,
+                                                  m_opts.fused_convert ? m_opts.width : std::nullopt,
+                                                  m_opts.fused_convert ? m_opts.height : std::nullopt,
+                                                  m_opts.keep_aspect_ratio);
+      m_thumbnailer.set_frame_size(width, height);
+    }
+  }
+  gst_sample_unref(preroll);
+
+  if (!gst_element_query_duration(m_pipeline, GST_FORMAT_TIME, &m_duration))
+  {
+    throw std::runtime_error("error: QUERY FAILURE");
+  }
+
+  std::vector<gint64> const positions = get_capture_positions(m_thumbnailer, m_duration,
+                                                              m_accurate, m_keyframe_index.get());
+
+  m_gop_interval = m_keyframe_index ? m_keyframe_index->get_average_interval().value_or(-1) : -1;
+  if (m_opts.sampling == SamplingMode::kAuto && m_gop_interval <= 0 &&
+      positions.size() >= 2 && preroll_pos >= 0)
+  {
+    // the choice depends on the GOP interval, measure it instead of
+    // guessing
+    m_gop_interval = probe_gop_interval(preroll_pos);
+    m_gop_probed = true;
+    if (!m_error.empty())
+    {
+      return;
+    }
+  }
+
+  SamplingMode const mode = (m_opts.sampling == SamplingMode::kAuto) ?
+    SamplingCostModel(m_gop_interval, m_accurate).choose(positions) :
+    m_opts.sampling;
+  log_info("appsink: {} sampling for {} positions, GOP interval: {}{}",
+           to_string(mode), positions.size(), m_gop_interval,
+           m_gop_interval > 0 ? "" : " (assuming the default)");
+
+  std::vector<Target> targets;
+  for(size_t i = 0; i < positions.size(); ++i)
+  {
+    targets.push_back(Target{positions[i], static_cast<int>(i)});
+  }
+
+  m_consumer = std::make_unique<FrameConsumer>(m_thumbnailer,
+                                               m_opts.fused_convert ? m_opts.width : std::nullopt,
+                                               m_opts.fused_convert ? m_opts.height : std::nullopt,
+                                               m_opts.keep_aspect_ratio,
+                                               kFrameQueueSize, m_stats);
+
+  if (mode == SamplingMode::kSeek)
+  {
+    capture_seek(targets);
+  }
+  else if (!targets.empty())
+  {
+    std::stable_sort(targets.begin(), targets.end(),
+                     [](Target const& lhs, Target const& rhs) { return lhs.pos < rhs.pos; });
+    capture_scan(targets, mode);
+  }
+
+  if (m_frame_count == 0 && !targets.empty())
+  {
+    set_error(ErrorCode::kCorrupt, "no frames captured");
+  }
+}
+
+void
+AppSinkProcessor::capture_seek(std::vector<Target> const& targets)
+{
+  Gst::SeekFlags const flags = get_seek_flags(m_opts, m_accurate,
+                                              m_keyframe_index && !m_keyframe_index->empty());
+
+  // with --pipelines the targets are only this range's share
+  size_t const total_positions = m_thumbnailer.get_total_positions().value_or(targets.size());
+
+  for(Target const& target : targets)
+  {
+    auto const seek_time = std::chrono::steady_clock::now();
+    std::optional<SeekFallback> fallback;
+    GstSample* sample = capture_position(target, flags, total_positions, &fallback);
+    if (!m_error.empty())
+    {
+      return;
+    }
+
+    if (fallback)
+    {
+      m_degraded.push_back(DegradedCell{target.index, target.pos, *fallback});
+      if (*fallback == SeekFallback::kSkipped)
+      {
+        m_consumer->skip(target.pos, target.index);
+      }
+    }
+
+    if (!sample)
+    {
+      // skipped, or EOS, the position is past the last frame
+      continue;
+    }
+
+    gint64 const pos = get_stream_time(sample).first;
+
+    auto const now = std::chrono::steady_clock::now();
+    if (m_stats)
+    {
+      m_stats->add_seek(now - seek_time);
+    }
+
+    if (Tracer* tracer = Tracer::get())
+    {
+      tracer->async("seek", "vidthumb", seek_time, now,
+                    fmt::format("{{\"pos\":{},\"index\":{}}}", pos, target.index));
+    }
+
+    deliver(sample, pos >= 0 ? pos : target.pos, {target.index});
+  }
+}
+
+GstSample*
+AppSinkProcessor::capture_position(Target const& target, Gst::SeekFlags flags, size_t num_positions,
+                                   std::optional<SeekFallback>* fallback)
+{
+  while(true)
+  {
+    gint64 const pos = (*fallback == SeekFallback::kNeighbour) ?
+      get_neighbour_pos(target.pos, m_duration, num_positions) :
+      target.pos;
+
+    if (seek(pos, *fallback ? get_fallback_seek_flags(m_opts) : flags))
+    {
+      // a flushing seek drops the old preroll, so this is the frame at
+      // the new position
+      GstSample* sample = pull(true, m_opts.seek_deadline);
+      if (sample || !m_error.empty() || gst_app_sink_is_eos(m_sink))
+      {
+        return sample;
+      }
+    }
+    else
+    {
+      log_warn("seek to {} failed", pos);
+    }
+
+    *fallback = get_next_seek_fallback(*fallback);
+    log_warn("no frame for position {} at {}, falling back to: {}",
+             target.index, target.pos, to_string(**fallback));
+    if (**fallback == SeekFallback::kSkipped)
+    {
+      return nullptr;
+    }
+  }
+}
+
+gint64
+AppSinkProcessor::probe_gop_interval(gint64 from)
+{
+  if (!seek(from + 1, get_gop_probe_seek_flags(m_opts)))
+  {
+    log_warn("GOP probe: seek failed");
+    return -1;
+  }
+
+  GstSample* sample = pull(true, get_gop_probe_deadline(m_opts));
+  if (!sample)
+  {
+    log_warn("GOP probe: no keyframe after {}", from);
+    return -1;
+  }
+
+  gint64 const pos = get_stream_time(sample).first;
+  gst_sample_unref(sample);
+
+  log_info("GOP probe: keyframes at {} and {}", from, pos);
+  return pos > from ? pos - from : -1;
+}
+
+void
+AppSinkProcessor::capture_scan(std::vector<Target> const& targets, SamplingMode mode)
+{
+  gint64 const threshold = SamplingCostModel(m_gop_interval, m_accurate).get_scan_threshold();
+  Gst::SeekFlags const flags = get_scan_seek_flags(m_opts, m_accurate);
+
+  // don't decode the whole beginning of the file just to get to the
+  // first position, after the GOP probe the pipeline has to go back
+  // anyway
+  gint64 last_seek = -1;
+  if (m_gop_probed || targets.front().pos > threshold)
+  {
+    seek(targets.front().pos, flags);
+    last_seek = targets.front().pos;
+  }
+
+  gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+
+  size_t next = 0;
+  while(next < targets.size())
+  {
+    GstSample* sample = pull(false);
+    if (!sample)
+    {
+      if (m_error.empty() && gst_app_sink_is_eos(m_sink))
+      {
+        skip_past_eos(targets, next);
+      }
+      return;
+    }
+
+    auto const [pos, end] = get_stream_time(sample);
+    if (pos < 0 || targets[next].pos >= end)
+    {
+      // not there yet, in hybrid mode skip gaps that take longer to
+      // decode than to seek across, once per position
+      if (pos >= 0 && mode == SamplingMode::kHybrid &&
+          targets[next].pos - pos > threshold && targets[next].pos != last_seek)
+      {
+        gst_sample_unref(sample);
+        seek(targets[next].pos, flags);
+        last_seek = targets[next].pos;
+        continue;
+      }
+
+      gst_sample_unref(sample);
+      continue;
+    }
+
+    // with very dense positions a single frame can cover several of them
+    std::vector<int> indices;
+    while(next < targets.size() && targets[next].pos < end)
+    {
+      indices.push_back(targets[next].index);
+      next += 1;
+    }
+    deliver(sample, pos, std::move(indices));
+  }
+}
+
+void
+AppSinkProcessor::skip_past_eos(std::vector<Target> const& targets, size_t first)
+{
+  for(size_t i = first; i < targets.size(); ++i)
+  {
+    log_warn("no frame for position {} at {}, the stream ended before it",
+             targets[i].index, targets[i].pos);
+    m_degraded.push_back(DegradedCell{targets[i].index, targets[i].pos, SeekFallback::kSkipped});
+    m_consumer->skip(targets[i].pos, targets[i].index);
+  }
+}
+
+bool
+AppSinkProcessor::seek(gint64 pos, Gst::SeekFlags flags)
+{
+  log_info("--> REQUEST SEEK: {}", pos);
+  return gst_element_seek_simple(m_pipeline, GST_FORMAT_TIME, static_cast<GstSeekFlags>(flags), pos);
+}
+
+GstSample*
+AppSinkProcessor::pull(bool preroll, int deadline)
+{
+  TraceSpan span(preroll ? "pull_preroll" : "pull_sample");
+  gint64 const start = g_get_monotonic_time();
+
+  while(!m_cancel)
+  {
+    GstSample* sample = preroll ?
+      gst_app_sink_try_pull_preroll(m_sink, kPollInterval) :
+      gst_app_sink_try_pull_sample(m_sink, kPollInterval);
+
+    if (!check_bus())
+    {
+      if (sample)
+      {
+        gst_sample_unref(sample);
+      }
+      return nullptr;
+    }
+
+    if (sample)
+    {
+      return sample;
+    }
+
+    if (gst_app_sink_is_eos(m_sink))
+    {
+      return nullptr;
+    }
+
+    double const elapsed = static_cast<double>(g_get_monotonic_time() - start) / G_USEC_PER_SEC;
+    if (deadline >= 0 && elapsed > deadline / 1000.0)
+    {
+      return nullptr;
+    }
+
+    if (m_timeout != -1 && elapsed > m_timeout / 1000.0)
+    {
+      set_error(ErrorCode::kTimeout, fmt::format("timeout after {:.1f}s", elapsed));
+      return nullptr;
+    }
+  }
+
+  set_error(ErrorCode::kCancelled, "cancelled");
+  return nullptr;
+}
+
+bool
+AppSinkProcessor::check_bus()
+{
+  bool ok = true;
+
+  GstBus* bus = gst_element_get_bus(m_pipeline);
+  while(GstMessage* message = gst_bus_pop(bus))
+  {
+    if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR)
+    {
+      GError* error = nullptr;
+      gchar* debug = nullptr;
+      gst_message_parse_error(message, &error, &debug);
+      log_error("MessageError: {} ({})", error->message, debug ? debug : "");
+      set_error(error_code_from_gerror(error->domain, error->code), error->message);
+      g_clear_error(&error);
+      g_free(debug);
+      ok = false;
+    }
+    else if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ELEMENT)
+    {
+      std::string description;
+      if (is_missing_video_plugin(message, &description))
+      {
+        log_error("missing plugin: {}", description);
+        set_error(ErrorCode::kMissingPlugin, "missing plugin: " + description);
+        ok = false;
+      }
+    }
+    gst_message_unref(message);
+  }
+  gst_object_unref(bus);
+
+  return ok;
+}
+
+std::pair<gint64, gint64>
+AppSinkProcessor::get_stream_time(GstSample* sample) const
+{
+  GstBuffer* buffer = gst_sample_get_buffer(sample);
+  GstSegment* segment = gst_sample_get_segment(sample);
+  if (!buffer || !segment || !GST_BUFFER_PTS_IS_VALID(buffer))
+  {
+    return { -1, -1 };
+  }
+
+  guint64 const stream_time = gst_segment_to_stream_time(segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer));
+  if (!GST_CLOCK_TIME_IS_VALID(stream_time))
+  {
+    return { -1, -1 };
+  }
+
+  gint64 const pos = static_cast<gint64>(stream_time);
+  gint64 const end = GST_BUFFER_DURATION_IS_VALID(buffer) ?
+    pos + static_cast<gint64>(GST_BUFFER_DURATION(buffer)) :
+    pos + 1;
+  return { pos, end };
+}
+
+void
+AppSinkProcessor::deliver(GstSample* sample, gint64 pos, std::vector<int> indices)
+{
+  log_debug("appsink frame: {} ({} positions)", pos, indices.size());
+
+  m_frame_count += static_cast<int>(indices.size());
+  m_consumer->push(Glib::wrap(gst_sample_get_buffer(sample), true),
+                   Glib::wrap(gst_sample_get_caps(sample), true),
+                   pos, std::move(indices));
+  gst_sample_unref(sample);
+}
+
+void
+AppSinkProcessor::set_error(ErrorCode code, std::string const& error)
+{
+  // keep the first error, later ones are usually just consequences of it
+  if (m_error.empty())
+  {
+    m_error = error;
+    m_error_code = code;
+  }
+}
+
+bool
+AppSinkProcessor::on_idle_finished()
+{
+  m_thread.join();
+  m_sig_finished.emit();
+  return false;
+}
+
+/* EOF */
@@ -0,0 +1,162 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_APPSINK_PROCESSOR_HPP
+#define HEADER_APPSINK_PROCESSOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gst/app/gstappsink.h>
+
+#include "capture_engine.hpp"
+
+class CaptureStats;
+class FrameConsumer;
+class PipelinePool;
+class PrerollGuard;
+
+/** Captures frames by pulling them from an appsink in a loop on a
+    thread of its own. Each seek is issued right after the previous
+    frame has been pulled, the position comes from the buffer PTS and
+    the segment of the sample, there are no handoff signals, position
+    queries, bus watches or idle callbacks between the frames. The main
+    context is only used to emit signal_finished().
+
+    Seek and scan sampling are supported, hybrid sampling seeks across
+    the gaps the cost model considers too long to decode through. */
+class AppSinkProcessor final : public CaptureEngine
+{
+private:
+  struct Target
+  {
+    gint64 pos;
+    int index;
+  };
+
+private:
+  Glib::RefPtr<Glib::MainContext> m_context;
+  Thumbnailer& m_thumbnailer;
+
+  VideoProcessorOptions m_opts;
+  bool m_accurate;
+  int m_timeout;
+  std::shared_ptr<KeyframeIndex const> m_keyframe_index;
+  std::shared_ptr<CaptureStats> m_stats;
+  std::chrono::steady_clock::time_point m_open_time;
+
+  std::shared_ptr<PipelinePool> m_pool;
+  GstElement* m_pipeline;
+  GstAppSink* m_sink;
+  std::unique_ptr<FrameConsumer> m_consumer;
+  std::unique_ptr<PrerollGuard> m_preroll_guard;
+
+  std::thread m_thread;
+  std::atomic<bool> m_cancel;
+
+  /** only touched by the capture thread until it has been joined */
+  std::string m_error;
+  ErrorCode m_error_code;
+  int m_frame_count;
+  gint64 m_duration;
+  std::vector<DegradedCell> m_degraded;
+
+  /** GOP interval from the keyframe index or probe_gop_interval(), -1
+      if unknown, and whether the probe moved the pipeline away from
+      the preroll frame */
+  gint64 m_gop_interval;
+  bool m_gop_probed;
+
+  sigc::signal<void> m_sig_finished;
+
+public:
+  AppSinkProcessor(Glib::RefPtr<Glib::MainContext> context,
+                   Thumbnailer& thumbnailer);
+  ~AppSinkProcessor() override;
+
+  void set_accurate(bool accurate) override;
+  void set_timeout(int timeout) override;
+  void set_options(const VideoProcessorOptions opts) override;
+  void set_keyframe_index(std::shared_ptr<KeyframeIndex const> index) override;
+  void set_stats(std::shared_ptr<CaptureStats> stats) override;
+  void set_pipeline_pool(std::shared_ptr<PipelinePool> pool) override;
+  void open(const std::string& filename) override;
+  void cancel() override { m_cancel = true; }
+
+  bool has_error() const override { return !m_error.empty(); }
+  std::string const& get_error() const override { return m_error; }
+  ErrorCode get_error_code() const override { return m_error_code; }
+  std::vector<DegradedCell> const& get_degraded() const override { return m_degraded; }
+  sigc::signal<void>& signal_finished() override { return m_sig_finished; }
+
+private:
+  void run();
+  void capture();
+  void capture_seek(std::vector<Target> const& targets);
+
+  /** Seeks to \a target and pulls its frame, going down the
+      SeekFallback ladder when the frame misses the seek deadline.
+      \a num_positions is passed on to get_neighbour_pos().
+      Returns nullptr on EOS, error and when the position was skipped,
+      \a fallback is set to the fallback taken, if any. */
+  GstSample* capture_position(Target const& target, Gst::SeekFlags flags, size_t num_positions,
+                              std::optional<SeekFallback>* fallback);
+  void capture_scan(std::vector<Target> const& targets, SamplingMode mode);
+
+  /** Seeks to the first keyframe after the keyframe at \a from and
+      returns the distance between the two, -1 when that didn't work
+      out */
+  gint64 probe_gop_interval(gint64 from);
+
+  /** Gives up on \a targets from \a first on, the stream ended
+      before reaching them */
+  void skip_past_eos(std::vector<Target> const& targets, size_t first);
+
+  bool seek(gint64 pos, Gst::SeekFlags flags);
+
+  /** Waits for the next preroll or, when playing, the next sample.
+      Returns nullptr on EOS, error, timeout or cancellation, only the
+      latter three set m_error. Gives up without an error after \a
+      deadline milliseconds, -1 for no deadline. */
+  GstSample* pull(bool preroll, int deadline = -1);
+
+  /** Pops all pending bus messages, returns false after an error */
+  bool check_bus();
+
+  /** Returns the stream time of \a sample and the end of the frame,
+      -1 when it has no valid timestamp */
+  std::pair<gint64, gint64> get_stream_time(GstSample* sample) const;
+
+  void deliver(GstSample* sample, gint64 pos, std::vector<int> indices);
+  void set_error(ErrorCode code, std::string const& error);
+  bool on_idle_finished();
+
+private:
+  AppSinkProcessor(const AppSinkProcessor&) = delete;
+  AppSinkProcessor& operator=(const AppSinkProcessor&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,291 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "blit.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+/** Reads one source pixel as native endian xRGB with x = 0xff */
+template<Cairo::Format F>
+struct PixelTraits;
+
+template<>
+struct PixelTraits<Cairo::FORMAT_RGB24>
+{
+  static constexpr int kBytes = 4;
+  static constexpr bool kNative = true;
+
+  static uint32_t load(uint8_t const* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v | 0xff000000u;
+  }
+};
+
+template<>
+struct PixelTraits<Cairo::FORMAT_ARGB32>
+{
+  // premultiplied, so dropping the alpha composites onto black
+  static constexpr int kBytes = 4;
+  static constexpr bool kNative = true;
+
+  static uint32_t load(uint8_t const* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v | 0xff000000u;
+  }
+};
+
+template<>
+struct PixelTraits<Cairo::FORMAT_RGB16_565>
+{
+  static constexpr int kBytes = 2;
+  static constexpr bool kNative = false;
+
+  static uint32_t load(uint8_t const* p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    uint32_t const r = (v >> 11) & 0x1f;
+    uint32_t const g = (v >> 5) & 0x3f;
+    uint32_t const b = v & 0x1f;
+    return 0xff000000u |
+      (((r << 3) | (r >> 2)) << 16) |
+      (((g << 2) | (g >> 4)) << 8) |
+      ((b << 3) | (b >> 2));
+  }
+};
+
+struct Rect
+{
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct View
+{
+  uint8_t* data;
+  int stride;
+  int width;
+  int height;
+};
+
+/** Copies or nearest-neighbour scales \a src into \a rect of \a dst,
+    \a rect is already clipped against \a dst, \a full is the unclipped
+    target rect that defines the scale */
+template<Cairo::Format F, bool kScale>
+void blit(uint8_t const* src, int src_stride, int src_width, int src_height,
+          View const& dst, Rect const& full, Rect const& rect)
+{
+  using Traits = PixelTraits<F>;
+
+  if constexpr (!kScale)
+  {
+    for(int y = rect.y; y < rect.y + rect.height; ++y)
+    {
+      uint8_t const* src_row = src + (y - full.y) * src_stride + (rect.x - full.x) * Traits::kBytes;
+      uint8_t* dst_row = dst.data + y * dst.stride + rect.x * 4;
+
+      if constexpr (Traits::kNative)
+      {
+        memcpy(dst_row, src_row, static_cast<size_t>(rect.width) * 4);
+      }
+      else
+      {
+        for(int x = 0; x < rect.width; ++x)
+        {
+          uint32_t const v = Traits::load(src_row + x * Traits::kBytes);
+          memcpy(dst_row + x * 4, &v, sizeof(v));
+        }
+      }
+    }
+  }
+  else
+  {
+    // sample at the pixel centers
+    std::vector<int> src_x(static_cast<size_t>(rect.width));
+    for(int x = 0; x < rect.width; ++x)
+    {
+      int const fx = x + rect.x - full.x;
+      src_x[static_cast<size_t>(x)] = static_cast<int>((2 * static_cast<int64_t>(fx) + 1) * src_width / (2 * full.width)) *
+        Traits::kBytes;
+    }
+
+    for(int y = rect.y; y < rect.y + rect.height; ++y)
+    {
+      int const fy = y - full.y;
+      int const sy = static_cast<int>((2 * static_cast<int64_t>(fy) + 1) * src_height / (2 * full.height));
+      uint8_t const* src_row = src + sy * src_stride;
+      uint8_t* dst_row = dst.data + y * dst.stride + rect.x * 4;
+
+      for(int x = 0; x < rect.width; ++x)
+      {
+        uint32_t const v = Traits::load(src_row + src_x[static_cast<size_t>(x)]);
+        memcpy(dst_row + x * 4, &v, sizeof(v));
+      }
+    }
+  }
+}
+
+template<Cairo::Format F>
+void blit_format(uint8_t const* src, int src_stride, int src_width, int src_height,
+                 View const& dst, Rect const& full, Rect const& rect)
+{
+  if (full.width == src_width && full.height == src_height)
+  {
+    blit<F, false>(src, src_stride, src_width, src_height, dst, full, rect);
+  }
+  else
+  {
+    blit<F, true>(src, src_stride, src_width, src_height, dst, full, rect);
+  }
+}
+
+Rect intersect(Rect const& a, Rect const& b)
+{
+  int const x0 = std::max(a.x, b.x);
+  int const y0 = std::max(a.y, b.y);
+  int const x1 = std::min(a.x + a.width, b.x + b.width);
+  int const y1 = std::min(a.y + a.height, b.y + b.height);
+  return Rect{ x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0) };
+}
+
+void fill_black(View const& dst, Rect const& rect)
+{
+  for(int y = rect.y; y < rect.y + rect.height; ++y)
+  {
+    uint32_t* row = reinterpret_cast<uint32_t*>(dst.data + y * dst.stride) + rect.x;
+    std::fill(row, row + rect.width, 0xff000000u);
+  }
+}
+
+void blit_surface(Cairo::RefPtr<Cairo::ImageSurface> const& src,
+                  View const& dst, Rect const& full, Rect const& rect)
+{
+  uint8_t const* data = src->get_data();
+  int const stride = src->get_stride();
+  int const src_width = src->get_width();
+  int const src_height = src->get_height();
+
+  switch(src->get_format())
+  {
+    case Cairo::FORMAT_RGB24:
+      blit_format<Cairo::FORMAT_RGB24>(data, stride, src_width, src_height, dst, full, rect);
+      break;
+
+    case Cairo::FORMAT_ARGB32:
+      blit_format<Cairo::FORMAT_ARGB32>(data, stride, src_width, src_height, dst, full, rect);
+      break;
+
+    case Cairo::FORMAT_RGB16_565:
+      blit_format<Cairo::FORMAT_RGB16_565>(data, stride, src_width, src_height, dst, full, rect);
+      break;
+
+    default:
+      throw std::runtime_error("blit: unsupported source format");
+  }
+}
+
+} // namespace
+
+void
+blit_letterboxed(Cairo::RefPtr<Cairo::ImageSurface> const& src,
+                 Cairo::RefPtr<Cairo::ImageSurface> const& dst,
+                 int x, int y, int width, int height)
+{
+  if (dst->get_format() != Cairo::FORMAT_RGB24)
+  {
+    throw std::runtime_error("blit_letterboxed: unsupported target format");
+  }
+
+  int const src_width = src->get_width();
+  int const src_height = src->get_height();
+  if (src_width <= 0 || src_height <= 0 || width <= 0 || height <= 0)
+  {
+    return;
+  }
+
+  src->flush();
+  dst->flush();
+
+  View const view{ dst->get_data(), dst->get_stride(), dst->get_width(), dst->get_height() };
+  Rect const bounds{ 0, 0, view.width, view.height };
+  Rect const cell{ x, y, width, height };
+
+  // fit the frame into the cell, keeping its aspect ratio
+  Rect full = cell;
+  if (src_width != width || src_height != height)
+  {
+    if (static_cast<int64_t>(src_width) * height > static_cast<int64_t>(src_height) * width)
+    {
+      full.height = std::max(1, static_cast<int>(static_cast<int64_t>(src_height) * width / src_width));
+      full.y = y + (height - full.height) / 2;
+    }
+    else
+    {
+      full.width = std::max(1, static_cast<int>(static_cast<int64_t>(src_width) * height / src_height));
+      full.x = x + (width - full.width) / 2;
+    }
+
+    fill_black(view, intersect(cell, bounds));
+  }
+
+  Rect const rect = intersect(full, bounds);
+  if (rect.width > 0 && rect.height > 0)
+  {
+    blit_surface(src, view, full, rect);
+  }
+
+  dst->mark_dirty();
+}
+
+void
+blit_region(Cairo::RefPtr<Cairo::ImageSurface> const& src, int src_x, int src_y,
+            Cairo::RefPtr<Cairo::ImageSurface> const& dst, int x, int y,
+            int width, int height)
+{
+  if (dst->get_format() != Cairo::FORMAT_RGB24)
+  {
+    throw std::runtime_error("blit_region: unsupported target format");
+  }
+
+  src->flush();
+  dst->flush();
+
+  View const view{ dst->get_data(), dst->get_stride(), dst->get_width(), dst->get_height() };
+
+  // the whole source as placed in dst, clipped against both surfaces
+  Rect const full{ x - src_x, y - src_y, src->get_width(), src->get_height() };
+  Rect const rect = intersect(intersect(Rect{ x, y, width, height }, full),
+                              Rect{ 0, 0, view.width, view.height });
+  if (rect.width > 0 && rect.height > 0)
+  {
+    blit_surface(src, view, full, rect);
+  }
+
+  dst->mark_dirty();
+}
+
+/* EOF */
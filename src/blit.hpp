@@ -0,0 +1,43 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_BLIT_HPP
+#define HEADER_BLIT_HPP
+
+#include <cairomm/cairomm.h>
+
+/** Copies \a src into the \a width x \a height cell at \a x, \a y of
+    \a dst, which must be RGB24. A source of the cell's size
+    is copied row by row, anything else is scaled to fit, centered and
+    letterboxed with black. RGB24, ARGB32 (composited onto black) and
+    RGB16_565 sources are supported. Parts outside of \a dst are
+    clipped. */
+void blit_letterboxed(Cairo::RefPtr<Cairo::ImageSurface> const& src,
+                      Cairo::RefPtr<Cairo::ImageSurface> const& dst,
+                      int x, int y, int width, int height);
+
+/** Copies the \a width x \a height area at \a src_x, \a src_y of \a
+    src unscaled to \a x, \a y of \a dst, which must be RGB24. Parts
+    outside of either surface are left untouched. */
+void blit_region(Cairo::RefPtr<Cairo::ImageSurface> const& src, int src_x, int src_y,
+                 Cairo::RefPtr<Cairo::ImageSurface> const& dst, int x, int y,
+                 int width, int height);
+
+#endif
+
+/* EOF */
@@ -0,0 +1,254 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture_engine.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "appsink_processor.hpp"
+#include "keyframe_index.hpp"
+#include "thumbnailer.hpp"
+#include "video_processor.hpp"
+
+CaptureEngineType
+capture_engine_type_from_string(const std::string& name)
+{
+  if (name == "handoff")
+  {
+    return CaptureEngineType::kHandoff;
+  }
+  else if (name == "appsink")
+  {
+    return CaptureEngineType::kAppSink;
+  }
+  else
+  {
+    throw std::runtime_error("unknown capture engine: " + name + ", expected handoff or appsink");
+  }
+}
+
+std::string
+to_string(CaptureEngineType type)
+{
+  switch(type)
+  {
+    case CaptureEngineType::kHandoff: return "handoff";
+    case CaptureEngineType::kAppSink: return "appsink";
+  }
+  return "unknown";
+}
+
+std::string
+to_string(SeekFallback fallback)
+{
+  switch(fallback)
+  {
+    case SeekFallback::kKeyUnit: return "key-unit";
+    case SeekFallback::kNeighbour: return "neighbour";
+    case SeekFallback::kSkipped: return "skipped";
+  }
+  return "unknown";
+}
+
+SeekFallback
+get_next_seek_fallback(std::optional<SeekFallback> fallback)
+{
+  if (!fallback)
+  {
+    return SeekFallback::kKeyUnit;
+  }
+  else if (*fallback == SeekFallback::kKeyUnit)
+  {
+    return SeekFallback::kNeighbour;
+  }
+  else
+  {
+    return SeekFallback::kSkipped;
+  }
+}
+
+std::unique_ptr<CaptureEngine>
+create_capture_engine(CaptureEngineType type,
+                      Glib::RefPtr<Glib::MainContext> context,
+                      Thumbnailer& thumbnailer)
+{
+  switch(type)
+  {
+    case CaptureEngineType::kAppSink:
+      return std::make_unique<AppSinkProcessor>(context, thumbnailer);
+
+    case CaptureEngineType::kHandoff:
+    default:
+      return std::make_unique<VideoProcessor>(context, thumbnailer);
+  }
+}
+
+std::string
+get_output_caps(VideoProcessorOptions const& opts)
+{
+  if (opts.fused_convert)
+  {
+    // videoconvert is passthrough for the formats VideoFrame can
+    // handle itself, scaling happens in VideoFrame
+    return "video/x-raw,format=(string){I420,NV12,P010_10LE,BGRx}";
+  }
+
+  // force output format
+  std::ostringstream caps;
+  caps << "video/x-raw,format=BGRx";
+  if (opts.width)
+  {
+    caps << ",width=" << *opts.width;
+  }
+
+  if (opts.height)
+  {
+    caps << ",height=" << *opts.height;
+  }
+
+  if (opts.keep_aspect_ratio)
+  {
+    caps << ",pixel-aspect-ratio=1/1";
+  }
+
+  return caps.str();
+}
+
+std::string
+get_pipeline_desc(VideoProcessorOptions const& opts, const std::string& sink)
+{
+  std::ostringstream pipeline_desc;
+
+  pipeline_desc << "uridecodebin name=mysource ";
+  if (!opts.fused_convert)
+  {
+    pipeline_desc << "  ! videoscale ";
+  }
+  pipeline_desc <<
+    "  ! videoconvert "
+    "  ! capsfilter name=myfilter caps=\"" << get_output_caps(opts) << "\""
+    "  ! " << sink;
+
+  return pipeline_desc.str();
+}
+
+namespace {
+
+// a probe seek only decodes one keyframe, a second is plenty even
+// without --seek-deadline
+constexpr int kDefaultGopProbeDeadline = 1000;
+
+/** Adds the trick mode flags of --keyframes-only to \a flags, they let
+    GstVideoDecoder drop all non-keyframes before decoding and allow
+    decoders to skip deblocking */
+Gst::SeekFlags add_keyframes_only_flags(VideoProcessorOptions const& opts, Gst::SeekFlags flags)
+{
+  if (!opts.keyframes_only)
+  {
+    return flags;
+  }
+
+  return flags |
+    Gst::SEEK_FLAG_TRICKMODE |
+    Gst::SEEK_FLAG_TRICKMODE_KEY_UNITS |
+    Gst::SEEK_FLAG_TRICKMODE_NO_AUDIO;
+}
+
+} // namespace
+
+Gst::SeekFlags
+get_seek_flags(VideoProcessorOptions const& opts, bool accurate, bool have_keyframe_index)
+{
+  if (accurate && !opts.keyframes_only)
+  {
+    return Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_ACCURATE;  // slow
+  }
+  else if (have_keyframe_index)
+  {
+    // positions have already been snapped to real keyframes, so an
+    // accurate seek only needs to decode that one keyframe
+    return add_keyframes_only_flags(opts, Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_ACCURATE);
+  }
+  else
+  {
+    // fast
+    return add_keyframes_only_flags(opts, Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_KEY_UNIT | Gst::SEEK_FLAG_SNAP_NEAREST);
+  }
+}
+
+Gst::SeekFlags
+get_scan_seek_flags(VideoProcessorOptions const& opts, bool accurate)
+{
+  // when accurate, land before the position and decode up to it
+  return add_keyframes_only_flags(opts, Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_KEY_UNIT |
+                                  (accurate ? Gst::SEEK_FLAG_SNAP_BEFORE : Gst::SEEK_FLAG_SNAP_NEAREST));
+}
+
+Gst::SeekFlags
+get_fallback_seek_flags(VideoProcessorOptions const& opts)
+{
+  // the keyframe itself is the one frame that doesn't need anything
+  // before it decoded, which is what stalled the first time
+  return add_keyframes_only_flags(opts, Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_KEY_UNIT | Gst::SEEK_FLAG_SNAP_BEFORE);
+}
+
+Gst::SeekFlags
+get_gop_probe_seek_flags(VideoProcessorOptions const& opts)
+{
+  // only the keyframe is needed, nothing after it gets decoded
+  return add_keyframes_only_flags(opts, Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_KEY_UNIT | Gst::SEEK_FLAG_SNAP_AFTER);
+}
+
+int
+get_gop_probe_deadline(VideoProcessorOptions const& opts)
+{
+  return opts.seek_deadline >= 0 ? opts.seek_deadline : kDefaultGopProbeDeadline;
+}
+
+gint64
+get_neighbour_pos(gint64 pos, gint64 duration, size_t num_positions)
+{
+  gint64 const offset = duration / static_cast<gint64>(std::max<size_t>(1, num_positions)) / 4;
+  if (pos - offset >= 0)
+  {
+    return pos - offset;
+  }
+  else
+  {
+    return std::min(pos + offset, std::max<gint64>(0, duration - 1));
+  }
+}
+
+std::vector<gint64>
+get_capture_positions(Thumbnailer& thumbnailer, gint64 duration,
+                      bool accurate, KeyframeIndex const* index)
+{
+  std::vector<gint64> positions = thumbnailer.get_thumbnail_pos(duration);
+  if (!accurate && index && !index->empty())
+  {
+    for(auto& pos : positions)
+    {
+      pos = index->snap(pos);
+    }
+  }
+  return positions;
+}
+
+/* EOF */
@@ -0,0 +1,206 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_CAPTURE_ENGINE_HPP
+#define HEADER_CAPTURE_ENGINE_HPP
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glibmm.h>
+#include <gstreamermm.h>
+
+#include "capture_error.hpp"
+#include "sampling.hpp"
+
+class CaptureStats;
+class KeyframeIndex;
+class PipelinePool;
+class Thumbnailer;
+
+struct VideoProcessorOptions
+{
+  std::optional<int> width = {};
+  std::optional<int> height = {};
+  bool keep_aspect_ratio = true;
+
+  /** Only decode keyframes, skip loop filtering where the decoder
+      allows it and decode at reduced resolution when the requested
+      size is much smaller than the source. Implies non-accurate
+      seeking. */
+  bool keyframes_only = false;
+
+  /** How to get from one position to the next */
+  SamplingMode sampling = SamplingMode::kAuto;
+
+  /** Take the decoder's I420, NV12 or P010 frames as they are and
+      convert and area-average them to the requested size in one go,
+      instead of going through videoscale and videoconvert */
+  bool fused_convert = false;
+
+  /** Give up when the first frame hasn't arrived after this many
+      milliseconds, -1 for never, see PrerollGuard */
+  int preroll_timeout = 3000;
+
+  /** Give up when this many bytes have been read without a frame, 0
+      for no limit */
+  guint64 preroll_max_bytes = 64 * 1024 * 1024;
+
+  /** How many milliseconds a seek gets to deliver its frame before the
+      next SeekFallback is tried, -1 for no deadline. Seek sampling
+      and the GOP probe only, scanning is covered by the timeout. */
+  int seek_deadline = 1000;
+};
+
+/** What was done about a position whose seek missed its deadline, in
+    the order they are tried */
+enum class SeekFallback
+{
+  /** seek again, to the keyframe before the position */
+  kKeyUnit,
+
+  /** seek to the keyframe before a position a bit off the original */
+  kNeighbour,
+
+  /** give up on the position, the thumbnailer gets skip_frame() */
+  kSkipped
+};
+
+std::string to_string(SeekFallback fallback);
+
+/** Returns the fallback to try after \a fallback, or the first one */
+SeekFallback get_next_seek_fallback(std::optional<SeekFallback> fallback);
+
+/** A position that didn't get the frame it asked for */
+struct DegradedCell
+{
+  /** element of Thumbnailer::get_thumbnail_pos() */
+  int index;
+  gint64 pos;
+  SeekFallback fallback;
+};
+
+enum class CaptureEngineType
+{
+  /** fakesink handoff signals driven by the main loop, VideoProcessor */
+  kHandoff,
+
+  /** appsink pulled from a thread of its own, AppSinkProcessor */
+  kAppSink
+};
+
+CaptureEngineType capture_engine_type_from_string(const std::string& name);
+std::string to_string(CaptureEngineType type);
+
+/** Opens a video, captures the frames at the positions the Thumbnailer
+    asks for and hands them to it */
+class CaptureEngine : public sigc::trackable
+{
+public:
+  virtual ~CaptureEngine() {}
+
+  virtual void set_accurate(bool accurate) =0;
+
+  /** Give up when no frame arrived for \a timeout milliseconds, -1 for
+      never */
+  virtual void set_timeout(int timeout) =0;
+  virtual void set_options(const VideoProcessorOptions opts) =0;
+
+  /** Snap the thumbnail positions to the keyframes in \a index before
+      seeking, only used when seeking isn't accurate */
+  virtual void set_keyframe_index(std::shared_ptr<KeyframeIndex const> index) =0;
+
+  /** Record timings and counters in \a stats, must be set before
+      open() */
+  virtual void set_stats(std::shared_ptr<CaptureStats> stats) =0;
+
+  /** Take the pipeline from \a pool and hand it back when done instead
+      of building a new one, must be set before open() */
+  virtual void set_pipeline_pool(std::shared_ptr<PipelinePool> pool) =0;
+
+  /** Starts capturing, the work is driven by the main context passed
+      to create_capture_engine() */
+  virtual void open(const std::string& filename) =0;
+
+  /** Stops capturing early, signal_finished() follows with the error
+      "cancelled". Must be called from the main context. */
+  virtual void cancel() =0;
+
+  /** Returns true when the run was aborted by an error or timeout or
+      when not a single frame could be captured */
+  virtual bool has_error() const =0;
+  virtual std::string const& get_error() const =0;
+  virtual ErrorCode get_error_code() const =0;
+
+  /** Returns the positions that needed a SeekFallback, valid once
+      signal_finished() has been emitted */
+  virtual std::vector<DegradedCell> const& get_degraded() const =0;
+
+  /** Emitted from the main context once the pipeline has been shut
+      down, either because all frames were captured or on error */
+  virtual sigc::signal<void>& signal_finished() =0;
+};
+
+std::unique_ptr<CaptureEngine> create_capture_engine(CaptureEngineType type,
+                                                     Glib::RefPtr<Glib::MainContext> context,
+                                                     Thumbnailer& thumbnailer);
+
+/** Returns the caps the decoding pipeline for \a opts delivers */
+std::string get_output_caps(VideoProcessorOptions const& opts);
+
+/** Returns the gst-launch description of the decoding pipeline for
+    \a opts, ending in \a sink, which must be named 'mysink', the
+    uridecodebin is named 'mysource' and the capsfilter 'myfilter' */
+std::string get_pipeline_desc(VideoProcessorOptions const& opts, const std::string& sink);
+
+/** Returns the flags for seeking to a thumbnail position */
+Gst::SeekFlags get_seek_flags(VideoProcessorOptions const& opts, bool accurate, bool have_keyframe_index);
+
+/** Returns the flags for seeking ahead while playing through the file */
+Gst::SeekFlags get_scan_seek_flags(VideoProcessorOptions const& opts, bool accurate);
+
+/** Returns the flags for the seeks of SeekFallback::kKeyUnit and
+    kNeighbour, which go for the cheapest frame there is */
+Gst::SeekFlags get_fallback_seek_flags(VideoProcessorOptions const& opts);
+
+/** Returns the flags for the probe seek that measures the GOP
+    interval for SamplingMode::kAuto, it lands on the first keyframe
+    after the position */
+Gst::SeekFlags get_gop_probe_seek_flags(VideoProcessorOptions const& opts);
+
+/** Returns how many milliseconds the probe seek gets to deliver its
+    frame before the default GOP interval is assumed */
+int get_gop_probe_deadline(VideoProcessorOptions const& opts);
+
+/** Returns the position SeekFallback::kNeighbour seeks to instead of
+    \a pos, a quarter of the distance to the next of \a num_positions
+    evenly spread positions back, so it stays within the same cell.
+    \a num_positions is the count for the whole file, not just the
+    range of one pipeline, see Thumbnailer::get_total_positions(). */
+gint64 get_neighbour_pos(gint64 pos, gint64 duration, size_t num_positions);
+
+/** Returns the positions \a thumbnailer asks for, snapped to the
+    keyframes of \a index when seeking isn't accurate */
+std::vector<gint64> get_capture_positions(Thumbnailer& thumbnailer, gint64 duration,
+                                          bool accurate, KeyframeIndex const* index);
+
+#endif
+
+/* EOF */
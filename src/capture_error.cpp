@@ -0,0 +1,147 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture_error.hpp"
+
+char const*
+to_string(ErrorCode code)
+{
+  switch(code)
+  {
+    case ErrorCode::kNone: return "none";
+    case ErrorCode::kFailed: return "failed";
+    case ErrorCode::kUnreadable: return "unreadable";
+    case ErrorCode::kMissingPlugin: return "missing-plugin";
+    case ErrorCode::kNoVideo: return "no-video";
+    case ErrorCode::kCorrupt: return "corrupt";
+    case ErrorCode::kPrerollBudget: return "preroll-budget";
+    case ErrorCode::kTimeout: return "timeout";
+    case ErrorCode::kCancelled: return "cancelled";
+  }
+  return "failed";
+}
+
+GQuark
+vidthumb_error_quark()
+{
+  return g_quark_from_static_string("vidthumb-error-quark");
+}
+
+ErrorCode
+error_code_from_gerror(GQuark domain, int code)
+{
+  if (domain == vidthumb_error_quark())
+  {
+    return static_cast<ErrorCode>(code);
+  }
+  else if (domain == GST_CORE_ERROR)
+  {
+    if (code == GST_CORE_ERROR_MISSING_PLUGIN)
+    {
+      return ErrorCode::kMissingPlugin;
+    }
+  }
+  else if (domain == GST_RESOURCE_ERROR)
+  {
+    switch(code)
+    {
+      case GST_RESOURCE_ERROR_NOT_FOUND:
+      case GST_RESOURCE_ERROR_OPEN_READ:
+      case GST_RESOURCE_ERROR_OPEN_READ_WRITE:
+      case GST_RESOURCE_ERROR_READ:
+      case GST_RESOURCE_ERROR_NOT_AUTHORIZED:
+        return ErrorCode::kUnreadable;
+
+      default:
+        break;
+    }
+  }
+  else if (domain == GST_STREAM_ERROR)
+  {
+    switch(code)
+    {
+      case GST_STREAM_ERROR_CODEC_NOT_FOUND:
+        return ErrorCode::kMissingPlugin;
+
+      case GST_STREAM_ERROR_TYPE_NOT_FOUND:
+      case GST_STREAM_ERROR_WRONG_TYPE:
+      case GST_STREAM_ERROR_DECODE:
+      case GST_STREAM_ERROR_DEMUX:
+      case GST_STREAM_ERROR_FORMAT:
+        return ErrorCode::kCorrupt;
+
+      default:
+        break;
+    }
+  }
+  else if (domain == G_FILE_ERROR)
+  {
+    return ErrorCode::kUnreadable;
+  }
+
+  return ErrorCode::kFailed;
+}
+
+void
+post_error(GstElement* element, ErrorCode code, std::string const& message)
+{
+  GError* error = g_error_new_literal(vidthumb_error_quark(), static_cast<int>(code), message.c_str());
+  gst_element_post_message(element, gst_message_new_error(GST_OBJECT(element), error, nullptr));
+  g_error_free(error);
+}
+
+bool
+is_missing_video_plugin(GstMessage* message, std::string* description)
+{
+  // the same check gst_is_missing_plugin_message() does, without
+  // pulling in gstreamer-pbutils for it
+  GstStructure const* structure = gst_message_get_structure(message);
+  if (GST_MESSAGE_TYPE(message) != GST_MESSAGE_ELEMENT || !structure ||
+      !gst_structure_has_name(structure, "missing-plugin"))
+  {
+    return false;
+  }
+
+  GstCaps* caps = nullptr;
+  if (!gst_structure_get(structure, "detail", GST_TYPE_CAPS, &caps, nullptr))
+  {
+    return false;
+  }
+
+  bool const is_video = gst_caps_get_size(caps) > 0 &&
+    g_str_has_prefix(gst_structure_get_name(gst_caps_get_structure(caps, 0)), "video/");
+  if (is_video)
+  {
+    char const* name = gst_structure_get_string(structure, "name");
+    if (name)
+    {
+      *description = name;
+    }
+    else
+    {
+      gchar* str = gst_caps_to_string(caps);
+      *description = std::string("decoder for ") + str;
+      g_free(str);
+    }
+  }
+  gst_caps_unref(caps);
+
+  return is_video;
+}
+
+/* EOF */
@@ -0,0 +1,96 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_CAPTURE_ERROR_HPP
+#define HEADER_CAPTURE_ERROR_HPP
+
+#include <string>
+#include <utility>
+
+#include <gst/gst.h>
+
+/** Why a file couldn't be thumbnailed, the value doubles as exit
+    status of vidthumb */
+enum class ErrorCode
+{
+  kNone = 0,
+
+  /** anything not covered below, e.g. the output can't be written */
+  kFailed = 1,
+
+  /** the file doesn't exist or can't be read */
+  kUnreadable = 2,
+
+  /** the demuxer or video decoder for the file isn't installed */
+  kMissingPlugin = 3,
+
+  /** the file has no video stream */
+  kNoVideo = 4,
+
+  /** the file is truncated, corrupt or not a media file at all */
+  kCorrupt = 5,
+
+  /** the first frame took longer or needed more data than the preroll
+      budget allows */
+  kPrerollBudget = 6,
+
+  /** no frame arrived within the timeout */
+  kTimeout = 7,
+
+  kCancelled = 8
+};
+
+/** Returns the name used in --stats and --serve replies, e.g.
+    "missing-plugin" */
+char const* to_string(ErrorCode code);
+
+/** The outcome of a file, the message is empty on success */
+struct CaptureError
+{
+  ErrorCode code = ErrorCode::kNone;
+  std::string message = {};
+
+  CaptureError() = default;
+  CaptureError(ErrorCode code_, std::string message_) :
+    code(code_),
+    message(std::move(message_))
+  {}
+
+  bool failed() const { return code != ErrorCode::kNone; }
+};
+
+/** GError domain of the errors vidthumb posts on a pipeline bus
+    itself, the error codes are ErrorCode values */
+GQuark vidthumb_error_quark();
+
+/** Categorizes an error posted on the bus by a GStreamer element */
+ErrorCode error_code_from_gerror(GQuark domain, int code);
+
+/** Posts an error with \a code on the bus, the capture engines treat
+    it like any other pipeline error. Can be called from any thread. */
+void post_error(GstElement* element, ErrorCode code, std::string const& message);
+
+/** Returns true when \a message reports a missing decoder for a video
+    stream or a video container, \a description is set to what is
+    missing. Missing decoders for other streams, e.g. audio, don't
+    keep the video from being thumbnailed. */
+bool is_missing_video_plugin(GstMessage* message, std::string* description);
+
+#endif
+
+/* EOF */
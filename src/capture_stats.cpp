@@ -0,0 +1,269 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture_stats.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+
+#include <fmt/format.h>
+
+#include "element_probe.hpp"
+#include "json.hpp"
+
+namespace {
+
+double to_msec(CaptureStats::Clock::duration duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+gpointer new_stats_ref(std::shared_ptr<CaptureStats> const& stats)
+{
+  return new std::shared_ptr<CaptureStats>(stats);
+}
+
+void delete_stats_ref(gpointer data)
+{
+  delete static_cast<std::shared_ptr<CaptureStats>*>(data);
+}
+
+std::shared_ptr<CaptureStats> const& get_stats(gpointer data)
+{
+  return *static_cast<std::shared_ptr<CaptureStats>*>(data);
+}
+
+} // namespace
+
+bool reset_peak_rss()
+{
+  // ru_maxrss can't be reset, VmHWM can
+  std::ofstream out("/proc/self/clear_refs");
+  out << "5";
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+long get_peak_rss()
+{
+  std::ifstream in("/proc/self/status");
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+    {
+      return std::stol(line.substr(6));
+    }
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return -1;
+  }
+  return usage.ru_maxrss;
+}
+
+CaptureStats::CaptureStats() :
+  m_start(Clock::now()),
+  m_mutex(),
+  m_preroll(),
+  m_seeks(),
+  m_convert(),
+  m_receive_frame(),
+  m_save(),
+  m_degraded(),
+  m_bytes_read(0),
+  m_frames_decoded(0),
+  m_frames_delivered(0),
+  m_peak_rss_reset(false)
+{
+}
+
+void
+CaptureStats::reset_peak_rss()
+{
+  m_peak_rss_reset = ::reset_peak_rss();
+}
+
+void
+CaptureStats::watch_pipeline(std::shared_ptr<CaptureStats> const& stats, GstElement* pipeline)
+{
+  // the probes and the signal handler hold a reference of their own,
+  // the pipeline can outlive the object that set it up
+  auto callback = +[](GstBin* /*bin*/, GstBin* /*sub_bin*/, GstElement* element, gpointer user_data) {
+    on_element_added(get_stats(user_data), element);
+  };
+  g_signal_connect_data(pipeline, "deep-element-added", G_CALLBACK(callback),
+                        new_stats_ref(stats),
+                        [](gpointer data, GClosure* /*closure*/) { delete_stats_ref(data); },
+                        static_cast<GConnectFlags>(0));
+}
+
+void
+CaptureStats::on_element_added(std::shared_ptr<CaptureStats> const& stats, GstElement* element)
+{
+  if (is_source(element))
+  {
+    add_source_byte_probe(element, [stats](GstPad* /*pad*/, guint64 size) {
+      stats->m_bytes_read += size;
+      return true;
+    });
+  }
+  else if (is_video_decoder(element))
+  {
+    // counts what goes into the decoder, frames it decodes and then
+    // clips away after an accurate seek never show up downstream
+    GstPad* sinkpad = gst_element_get_static_pad(element, "sink");
+    if (sinkpad)
+    {
+      auto callback = +[](GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) -> GstPadProbeReturn {
+        get_stats(user_data)->m_frames_decoded += 1;
+        return GST_PAD_PROBE_OK;
+      };
+      gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, callback, new_stats_ref(stats), delete_stats_ref);
+      gst_object_unref(sinkpad);
+    }
+  }
+}
+
+void
+CaptureStats::add_preroll(Clock::duration duration)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_preroll = std::max(m_preroll, duration);
+}
+
+void
+CaptureStats::add_seek(Clock::duration duration)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_seeks.push_back(duration);
+}
+
+void
+CaptureStats::add_degraded(int index, std::string const& fallback)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_degraded.emplace_back(index, fallback);
+}
+
+std::vector<CaptureStats::Clock::duration>
+CaptureStats::get_seeks() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_seeks;
+}
+
+CaptureStats::Clock::duration
+CaptureStats::get_convert() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_convert;
+}
+
+CaptureStats::Clock::duration
+CaptureStats::get_receive_frame() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_receive_frame;
+}
+
+void
+CaptureStats::add_convert(Clock::duration duration)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_convert += duration;
+}
+
+void
+CaptureStats::add_receive_frame(Clock::duration duration)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_receive_frame += duration;
+}
+
+void
+CaptureStats::add_save(Clock::duration duration)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_save += duration;
+}
+
+std::string
+CaptureStats::to_json(std::string const& filename, CaptureError const& error) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::string seeks;
+  for(auto const& seek : m_seeks)
+  {
+    seeks += fmt::format("{}{:.3f}", seeks.empty() ? "" : ",", to_msec(seek));
+  }
+
+  std::string degraded;
+  for(auto const& [index, fallback] : m_degraded)
+  {
+    degraded += fmt::format("{}{{\"index\":{},\"fallback\":{}}}",
+                            degraded.empty() ? "" : ",", index, json_quote(fallback));
+  }
+
+  return fmt::format("{{\"file\":{},\"error\":{},\"error_code\":{},"
+                     "\"total_ms\":{:.3f},\"open_to_preroll_ms\":{:.3f},\"seek_latency_ms\":[{}],"
+                     "\"convert_ms\":{:.3f},\"receive_frame_ms\":{:.3f},\"save_ms\":{:.3f},"
+                     "\"bytes_read\":{},\"{}\":{},"
+                     "\"frames_decoded\":{},\"frames_delivered\":{},\"degraded\":[{}]}}",
+                     json_quote(filename),
+                     error.failed() ? json_quote(error.message) : "null",
+                     error.failed() ? json_quote(to_string(error.code)) : "null",
+                     to_msec(Clock::now() - m_start), to_msec(m_preroll), seeks,
+                     to_msec(m_convert), to_msec(m_receive_frame), to_msec(m_save),
+                     m_bytes_read.load(), m_peak_rss_reset ? "peak_rss_kb" : "process_peak_rss_kb", get_peak_rss(),
+                     m_frames_decoded.load(), m_frames_delivered.load(), degraded);
+}
+
+StatsWriter::StatsWriter(std::string const& filename) :
+  m_mutex(),
+  m_file(),
+  m_out(&std::cout)
+{
+  if (filename != "-")
+  {
+    m_file.open(filename, std::ios::app);
+    if (!m_file)
+    {
+      throw std::runtime_error("failed to open " + filename);
+    }
+    m_out = &m_file;
+  }
+}
+
+void
+StatsWriter::write(CaptureStats const& stats, std::string const& filename, CaptureError const& error)
+{
+  std::string const line = stats.to_json(filename, error);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  *m_out << line << std::endl;
+}
+
+/* EOF */
@@ -0,0 +1,148 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_CAPTURE_STATS_HPP
+#define HEADER_CAPTURE_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "capture_error.hpp"
+
+/** Resets the peak resident set size of the process to its current
+    RSS through /proc/self/clear_refs, returns false when the kernel
+    doesn't allow it */
+bool reset_peak_rss();
+
+/** Peak resident set size of the whole process in KiB since the last
+    reset_peak_rss(), -1 if unknown */
+long get_peak_rss();
+
+/** Timings and counters of a single file, collected by the capture
+    engines, the FrameConsumer and the code that saves the thumbnail.
+    All methods can be called from any thread. With --pipelines the
+    pipelines of a file share one CaptureStats. */
+class CaptureStats final
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  Clock::time_point const m_start;
+
+  mutable std::mutex m_mutex;
+  Clock::duration m_preroll;
+  std::vector<Clock::duration> m_seeks;
+  Clock::duration m_convert;
+  Clock::duration m_receive_frame;
+  Clock::duration m_save;
+
+  /** position index and the SeekFallback it took */
+  std::vector<std::pair<int, std::string>> m_degraded;
+
+  std::atomic<guint64> m_bytes_read;
+  std::atomic<int> m_frames_decoded;
+  std::atomic<int> m_frames_delivered;
+
+  /** true when the peak RSS was reset for this file, see
+      reset_peak_rss() */
+  bool m_peak_rss_reset;
+
+public:
+  CaptureStats();
+
+  /** Counts the bytes leaving the source element and the buffers
+      entering the video decoder of \a pipeline, both are only created
+      once the pipeline starts, so this must be called before that */
+  static void watch_pipeline(std::shared_ptr<CaptureStats> const& stats, GstElement* pipeline);
+
+  /** Makes the peak RSS cover this file alone, only meaningful when
+      no other file is processed at the same time. Without it, or when
+      the reset fails, the process wide peak is reported as
+      process_peak_rss_kb instead of peak_rss_kb. */
+  void reset_peak_rss();
+
+  /** Time from opening the file until the first frame, with several
+      pipelines the slowest one counts */
+  void add_preroll(Clock::duration duration);
+
+  /** Time from requesting a seek or step until its frame arrived */
+  void add_seek(Clock::duration duration);
+
+  /** Position \a index missed its seek deadline and got \a fallback
+      instead, see SeekFallback */
+  void add_degraded(int index, std::string const& fallback);
+
+  /** Time spent turning buffers into Cairo surfaces */
+  void add_convert(Clock::duration duration);
+
+  /** Time spent in Thumbnailer::receive_frame() */
+  void add_receive_frame(Clock::duration duration);
+
+  /** Time spent encoding and saving the thumbnail */
+  void add_save(Clock::duration duration);
+
+  void add_frame_delivered() { m_frames_delivered += 1; }
+
+  std::vector<Clock::duration> get_seeks() const;
+  Clock::duration get_convert() const;
+  Clock::duration get_receive_frame() const;
+  int get_frames_delivered() const { return m_frames_delivered; }
+
+  /** Returns the stats as a single line JSON object, error and
+      error_code are null when \a error isn't a failure */
+  std::string to_json(std::string const& filename, CaptureError const& error) const;
+
+private:
+  static void on_element_added(std::shared_ptr<CaptureStats> const& stats, GstElement* element);
+
+private:
+  CaptureStats(const CaptureStats&) = delete;
+  CaptureStats& operator=(const CaptureStats&) = delete;
+};
+
+/** Appends CaptureStats as JSON lines to a file, '-' for stdout,
+    shared by all workers */
+class StatsWriter final
+{
+private:
+  std::mutex m_mutex;
+  std::ofstream m_file;
+  std::ostream* m_out;
+
+public:
+  StatsWriter(std::string const& filename);
+
+  void write(CaptureStats const& stats, std::string const& filename, CaptureError const& error);
+
+private:
+  StatsWriter(const StatsWriter&) = delete;
+  StatsWriter& operator=(const StatsWriter&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -23,12 +23,47 @@
 #include <filesystem>
 #include <logmich/log.hpp>
 
-DirectoryThumbnailer::DirectoryThumbnailer(int num) :
+#include "encoder_pool.hpp"
+#include "image_writer.hpp"
+#include "timestamp_renderer.hpp"
+#include "video_frame.hpp"
+
+namespace {
+
+// two encoders keep up with seeking in most cases, four queued frames
+// absorb the jitter without holding on to much memory
+constexpr int kEncoderThreads = 2;
+constexpr size_t kMaxPendingFrames = 4;
+
+} // namespace
+
+DirectoryThumbnailer::DirectoryThumbnailer(int num, std::shared_ptr<TimestampRenderer const> timestamps) :
   m_num(num),
-  m_thumbnails()
+  m_timestamps(std::move(timestamps)),
+  m_thumbnails(),
+  m_directory(),
+  m_extension(),
+  m_encoder_pool()
 {
 }
 
+DirectoryThumbnailer::~DirectoryThumbnailer()
+{
+}
+
+std::filesystem::path
+DirectoryThumbnailer::create_directory(const std::string& directory_str)
+{
+  std::filesystem::path directory(directory_str);
+
+  if (!std::filesystem::is_directory(directory))
+  {
+    std::filesystem::create_directories(directory);
+  }
+
+  return directory;
+}
+
 std::vector<gint64>
 DirectoryThumbnailer::get_thumbnail_pos(gint64 duration)
 {
@@ -42,27 +77,52 @@ DirectoryThumbnailer::get_thumbnail_pos(gint64 duration)
 }
 
 void
-DirectoryThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos)
+DirectoryThumbnailer::prepare(const std::string& directory_str, ImageWriter const& writer)
 {
-  m_thumbnails.push_back({img, pos});
+  // fail before any decoding happens when the directory can't be created
+  m_directory = create_directory(directory_str);
+  m_extension = writer.get_extension();
+  m_encoder_pool = std::make_unique<EncoderPool>(writer, kEncoderThreads, kMaxPendingFrames);
 }
 
 void
-DirectoryThumbnailer::save(const std::string& directory_str)
+DirectoryThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int /*index*/)
 {
-  std::filesystem::path directory(directory_str);
+  Cairo::RefPtr<Cairo::ImageSurface> image = copy_surface(img);
+  if (m_timestamps)
+  {
+    m_timestamps->render(image, 6, 14, pos);
+  }
 
-  if (!std::filesystem::is_directory(directory))
+  if (m_encoder_pool)
+  {
+    // blocks while the encoders are behind
+    m_encoder_pool->submit(std::move(image),
+                           (m_directory / fmt::format("thumb{:020d}.{}", pos, m_extension)).string());
+  }
+  else
   {
-    std::filesystem::create_directory(directory);
+    m_thumbnails.push_back({std::move(image), pos});
   }
+}
+
+void
+DirectoryThumbnailer::save(const std::string& directory_str, ImageWriter const& writer)
+{
+  if (m_encoder_pool)
+  {
+    m_encoder_pool->finish();
+    return;
+  }
+
+  std::filesystem::path const directory = create_directory(directory_str);
 
   for(auto& thumb : m_thumbnails)
   {
-    std::filesystem::path filename = directory / fmt::format("thumb{:020d}.png", thumb.pos);
+    std::filesystem::path filename = directory / fmt::format("thumb{:020d}.{}", thumb.pos, writer.get_extension());
 
     log_info("writing thumbnail to {}", filename.string());
-    thumb.image->write_to_png(filename.string());
+    writer.write(thumb.image, filename.string());
   }
 }
 
@@ -21,8 +21,17 @@
 
 #include "thumbnailer.hpp"
 
+#include <filesystem>
+#include <memory>
 #include <vector>
 
+class EncoderPool;
+class TimestampRenderer;
+
+/** Writes every frame to a file of its own. After prepare() the
+    frames are handed to a small encoder pool as they arrive, so only a
+    few of them are held in memory and encoding overlaps with seeking,
+    without it they are collected and written by save(). */
 class DirectoryThumbnailer final : public Thumbnailer
 {
 private:
@@ -34,18 +43,27 @@ private:
 
 private:
   int m_num;
+  std::shared_ptr<TimestampRenderer const> m_timestamps;
   std::vector<Thumbnail> m_thumbnails;
 
+  std::filesystem::path m_directory;
+  std::string m_extension;
+  std::unique_ptr<EncoderPool> m_encoder_pool;
+
 public:
-  DirectoryThumbnailer(int num);
+  DirectoryThumbnailer(int num, std::shared_ptr<TimestampRenderer const> timestamps = {});
+  ~DirectoryThumbnailer() override;
 
   std::vector<gint64> get_thumbnail_pos(gint64 duration) override;
-  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos) override;
-  void save(const std::string& filename) override;
+  void prepare(const std::string& filename, ImageWriter const& writer) override;
+  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index) override;
+  void save(const std::string& filename, ImageWriter const& writer) override;
 
 private:
   DirectoryThumbnailer(const DirectoryThumbnailer&) = delete;
   DirectoryThumbnailer& operator=(const DirectoryThumbnailer&) = delete;
+
+  static std::filesystem::path create_directory(const std::string& directory);
 };
 
 #endif
@@ -0,0 +1,77 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "element_probe.hpp"
+
+#include <string.h>
+
+namespace {
+
+const gchar* get_klass(GstElement* element)
+{
+  GstElementFactory* factory = gst_element_get_factory(element);
+  return factory ? gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS) : nullptr;
+}
+
+} // namespace
+
+bool is_source(GstElement* element)
+{
+  const gchar* klass = get_klass(element);
+  return klass && strstr(klass, "Source");
+}
+
+bool is_video_decoder(GstElement* element)
+{
+  const gchar* klass = get_klass(element);
+  return klass && strstr(klass, "Decoder") && strstr(klass, "Video");
+}
+
+void add_source_byte_probe(GstElement* element, SourceByteCallback callback)
+{
+  if (!is_source(element))
+  {
+    return;
+  }
+
+  GstPad* srcpad = gst_element_get_static_pad(element, "src");
+  if (!srcpad)
+  {
+    return;
+  }
+
+  auto probe = +[](GstPad* pad, GstPadProbeInfo* info, gpointer user_data) -> GstPadProbeReturn {
+    guint64 size = 0;
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER)
+    {
+      size = gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info));
+    }
+    else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    {
+      size = gst_buffer_list_calculate_size(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+    }
+    return (*static_cast<SourceByteCallback*>(user_data))(pad, size) ? GST_PAD_PROBE_OK : GST_PAD_PROBE_REMOVE;
+  };
+  gst_pad_add_probe(srcpad,
+                    static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                    probe, new SourceByteCallback(std::move(callback)),
+                    [](gpointer data) { delete static_cast<SourceByteCallback*>(data); });
+  gst_object_unref(srcpad);
+}
+
+/* EOF */
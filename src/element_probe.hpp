@@ -0,0 +1,44 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_ELEMENT_PROBE_HPP
+#define HEADER_ELEMENT_PROBE_HPP
+
+#include <functional>
+
+#include <gst/gst.h>
+
+/** Returns true when the factory klass of \a element marks it as a
+    source, e.g. filesrc */
+bool is_source(GstElement* element);
+
+/** Returns true when the factory klass of \a element marks it as a
+    video decoder */
+bool is_video_decoder(GstElement* element);
+
+/** Called from the streaming thread with the size of every buffer or
+    buffer list, returning false removes the probe */
+using SourceByteCallback = std::function<bool (GstPad* pad, guint64 size)>;
+
+/** Reports the bytes the "src" pad of \a element hands out, in push and
+    pull mode, does nothing when \a element isn't a source */
+void add_source_byte_probe(GstElement* element, SourceByteCallback callback);
+
+#endif
+
+/* EOF */
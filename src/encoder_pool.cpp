@@ -0,0 +1,132 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "encoder_pool.hpp"
+
+#include <algorithm>
+#include <logmich/log.hpp>
+
+#include "tracer.hpp"
+
+EncoderPool::EncoderPool(ImageWriter const& writer, int num_threads, size_t max_pending) :
+  m_writer(writer),
+  m_max_pending(std::max<size_t>(1, max_pending)),
+  m_mutex(),
+  m_job_available(),
+  m_slot_available(),
+  m_jobs(),
+  m_finishing(false),
+  m_error(),
+  m_threads()
+{
+  for(int i = 0; i < std::max(1, num_threads); ++i)
+  {
+    m_threads.emplace_back(&EncoderPool::run, this);
+  }
+}
+
+EncoderPool::~EncoderPool()
+{
+  join();
+}
+
+void
+EncoderPool::submit(Cairo::RefPtr<Cairo::ImageSurface> image, std::string filename)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  m_slot_available.wait(lock, [this]{ return m_jobs.size() < m_max_pending || m_error; });
+  if (m_error)
+  {
+    return;
+  }
+
+  m_jobs.push_back(Job{std::move(image), std::move(filename)});
+  m_job_available.notify_one();
+}
+
+void
+EncoderPool::finish()
+{
+  join();
+
+  if (m_error)
+  {
+    std::rethrow_exception(m_error);
+  }
+}
+
+void
+EncoderPool::join()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finishing = true;
+  }
+  m_job_available.notify_all();
+
+  for(auto& thread : m_threads)
+  {
+    thread.join();
+  }
+  m_threads.clear();
+}
+
+void
+EncoderPool::run()
+{
+  Tracer::set_thread_name("encoder");
+
+  while(true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_job_available.wait(lock, [this]{ return !m_jobs.empty() || m_finishing; });
+      if (m_jobs.empty())
+      {
+        return;
+      }
+
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+    m_slot_available.notify_one();
+
+    try
+    {
+      log_info("writing thumbnail to {}", job.filename);
+      TraceSpan span("encode");
+      span.set_arg("file", job.filename);
+      m_writer.write(job.image, job.filename);
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (!m_error)
+      {
+        m_error = std::current_exception();
+      }
+      // nobody is going to wait for the remaining images
+      m_jobs.clear();
+      m_slot_available.notify_all();
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,87 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_ENCODER_POOL_HPP
+#define HEADER_ENCODER_POOL_HPP
+
+#include <cairomm/cairomm.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image_writer.hpp"
+
+/** A fixed number of threads encoding and writing images in the
+    background. At most max_pending images wait in the queue, submit()
+    blocks beyond that, which keeps memory bounded when decoding is
+    faster than encoding.
+
+    Cairo::RefPtr isn't thread-safe, submit() takes the only reference
+    to the image and hands it over to the encoder thread. */
+class EncoderPool final
+{
+private:
+  struct Job
+  {
+    Cairo::RefPtr<Cairo::ImageSurface> image;
+    std::string filename;
+  };
+
+private:
+  ImageWriter m_writer;
+  size_t m_max_pending;
+
+  std::mutex m_mutex;
+  std::condition_variable m_job_available;
+  std::condition_variable m_slot_available;
+  std::deque<Job> m_jobs;
+  bool m_finishing;
+  std::exception_ptr m_error;
+
+  std::vector<std::thread> m_threads;
+
+public:
+  EncoderPool(ImageWriter const& writer, int num_threads, size_t max_pending);
+  ~EncoderPool();
+
+  /** Queues \a image for writing to \a filename. Once writing an
+      image has failed further images are dropped, so that this never
+      throws into the frame consumer thread, finish() reports the
+      error. */
+  void submit(Cairo::RefPtr<Cairo::ImageSurface> image, std::string filename);
+
+  /** Waits until all images are written and stops the threads, throws
+      the first error that occurred */
+  void finish();
+
+private:
+  void run();
+  void join();
+
+private:
+  EncoderPool(const EncoderPool&) = delete;
+  EncoderPool& operator=(const EncoderPool&) = delete;
+};
+
+#endif
+
+/* EOF */
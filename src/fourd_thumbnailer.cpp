@@ -18,10 +18,20 @@
 
 #include "fourd_thumbnailer.hpp"
 
-FourdThumbnailer::FourdThumbnailer(int slices) :
+#include <algorithm>
+
+#include "blit.hpp"
+#include "image_writer.hpp"
+#include "timestamp_renderer.hpp"
+
+FourdThumbnailer::FourdThumbnailer(int slices, int slice_width,
+                                   std::shared_ptr<TimestampRenderer const> timestamps) :
   m_buffer(),
-  m_slices(slices),
-  m_count(0)
+  m_slices(std::max(1, slices)),
+  m_slice_width(slice_width),
+  m_count(0),
+  m_timestamps(std::move(timestamps)),
+  m_label_end(0)
 {
 }
 
@@ -37,35 +47,60 @@ FourdThumbnailer::get_thumbnail_pos(gint64 duration)
 }
 
 void
-FourdThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos)
+FourdThumbnailer::set_frame_size(int width, int height)
+{
+  if (m_slice_width <= 0)
+  {
+    m_slice_width = std::max(1, width * 10 / m_slices);
+  }
+
+  m_buffer = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, m_slice_width * m_slices, height);
+}
+
+void
+FourdThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index)
 {
   if (!m_buffer)
   {
-    m_buffer = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24,
-                                           img->get_width() * 10,
-                                           img->get_height());
+    set_frame_size(img->get_width(), img->get_height());
   }
 
-  Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(m_buffer);
+  if (index < 0 || index >= m_slices)
+  {
+    return;
+  }
 
-  int slice_width = m_buffer->get_width() / m_slices;
-  cr->rectangle((slice_width * m_count), 0,
-                slice_width, m_buffer->get_height());
-  cr->clip();
+  // the source columns move from the left edge of the frame in the
+  // first slice to the right edge in the last one, slices wider than
+  // the frame are left black where the frame doesn't reach
+  int const src_x = (m_slices > 1)
+    ? index * (img->get_width() - m_slice_width) / (m_slices - 1)
+    : (img->get_width() - m_slice_width) / 2;
+  blit_region(img, src_x, 0, m_buffer, index * m_slice_width, 0, m_slice_width, m_buffer->get_height());
 
-  cr->begin_new_path();
-  cr->set_source(img, m_count * (m_buffer->get_width() - img->get_width()) / (m_slices-1), 0);
-  cr->paint();
+  if (m_timestamps)
+  {
+    // label the slice at its right edge, so that the text only covers
+    // slices that are already painted, and skip slices until there is
+    // room for the next label
+    int const right = m_slice_width * (index + 1);
+    int const left = right - m_timestamps->get_width(pos);
+    if (left >= m_label_end)
+    {
+      m_timestamps->render(m_buffer, left, m_buffer->get_height() - 6, pos);
+      m_label_end = right + 12;
+    }
+  }
 
   m_count += 1;
 }
 
 void
-FourdThumbnailer::save(const std::string& filename)
+FourdThumbnailer::save(const std::string& filename, ImageWriter const& writer)
 {
   if (m_buffer)
   {
-    m_buffer->write_to_png(filename);
+    writer.write(m_buffer, filename);
   }
 }
 
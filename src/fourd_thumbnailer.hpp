@@ -21,19 +21,35 @@
 
 #include "thumbnailer.hpp"
 
+#include <memory>
+
+class TimestampRenderer;
+
+/** Builds a slit-scan of the video: slice k of the canvas shows a
+    narrow band of columns from frame k, taken further to the right in
+    each frame, so the slices sweep once across the picture. Only those
+    columns are copied, the frames aren't kept. */
 class FourdThumbnailer : public Thumbnailer
 {
 private:
   Cairo::RefPtr<Cairo::ImageSurface> m_buffer;
   int m_slices;
+
+  /** width of a slice, 0 for ten frame widths spread over all slices */
+  int m_slice_width;
   int m_count;
+  std::shared_ptr<TimestampRenderer const> m_timestamps;
+  int m_label_end;
 
 public:
-  FourdThumbnailer(int slices);
+  FourdThumbnailer(int slices, int slice_width = 0,
+                   std::shared_ptr<TimestampRenderer const> timestamps = {});
 
   std::vector<gint64> get_thumbnail_pos(gint64 duration) override;
-  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos) override;
-  void save(const std::string& filename) override;
+  void set_frame_size(int width, int height) override;
+  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index) override;
+  void save(const std::string& filename, ImageWriter const& writer) override;
+  Cairo::RefPtr<Cairo::ImageSurface> get_image() const override { return m_buffer; }
 
 private:
   FourdThumbnailer(const FourdThumbnailer&);
@@ -0,0 +1,150 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frame_consumer.hpp"
+
+#include <logmich/log.hpp>
+#include <stdexcept>
+
+#include "capture_stats.hpp"
+#include "thumbnailer.hpp"
+#include "tracer.hpp"
+#include "video_frame.hpp"
+
+FrameConsumer::FrameConsumer(Thumbnailer& thumbnailer,
+                             std::optional<int> width, std::optional<int> height, bool keep_aspect_ratio,
+                             size_t capacity, std::shared_ptr<CaptureStats> stats) :
+  m_thumbnailer(thumbnailer),
+  m_width(width),
+  m_height(height),
+  m_keep_aspect_ratio(keep_aspect_ratio),
+  m_queue(capacity),
+  m_stats(std::move(stats)),
+  m_mutex(),
+  m_error(),
+  m_thread()
+{
+  m_thread = std::thread(&FrameConsumer::run, this);
+}
+
+FrameConsumer::~FrameConsumer()
+{
+  finish();
+}
+
+void
+FrameConsumer::push(Glib::RefPtr<Gst::Buffer> buffer, Glib::RefPtr<Gst::Caps> caps,
+                    gint64 pos, std::vector<int> indices)
+{
+  if (!m_queue.push(Item{std::move(buffer), std::move(caps), pos, std::move(indices)}))
+  {
+    log_debug("frame consumer finished, dropping frame at {}", pos);
+  }
+}
+
+void
+FrameConsumer::skip(gint64 pos, int index)
+{
+  if (!m_queue.push(Item{{}, {}, pos, {index}}))
+  {
+    log_debug("frame consumer finished, dropping skip at {}", pos);
+  }
+}
+
+void
+FrameConsumer::finish()
+{
+  m_queue.close();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+std::string
+FrameConsumer::get_error()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_error;
+}
+
+void
+FrameConsumer::run()
+{
+  Tracer::set_thread_name("frame consumer");
+
+  Item item;
+  while(m_queue.pop(item))
+  {
+    try
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error.empty())
+        {
+          item = Item();
+          continue;
+        }
+      }
+
+      if (!item.buffer)
+      {
+        for(int index : item.indices)
+        {
+          m_thumbnailer.skip_frame(item.pos, index);
+        }
+      }
+      else
+      {
+        auto const start = CaptureStats::Clock::now();
+        std::optional<VideoFrame> frame;
+        {
+          TraceSpan span("convert");
+          span.set_arg("pos", item.pos);
+          frame.emplace(item.buffer, item.caps, m_width, m_height, m_keep_aspect_ratio);
+        }
+        auto const converted = CaptureStats::Clock::now();
+
+        for(int index : item.indices)
+        {
+          TraceSpan span("receive_frame");
+          span.set_arg("index", index);
+          m_thumbnailer.receive_frame(frame->get_surface(), item.pos, index);
+        }
+
+        if (m_stats)
+        {
+          m_stats->add_convert(converted - start);
+          m_stats->add_receive_frame(CaptureStats::Clock::now() - converted);
+          m_stats->add_frame_delivered();
+        }
+      }
+    }
+    catch(std::exception const& err)
+    {
+      log_error("failed to process frame at {}: {}", item.pos, err.what());
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_error = err.what();
+    }
+
+    // let go of the buffer right away, decoders often have only a few
+    item = Item();
+  }
+}
+
+/* EOF */
@@ -0,0 +1,105 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_FRAME_CONSUMER_HPP
+#define HEADER_FRAME_CONSUMER_HPP
+
+#include <gstreamermm.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.hpp"
+
+class CaptureStats;
+class Thumbnailer;
+
+/** Converts captured buffers with VideoFrame and hands them to
+    Thumbnailer::receive_frame() on a thread of its own, so that the
+    streaming thread can move on to the next position while the
+    previous frame is still being composited.
+
+    push() is called by the streaming thread only and keeps a reference
+    to the buffer, the frames are delivered in the order they were
+    pushed. When the queue is full push() blocks, which stalls decoding
+    instead of letting decoded frames pile up. */
+class FrameConsumer final
+{
+private:
+  struct Item
+  {
+    /** null for positions that were skipped */
+    Glib::RefPtr<Gst::Buffer> buffer;
+    Glib::RefPtr<Gst::Caps> caps;
+    gint64 pos;
+
+    /** positions the frame stands for, more than one when the
+        positions are closer together than the frames */
+    std::vector<int> indices;
+  };
+
+private:
+  Thumbnailer& m_thumbnailer;
+  std::optional<int> m_width;
+  std::optional<int> m_height;
+  bool m_keep_aspect_ratio;
+  SPSCQueue<Item> m_queue;
+  std::shared_ptr<CaptureStats> m_stats;
+
+  std::mutex m_mutex;
+  std::string m_error;
+
+  std::thread m_thread;
+
+public:
+  /** \a width, \a height and \a keep_aspect_ratio are passed on to
+      VideoFrame, \a stats may be nullptr */
+  FrameConsumer(Thumbnailer& thumbnailer,
+                std::optional<int> width, std::optional<int> height, bool keep_aspect_ratio,
+                size_t capacity, std::shared_ptr<CaptureStats> stats);
+  ~FrameConsumer();
+
+  void push(Glib::RefPtr<Gst::Buffer> buffer, Glib::RefPtr<Gst::Caps> caps,
+            gint64 pos, std::vector<int> indices);
+
+  /** Queues Thumbnailer::skip_frame() for \a index, in order with the
+      frames */
+  void skip(gint64 pos, int index);
+
+  /** Waits until all queued frames have been delivered and stops the
+      thread, later push() calls drop their frame */
+  void finish();
+
+  /** Returns the first error thrown by the thumbnailer, frames after
+      it are dropped */
+  std::string get_error();
+
+private:
+  void run();
+
+private:
+  FrameConsumer(const FrameConsumer&) = delete;
+  FrameConsumer& operator=(const FrameConsumer&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -18,24 +18,91 @@
 
 #include "grid_thumbnailer.hpp"
 
-#include <fmt/format.h>
 #include <gst/gst.h>
 #include <iostream>
+#include <logmich/log.hpp>
 
-GridThumbnailer::GridThumbnailer(int cols, int rows) :
+#include "blit.hpp"
+#include "image_writer.hpp"
+#include "timestamp_renderer.hpp"
+
+namespace {
+
+/** Marks a cell whose position couldn't be captured, distinct from
+    the black of a dark frame or a cell that never got anything */
+void draw_placeholder(Cairo::RefPtr<Cairo::ImageSurface> const& surface,
+                      int x, int y, int width, int height)
+{
+  Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(surface);
+  cr->rectangle(x, y, width, height);
+  cr->clip();
+
+  cr->set_source_rgb(0.25, 0.25, 0.25);
+  cr->paint();
+
+  cr->set_source_rgb(0.4, 0.4, 0.4);
+  cr->set_line_width(2.0);
+  cr->move_to(x, y);
+  cr->line_to(x + width, y + height);
+  cr->move_to(x + width, y);
+  cr->line_to(x, y + height);
+  cr->stroke();
+}
+
+} // namespace
+
+GridThumbnailer::GridThumbnailer(int cols, int rows, bool stream,
+                                 std::shared_ptr<TimestampRenderer const> timestamps) :
   m_buffer(),
   m_cols(cols),
   m_rows(rows),
-  m_image_count(0)
+  m_cell_width(0),
+  m_cell_height(0),
+  m_image_count(0),
+  m_timestamps(std::move(timestamps)),
+  m_stream(stream),
+  m_stream_filename(),
+  m_stream_writer(),
+  m_output(),
+  m_bands(),
+  m_next_row(0),
+  m_error()
 {
 }
 
 void
-GridThumbnailer::save(const std::string& filename)
+GridThumbnailer::prepare(const std::string& filename, ImageWriter const& writer)
 {
-  if (m_buffer)
+  if (m_stream)
+  {
+    m_stream_filename = filename;
+    m_stream_writer = writer;
+  }
+}
+
+void
+GridThumbnailer::save(const std::string& filename, ImageWriter const& writer)
+{
+  if (m_error)
+  {
+    std::rethrow_exception(m_error);
+  }
+
+  if (m_output)
+  {
+    // cells that never arrived stay black
+    for(int row = m_next_row; row < m_rows; ++row)
+    {
+      get_band(row);
+    }
+    write_bands(true);
+
+    m_output->finish();
+    m_output.reset();
+  }
+  else if (m_buffer)
   {
-    m_buffer->write_to_png(filename);
+    writer.write(m_buffer, filename);
   }
 }
 
@@ -52,50 +119,145 @@ GridThumbnailer::get_thumbnail_pos(gint64 duration)
 }
 
 void
-GridThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos)
+GridThumbnailer::set_frame_size(int width, int height)
 {
-  if (!m_buffer)
+  m_cell_width = width;
+  m_cell_height = height;
+
+  if (!m_stream_filename.empty())
   {
-    m_buffer = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24,
-                                           img->get_width()  * m_cols,
-                                           img->get_height() * m_rows);
+    m_output = m_stream_writer.open_stream(m_stream_filename, m_cell_width * m_cols, m_cell_height * m_rows);
+    if (m_output)
+    {
+      return;
+    }
+
+    log_warn("{}: format can't be streamed, compositing the whole sheet", m_stream_filename);
+    m_stream_filename.clear();
   }
 
-  int x = (m_image_count % m_cols) * img->get_width();
-  int y = (m_image_count / m_cols) * img->get_height();
+  // a fresh image surface is all zero, which is black for RGB24
+  m_buffer = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24,
+                                         m_cell_width * m_cols,
+                                         m_cell_height * m_rows);
+}
 
-  Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(m_buffer);
-  cr->set_source(img, x, y);
-  cr->paint();
+void
+GridThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index)
+{
+  if (m_cell_width == 0)
+  {
+    set_frame_size(img->get_width(), img->get_height());
+  }
+
+  fill_cell(pos, index, [this, &img](Cairo::RefPtr<Cairo::ImageSurface> const& surface, int x, int y) {
+    blit_letterboxed(img, surface, x, y, m_cell_width, m_cell_height);
+  });
+}
+
+void
+GridThumbnailer::skip_frame(gint64 pos, int index)
+{
+  if (m_cell_width == 0)
+  {
+    // no frame size to draw a placeholder with
+    return;
+  }
+
+  fill_cell(pos, index, [this](Cairo::RefPtr<Cairo::ImageSurface> const& surface, int x, int y) {
+    draw_placeholder(surface, x, y, m_cell_width, m_cell_height);
+  });
+}
+
+void
+GridThumbnailer::fill_cell(gint64 pos, int index,
+                           std::function<void (Cairo::RefPtr<Cairo::ImageSurface> const&, int, int)> const& draw)
+{
+  if (index < 0 || index >= m_cols * m_rows)
+  {
+    return;
+  }
+
+  int const col = index % m_cols;
+  int const row = index / m_cols;
+  int const x = col * m_cell_width;
+
+  if (m_output)
+  {
+    if (row < m_next_row)
+    {
+      // the band has already been written out
+      return;
+    }
+
+    Band& band = get_band(row);
+    draw(band.image, x, 0);
+    if (m_timestamps)
+    {
+      m_timestamps->render(band.image, x + 6, 14, pos);
+    }
+
+    if (!band.filled[col])
+    {
+      band.filled[col] = true;
+      band.count += 1;
+    }
 
-  cr->set_font_size(12.0);
-  cr->select_font_face ("Sans", Cairo::FONT_SLANT_NORMAL, Cairo::FONT_WEIGHT_NORMAL);
-  Cairo::FontOptions font_options;
-  font_options.set_hint_metrics (Cairo::HINT_METRICS_ON);
-  font_options.set_hint_style(Cairo::HINT_STYLE_FULL);
-  font_options.set_antialias(Cairo::ANTIALIAS_GRAY);
-  cr->set_font_options(font_options);
-
-  int hour = static_cast<int>(pos / (GST_SECOND * 60 * 60));
-  int min  = static_cast<int>(pos / (GST_SECOND * 60)) % 60;
-  int sec  = static_cast<int>(pos / GST_SECOND) % 60;
-  std::string time_str = fmt::format("{:02d}:{:02d}:{:02d}", hour, min, sec);
-
-  int outline = 1;
-  cr->set_source_rgb(0,0,0);
-  for(int iy = -outline; iy <= outline; ++iy)
+    // keep the first error for save(), where it ends up in the output
+    // file's error message, and drop the remaining frames
+    try
+    {
+      write_bands(false);
+    }
+    catch(std::exception const& err)
+    {
+      log_error("{}", err.what());
+      m_error = std::current_exception();
+      m_output.reset();
+      m_bands.clear();
+    }
+  }
+  else if (m_buffer)
   {
-    for(int ix = -outline; ix <= outline; ++ix)
+    int const y = row * m_cell_height;
+
+    draw(m_buffer, x, y);
+
+    if (m_timestamps)
     {
-      cr->move_to(x+6 + ix, y+14 + iy);
-      cr->show_text(time_str);
+      m_timestamps->render(m_buffer, x + 6, y + 14, pos);
     }
   }
-  cr->set_source_rgb(1,1,1);
-  cr->move_to(x+6, y+14);
-  cr->show_text(time_str);
 
   m_image_count += 1;
 }
 
+GridThumbnailer::Band&
+GridThumbnailer::get_band(int row)
+{
+  auto it = m_bands.find(row);
+  if (it == m_bands.end())
+  {
+    Band band;
+    band.image = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, m_cell_width * m_cols, m_cell_height);
+    band.filled.resize(m_cols, false);
+    band.count = 0;
+    it = m_bands.emplace(row, std::move(band)).first;
+  }
+  return it->second;
+}
+
+void
+GridThumbnailer::write_bands(bool incomplete)
+{
+  auto it = m_bands.begin();
+  while(it != m_bands.end() && it->first == m_next_row &&
+        (incomplete || it->second.count == m_cols))
+  {
+    m_output->write_rows(it->second.image, 0, m_cell_height);
+    m_next_row += 1;
+    it = m_bands.erase(it);
+  }
+}
+
 /* EOF */
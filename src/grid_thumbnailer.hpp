@@ -21,20 +21,82 @@
 
 #include "thumbnailer.hpp"
 
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "image_writer.hpp"
+
+class TimestampRenderer;
+
+/** Composites the frames into a cols x rows sheet. The sheet is sized
+    by set_frame_size(), or by the first frame when that isn't called,
+    and frames are blitted into the cell of their position index,
+    letterboxed when their size doesn't match the cell.
+
+    In streaming mode only the rows of cells that are still incomplete
+    are held in memory, each row is encoded as soon as all its cells
+    have arrived and the rows before it have been written, so peak
+    memory is about one row of cells instead of the whole sheet. This
+    needs prepare() and a format that ImageWriter::open_stream()
+    supports, otherwise the whole sheet is composited as usual.
+
+    Skipped positions get a crossed out gray placeholder, cells that
+    never got anything stay black. */
 class GridThumbnailer : public Thumbnailer
 {
+private:
+  /** A row of cells waiting to be encoded */
+  struct Band
+  {
+    Cairo::RefPtr<Cairo::ImageSurface> image;
+    std::vector<bool> filled;
+    int count;
+  };
+
 private:
   Cairo::RefPtr<Cairo::ImageSurface> m_buffer;
   int m_cols;
   int m_rows;
+  int m_cell_width;
+  int m_cell_height;
   int m_image_count;
+  std::shared_ptr<TimestampRenderer const> m_timestamps;
+
+  bool m_stream;
+  std::string m_stream_filename;
+  ImageWriter m_stream_writer;
+  std::unique_ptr<ImageStream> m_output;
+  std::map<int, Band> m_bands;
+  int m_next_row;
+  std::exception_ptr m_error;
 
 public:
-  GridThumbnailer(int cols, int rows);
+  GridThumbnailer(int cols, int rows, bool stream = false,
+                  std::shared_ptr<TimestampRenderer const> timestamps = {});
 
-  void save(const std::string& filename) override;
+  void prepare(const std::string& filename, ImageWriter const& writer) override;
+  void save(const std::string& filename, ImageWriter const& writer) override;
   std::vector<gint64> get_thumbnail_pos(gint64 duration) override;
-  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos) override;
+  void set_frame_size(int width, int height) override;
+  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index) override;
+  void skip_frame(gint64 pos, int index) override;
+  Cairo::RefPtr<Cairo::ImageSurface> get_image() const override { return m_buffer; }
+
+private:
+  /** Fills the cell of \a index with \a draw, which gets the surface
+      and the top left corner of the cell, and timestamps it */
+  void fill_cell(gint64 pos, int index,
+                 std::function<void (Cairo::RefPtr<Cairo::ImageSurface> const&, int, int)> const& draw);
+
+  Band& get_band(int row);
+
+  /** Encodes the bands that are next in line, \a incomplete ones too
+      when set */
+  void write_bands(bool incomplete);
 };
 
 #endif
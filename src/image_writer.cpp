@@ -0,0 +1,230 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "image_writer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <glib.h>
+#include <logmich/log.hpp>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "jpeg_writer.hpp"
+#include "png_writer.hpp"
+#include "qoi_writer.hpp"
+#include "webp_writer.hpp"
+
+ImageFormat
+image_format_from_string(const std::string& name)
+{
+  if (name == "png")
+  {
+    return ImageFormat::kPNG;
+  }
+  else if (name == "jpeg" || name == "jpg")
+  {
+    return ImageFormat::kJPEG;
+  }
+  else if (name == "webp")
+  {
+    return ImageFormat::kWebP;
+  }
+  else if (name == "qoi")
+  {
+    return ImageFormat::kQOI;
+  }
+  else
+  {
+    throw std::runtime_error("unknown image format: " + name);
+  }
+}
+
+std::optional<ImageFormat>
+image_format_from_filename(const std::string& filename)
+{
+  std::string ext = std::filesystem::path(filename).extension().string();
+  if (ext.empty())
+  {
+    return {};
+  }
+
+  ext = ext.substr(1);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+  try
+  {
+    return image_format_from_string(ext);
+  }
+  catch(std::exception const&)
+  {
+    return {};
+  }
+}
+
+std::string
+get_extension(ImageFormat format)
+{
+  switch(format)
+  {
+    case ImageFormat::kJPEG:
+      return "jpg";
+
+    case ImageFormat::kWebP:
+      return "webp";
+
+    case ImageFormat::kQOI:
+      return "qoi";
+
+    case ImageFormat::kPNG:
+    default:
+      return "png";
+  }
+}
+
+ImageWriter::ImageWriter(ImageWriterOptions const& opts) :
+  m_opts(opts)
+{
+}
+
+ImageFormat
+ImageWriter::get_format(const std::string& filename) const
+{
+  if (m_opts.format)
+  {
+    return *m_opts.format;
+  }
+  else
+  {
+    return image_format_from_filename(filename).value_or(ImageFormat::kPNG);
+  }
+}
+
+std::string
+ImageWriter::get_extension() const
+{
+  return ::get_extension(m_opts.format.value_or(ImageFormat::kPNG));
+}
+
+void
+ImageWriter::write(Cairo::RefPtr<Cairo::ImageSurface> const& img, const std::string& filename) const
+{
+  ImageFormat const format = get_format(filename);
+
+  auto const start = std::chrono::steady_clock::now();
+
+  switch(format)
+  {
+    case ImageFormat::kPNG:
+      write_png(img, filename, {}, PNGOptions{m_opts.png_level, m_opts.png_filters});
+      break;
+
+    case ImageFormat::kJPEG:
+      write_jpeg(img, filename, m_opts.quality);
+      break;
+
+    case ImageFormat::kWebP:
+      write_webp(img, filename, m_opts.quality);
+      break;
+
+    case ImageFormat::kQOI:
+      write_qoi(img, filename);
+      break;
+  }
+
+  auto const duration = std::chrono::steady_clock::now() - start;
+  log_info("encoded {}x{} {} to {} in {:.2f}ms",
+           img->get_width(), img->get_height(), ::get_extension(format), filename,
+           std::chrono::duration<double, std::milli>(duration).count());
+}
+
+std::unique_ptr<ImageStream>
+ImageWriter::open_stream(const std::string& filename, int width, int height) const
+{
+  switch(get_format(filename))
+  {
+    case ImageFormat::kPNG:
+      return open_png_stream(filename, width, height, {}, PNGOptions{m_opts.png_level, m_opts.png_filters});
+
+    case ImageFormat::kJPEG:
+      return open_jpeg_stream(filename, width, height, m_opts.quality);
+
+    default:
+      return {};
+  }
+}
+
+void
+convert_row_to_rgb(unsigned char const* src, unsigned char* dst, int width)
+{
+  uint32_t const* pixels = reinterpret_cast<uint32_t const*>(src);
+  for(int x = 0; x < width; ++x)
+  {
+    uint32_t const p = pixels[x];
+    dst[3*x + 0] = static_cast<unsigned char>((p >> 16) & 0xff);
+    dst[3*x + 1] = static_cast<unsigned char>((p >>  8) & 0xff);
+    dst[3*x + 2] = static_cast<unsigned char>((p >>  0) & 0xff);
+  }
+}
+
+FILE*
+open_tmp_file(const std::string& filename, std::string& tmp_filename, int mode)
+{
+  // a per process name isn't enough, --jobs and --serve write from
+  // several threads, possibly to the same file
+  std::string tmpl = filename + ".XXXXXX";
+  int const fd = g_mkstemp_full(tmpl.data(), O_WRONLY, mode);
+  if (fd < 0)
+  {
+    throw std::runtime_error("failed to create a temporary file for " + filename);
+  }
+
+  FILE* fp = fdopen(fd, "wb");
+  if (!fp)
+  {
+    close(fd);
+    std::filesystem::remove(tmpl);
+    throw std::runtime_error("failed to open " + tmpl);
+  }
+
+  tmp_filename = std::move(tmpl);
+  return fp;
+}
+
+void
+write_file(const std::string& filename, std::vector<uint8_t> const& data, int mode)
+{
+  std::string tmp_filename;
+  FILE* fp = open_tmp_file(filename, tmp_filename, mode);
+
+  bool const ok = (fwrite(data.data(), 1, data.size(), fp) == data.size());
+  if (fclose(fp) != 0 || !ok)
+  {
+    std::filesystem::remove(tmp_filename);
+    throw std::runtime_error("failed to write " + tmp_filename);
+  }
+
+  std::filesystem::rename(tmp_filename, filename);
+}
+
+/* EOF */
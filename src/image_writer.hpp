@@ -0,0 +1,120 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_IMAGE_WRITER_HPP
+#define HEADER_IMAGE_WRITER_HPP
+
+#include <cairomm/cairomm.h>
+#include <memory>
+#include <optional>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+enum class ImageFormat
+{
+  kPNG,
+  kJPEG,
+  kWebP,
+  kQOI
+};
+
+ImageFormat image_format_from_string(const std::string& name);
+
+/** Returns the format matching the extension of \a filename, if any */
+std::optional<ImageFormat> image_format_from_filename(const std::string& filename);
+
+/** Returns the canonical file extension, without the dot */
+std::string get_extension(ImageFormat format);
+
+struct ImageWriterOptions
+{
+  /** Output format, picked from the filename extension when unset,
+      falling back to PNG */
+  std::optional<ImageFormat> format = {};
+
+  /** JPEG and WebP quality, 0-100 */
+  int quality = 85;
+
+  /** zlib compression level 0-9, -1 for the libpng default */
+  int png_level = -1;
+
+  /** PNG_FILTER_* flags, -1 for the libpng default */
+  int png_filters = -1;
+};
+
+/** Encodes an image a band of rows at a time, so that the whole image
+    never has to be held in memory. Nothing becomes visible under the
+    final filename until finish() succeeds, a stream destroyed before
+    that removes its temporary file. */
+class ImageStream
+{
+public:
+  virtual ~ImageStream() {}
+
+  /** Appends \a rows rows of \a img starting at row \a y, \a img
+      must be as wide as the image */
+  virtual void write_rows(Cairo::RefPtr<Cairo::ImageSurface> const& img, int y, int rows) =0;
+
+  /** Writes out the remainder of the file and renames it into place,
+      all rows must have been written */
+  virtual void finish() =0;
+};
+
+/** Encodes the finished thumbnails, all formats are written to a
+    temporary file and renamed into place */
+class ImageWriter final
+{
+private:
+  ImageWriterOptions m_opts;
+
+public:
+  ImageWriter(ImageWriterOptions const& opts = {});
+
+  ImageFormat get_format(const std::string& filename) const;
+
+  /** Extension for files that have no name given by the user */
+  std::string get_extension() const;
+
+  /** Writes \a img to \a filename and logs the time spent encoding */
+  void write(Cairo::RefPtr<Cairo::ImageSurface> const& img, const std::string& filename) const;
+
+  /** Opens \a filename for a \a width x \a height image that is
+      written a band of rows at a time, returns nullptr when the format
+      of \a filename can't be streamed */
+  std::unique_ptr<ImageStream> open_stream(const std::string& filename, int width, int height) const;
+};
+
+/** Converts a row of Cairo's native endian RGB24/ARGB32 pixels to
+    8-bit RGB. ARGB32 is premultiplied, so dropping the alpha gives the
+    image composited onto black. */
+void convert_row_to_rgb(unsigned char const* src, unsigned char* dst, int width);
+
+/** Creates a file with a unique name next to \a filename, to be
+    renamed into place once it is complete, and stores its name in \a
+    tmp_filename. The file is created with \a mode minus the umask,
+    never with wider permissions in between. Throws on failure. */
+FILE* open_tmp_file(const std::string& filename, std::string& tmp_filename, int mode = 0666);
+
+/** Writes \a data to a temporary file and renames it to \a filename */
+void write_file(const std::string& filename, std::vector<uint8_t> const& data, int mode = 0666);
+
+#endif
+
+/* EOF */
@@ -0,0 +1,226 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jpeg_writer.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <setjmp.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <vector>
+
+#include <jpeglib.h>
+
+#include "image_writer.hpp"
+
+namespace {
+
+struct FileCloser
+{
+  void operator()(FILE* fp) const { fclose(fp); }
+};
+
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+/** libjpeg reports errors through error_exit(), which must not
+    return, jump back to the caller like libpng does */
+struct ErrorManager
+{
+  jpeg_error_mgr pub;
+  jmp_buf jmp;
+};
+
+void error_exit(j_common_ptr cinfo)
+{
+  longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jmp, 1);
+}
+
+void output_message(j_common_ptr /*cinfo*/)
+{
+  // warnings are of no interest
+}
+
+/** Every method that calls into libjpeg sets its own jump target for
+    error_exit(), only objects without destructors may live across
+    those calls */
+class JPEGStream final : public ImageStream
+{
+private:
+  std::string m_filename;
+  std::string m_tmp_filename;
+  FilePtr m_fp;
+  jpeg_compress_struct m_cinfo;
+  ErrorManager m_err;
+  bool m_started;
+  bool m_direct;
+  std::vector<unsigned char> m_row;
+
+public:
+  JPEGStream(const std::string& filename, int width, int height, int quality) :
+    m_filename(filename),
+    m_tmp_filename(),
+    m_fp(open_tmp_file(filename, m_tmp_filename)),
+    m_cinfo(),
+    m_err(),
+    m_started(false),
+    m_direct(false),
+    m_row(static_cast<size_t>(width) * 3)
+  {
+    m_cinfo.err = jpeg_std_error(&m_err.pub);
+    m_err.pub.error_exit = &error_exit;
+    m_err.pub.output_message = &output_message;
+
+    if (setjmp(m_err.jmp))
+    {
+      discard();
+      throw std::runtime_error("failed to encode " + m_filename);
+    }
+
+    jpeg_create_compress(&m_cinfo);
+    m_started = true;
+    jpeg_stdio_dest(&m_cinfo, m_fp.get());
+
+    m_cinfo.image_width = static_cast<JDIMENSION>(width);
+    m_cinfo.image_height = static_cast<JDIMENSION>(height);
+    m_cinfo.input_components = 3;
+#if defined(JCS_EXTENSIONS) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // libjpeg-turbo reads Cairo's native BGRx directly, the alpha byte
+    // of ARGB32 is skipped, same as convert_row_to_rgb() does
+    m_direct = true;
+    m_cinfo.in_color_space = JCS_EXT_BGRX;
+    m_cinfo.input_components = 4;
+#else
+    m_cinfo.in_color_space = JCS_RGB;
+#endif
+
+    jpeg_set_defaults(&m_cinfo);
+    jpeg_set_quality(&m_cinfo, quality, TRUE);
+    jpeg_start_compress(&m_cinfo, TRUE);
+  }
+
+  ~JPEGStream() override
+  {
+    discard();
+  }
+
+  void write_rows(Cairo::RefPtr<Cairo::ImageSurface> const& img, int y, int rows) override
+  {
+    if (img->get_format() != Cairo::FORMAT_RGB24 &&
+        img->get_format() != Cairo::FORMAT_ARGB32)
+    {
+      throw std::runtime_error("write_jpeg: unsupported surface format");
+    }
+
+    if (!m_started ||
+        static_cast<JDIMENSION>(img->get_width()) != m_cinfo.image_width ||
+        m_cinfo.next_scanline + static_cast<JDIMENSION>(rows) > m_cinfo.image_height)
+    {
+      throw std::runtime_error("write_jpeg: rows don't fit the image");
+    }
+
+    img->flush();
+
+    if (setjmp(m_err.jmp))
+    {
+      discard();
+      throw std::runtime_error("failed to encode " + m_filename);
+    }
+
+    for(int i = 0; i < rows; ++i)
+    {
+      unsigned char* src = img->get_data() + (y + i) * img->get_stride();
+      JSAMPROW row_pointer = src;
+      if (!m_direct)
+      {
+        convert_row_to_rgb(src, m_row.data(), img->get_width());
+        row_pointer = m_row.data();
+      }
+      jpeg_write_scanlines(&m_cinfo, &row_pointer, 1);
+    }
+  }
+
+  void finish() override
+  {
+    if (!m_started || m_cinfo.next_scanline != m_cinfo.image_height)
+    {
+      throw std::runtime_error("write_jpeg: image is incomplete");
+    }
+
+    if (setjmp(m_err.jmp))
+    {
+      discard();
+      throw std::runtime_error("failed to encode " + m_filename);
+    }
+
+    jpeg_finish_compress(&m_cinfo);
+    jpeg_destroy_compress(&m_cinfo);
+    m_started = false;
+
+    if (fclose(m_fp.release()) != 0)
+    {
+      std::filesystem::remove(m_tmp_filename);
+      throw std::runtime_error("failed to write " + m_tmp_filename);
+    }
+
+    std::filesystem::rename(m_tmp_filename, m_filename);
+  }
+
+private:
+  /** Drops the partially written file, a no-op once finished */
+  void discard()
+  {
+    if (m_started)
+    {
+      jpeg_destroy_compress(&m_cinfo);
+      m_started = false;
+    }
+
+    if (m_fp)
+    {
+      m_fp.reset();
+      std::filesystem::remove(m_tmp_filename);
+    }
+  }
+
+private:
+  JPEGStream(const JPEGStream&) = delete;
+  JPEGStream& operator=(const JPEGStream&) = delete;
+};
+
+} // namespace
+
+std::unique_ptr<ImageStream>
+open_jpeg_stream(const std::string& filename,
+                 int width, int height,
+                 int quality)
+{
+  return std::make_unique<JPEGStream>(filename, width, height, quality);
+}
+
+void
+write_jpeg(Cairo::RefPtr<Cairo::ImageSurface> const& img,
+           const std::string& filename,
+           int quality)
+{
+  JPEGStream stream(filename, img->get_width(), img->get_height(), quality);
+  stream.write_rows(img, 0, img->get_height());
+  stream.finish();
+}
+
+/* EOF */
@@ -0,0 +1,42 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_JPEG_WRITER_HPP
+#define HEADER_JPEG_WRITER_HPP
+
+#include <cairomm/cairomm.h>
+#include <memory>
+#include <string>
+
+#include "image_writer.hpp"
+
+/** Opens \a filename for a \a width x \a height baseline JPEG that is
+    written a band of rows at a time */
+std::unique_ptr<ImageStream> open_jpeg_stream(const std::string& filename,
+                                              int width, int height,
+                                              int quality);
+
+/** Writes \a img as baseline JPEG with the given \a quality (0-100)
+    via a temporary file that is renamed into place */
+void write_jpeg(Cairo::RefPtr<Cairo::ImageSurface> const& img,
+                const std::string& filename,
+                int quality);
+
+#endif
+
+/* EOF */
@@ -0,0 +1,509 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "json.hpp"
+
+#include <stdexcept>
+#include <stdlib.h>
+
+#include <fmt/format.h>
+
+namespace {
+
+// deeper nesting than any request needs, keeps hostile input from
+// exhausting the stack
+constexpr int kMaxDepth = 64;
+
+class JsonParser
+{
+private:
+  std::string_view m_text;
+  size_t m_pos;
+
+public:
+  JsonParser(std::string_view text) :
+    m_text(text),
+    m_pos(0)
+  {}
+
+  JsonValue parse_document()
+  {
+    JsonValue value = parse_value(0);
+    skip_whitespace();
+    if (m_pos != m_text.size())
+    {
+      error("trailing characters");
+    }
+    return value;
+  }
+
+private:
+  [[noreturn]] void error(std::string const& message) const
+  {
+    throw std::runtime_error(fmt::format("invalid JSON at offset {}: {}", m_pos, message));
+  }
+
+  void skip_whitespace()
+  {
+    while(m_pos < m_text.size() &&
+          (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' ||
+           m_text[m_pos] == '\n' || m_text[m_pos] == '\r'))
+    {
+      m_pos += 1;
+    }
+  }
+
+  char peek()
+  {
+    skip_whitespace();
+    if (m_pos >= m_text.size())
+    {
+      error("unexpected end of input");
+    }
+    return m_text[m_pos];
+  }
+
+  void expect(char c)
+  {
+    if (peek() != c)
+    {
+      error(fmt::format("expected '{}'", c));
+    }
+    m_pos += 1;
+  }
+
+  bool consume_literal(std::string_view literal)
+  {
+    if (m_text.substr(m_pos, literal.size()) == literal)
+    {
+      m_pos += literal.size();
+      return true;
+    }
+    return false;
+  }
+
+  JsonValue parse_value(int depth)
+  {
+    if (depth > kMaxDepth)
+    {
+      error("nested too deeply");
+    }
+
+    switch(peek())
+    {
+      case '{': return parse_object(depth);
+      case '[': return parse_array(depth);
+      case '"': return JsonValue(parse_string());
+
+      default:
+        if (consume_literal("null"))
+        {
+          return JsonValue();
+        }
+        else if (consume_literal("true"))
+        {
+          return JsonValue(true);
+        }
+        else if (consume_literal("false"))
+        {
+          return JsonValue(false);
+        }
+        else
+        {
+          return JsonValue(parse_number());
+        }
+    }
+  }
+
+  JsonValue parse_object(int depth)
+  {
+    expect('{');
+
+    JsonValue::Object object;
+    if (peek() == '}')
+    {
+      m_pos += 1;
+      return JsonValue(std::move(object));
+    }
+
+    while(true)
+    {
+      if (peek() != '"')
+      {
+        error("expected member name");
+      }
+      std::string key = parse_string();
+      expect(':');
+      object.emplace_back(std::move(key), parse_value(depth + 1));
+
+      if (peek() == ',')
+      {
+        m_pos += 1;
+      }
+      else
+      {
+        expect('}');
+        return JsonValue(std::move(object));
+      }
+    }
+  }
+
+  JsonValue parse_array(int depth)
+  {
+    expect('[');
+
+    JsonValue::Array array;
+    if (peek() == ']')
+    {
+      m_pos += 1;
+      return JsonValue(std::move(array));
+    }
+
+    while(true)
+    {
+      array.push_back(parse_value(depth + 1));
+
+      if (peek() == ',')
+      {
+        m_pos += 1;
+      }
+      else
+      {
+        expect(']');
+        return JsonValue(std::move(array));
+      }
+    }
+  }
+
+  double parse_number()
+  {
+    size_t const start = m_pos;
+    if (m_pos < m_text.size() && m_text[m_pos] == '-')
+    {
+      m_pos += 1;
+    }
+
+    size_t const digits = m_pos;
+    while(m_pos < m_text.size() &&
+          ((m_text[m_pos] >= '0' && m_text[m_pos] <= '9') ||
+           m_text[m_pos] == '.' || m_text[m_pos] == 'e' || m_text[m_pos] == 'E' ||
+           m_text[m_pos] == '+' || m_text[m_pos] == '-'))
+    {
+      m_pos += 1;
+    }
+
+    if (m_pos == digits || m_text[digits] < '0' || m_text[digits] > '9')
+    {
+      m_pos = start;
+      error("unexpected character");
+    }
+
+    // the program never changes LC_NUMERIC, so strtod() parses the
+    // JSON number format
+    std::string const number(m_text.substr(start, m_pos - start));
+    char* end = nullptr;
+    double const value = strtod(number.c_str(), &end);
+    if (end != number.c_str() + number.size())
+    {
+      m_pos = start;
+      error("malformed number");
+    }
+    return value;
+  }
+
+  unsigned parse_hex4()
+  {
+    if (m_pos + 4 > m_text.size())
+    {
+      error("truncated \\u escape");
+    }
+
+    unsigned value = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+      char const c = m_text[m_pos++];
+      value <<= 4;
+      if (c >= '0' && c <= '9') { value |= static_cast<unsigned>(c - '0'); }
+      else if (c >= 'a' && c <= 'f') { value |= static_cast<unsigned>(c - 'a' + 10); }
+      else if (c >= 'A' && c <= 'F') { value |= static_cast<unsigned>(c - 'A' + 10); }
+      else { error("invalid \\u escape"); }
+    }
+    return value;
+  }
+
+  static void append_utf8(std::string& out, unsigned cp)
+  {
+    if (cp < 0x80)
+    {
+      out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  std::string parse_string()
+  {
+    expect('"');
+
+    std::string result;
+    while(true)
+    {
+      if (m_pos >= m_text.size())
+      {
+        error("unterminated string");
+      }
+
+      char const c = m_text[m_pos++];
+      if (c == '"')
+      {
+        return result;
+      }
+      else if (static_cast<unsigned char>(c) < 0x20)
+      {
+        error("control character in string");
+      }
+      else if (c != '\\')
+      {
+        result += c;
+        continue;
+      }
+
+      if (m_pos >= m_text.size())
+      {
+        error("unterminated string");
+      }
+
+      switch(m_text[m_pos++])
+      {
+        case '"':  result += '"'; break;
+        case '\\': result += '\\'; break;
+        case '/':  result += '/'; break;
+        case 'b':  result += '\b'; break;
+        case 'f':  result += '\f'; break;
+        case 'n':  result += '\n'; break;
+        case 'r':  result += '\r'; break;
+        case 't':  result += '\t'; break;
+        case 'u':
+          {
+            unsigned cp = parse_hex4();
+            if (cp >= 0xD800 && cp < 0xDC00 && consume_literal("\\u"))
+            {
+              unsigned const low = parse_hex4();
+              if (low < 0xDC00 || low >= 0xE000)
+              {
+                error("invalid surrogate pair");
+              }
+              cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if (cp >= 0xD800 && cp < 0xE000)
+            {
+              error("unpaired surrogate");
+            }
+            append_utf8(result, cp);
+          }
+          break;
+
+        default:
+          m_pos -= 1;
+          error("invalid escape");
+      }
+    }
+  }
+};
+
+char const* to_string(JsonValue::Type type)
+{
+  switch(type)
+  {
+    case JsonValue::Type::kNull: return "null";
+    case JsonValue::Type::kBool: return "boolean";
+    case JsonValue::Type::kNumber: return "number";
+    case JsonValue::Type::kString: return "string";
+    case JsonValue::Type::kArray: return "array";
+    case JsonValue::Type::kObject: return "object";
+  }
+  return "unknown";
+}
+
+} // namespace
+
+JsonValue
+JsonValue::parse(std::string_view text)
+{
+  return JsonParser(text).parse_document();
+}
+
+JsonValue::JsonValue() :
+  m_type(Type::kNull),
+  m_bool(false),
+  m_number(0.0),
+  m_string(),
+  m_array(),
+  m_object()
+{
+}
+
+JsonValue::JsonValue(bool value) :
+  JsonValue()
+{
+  m_type = Type::kBool;
+  m_bool = value;
+}
+
+JsonValue::JsonValue(double value) :
+  JsonValue()
+{
+  m_type = Type::kNumber;
+  m_number = value;
+}
+
+JsonValue::JsonValue(std::string value) :
+  JsonValue()
+{
+  m_type = Type::kString;
+  m_string = std::move(value);
+}
+
+JsonValue::JsonValue(Array value) :
+  JsonValue()
+{
+  m_type = Type::kArray;
+  m_array = std::move(value);
+}
+
+JsonValue::JsonValue(Object value) :
+  JsonValue()
+{
+  m_type = Type::kObject;
+  m_object = std::move(value);
+}
+
+#define JSON_CHECK_TYPE(expected)                                       \
+  if (m_type != expected)                                               \
+  {                                                                     \
+    throw std::runtime_error(fmt::format("expected JSON {}, got {}",    \
+                                         to_string(expected), to_string(m_type))); \
+  }
+
+bool
+JsonValue::as_bool() const
+{
+  JSON_CHECK_TYPE(Type::kBool);
+  return m_bool;
+}
+
+double
+JsonValue::as_number() const
+{
+  JSON_CHECK_TYPE(Type::kNumber);
+  return m_number;
+}
+
+std::string const&
+JsonValue::as_string() const
+{
+  JSON_CHECK_TYPE(Type::kString);
+  return m_string;
+}
+
+JsonValue::Array const&
+JsonValue::as_array() const
+{
+  JSON_CHECK_TYPE(Type::kArray);
+  return m_array;
+}
+
+JsonValue::Object const&
+JsonValue::as_object() const
+{
+  JSON_CHECK_TYPE(Type::kObject);
+  return m_object;
+}
+
+#undef JSON_CHECK_TYPE
+
+JsonValue const*
+JsonValue::get(std::string_view key) const
+{
+  if (m_type != Type::kObject)
+  {
+    return nullptr;
+  }
+
+  for(auto const& member : m_object)
+  {
+    if (member.first == key)
+    {
+      return &member.second;
+    }
+  }
+  return nullptr;
+}
+
+std::string
+json_quote(std::string_view text)
+{
+  std::string result;
+  result.reserve(text.size() + 2);
+
+  result += '"';
+  for(char const c : text)
+  {
+    switch(c)
+    {
+      case '"':  result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\b': result += "\\b"; break;
+      case '\f': result += "\\f"; break;
+      case '\n': result += "\\n"; break;
+      case '\r': result += "\\r"; break;
+      case '\t': result += "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+          result += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+        }
+        else
+        {
+          result += c;
+        }
+        break;
+    }
+  }
+  result += '"';
+
+  return result;
+}
+
+/* EOF */
@@ -0,0 +1,85 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_JSON_HPP
+#define HEADER_JSON_HPP
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/** A parsed JSON document, just enough for the requests of the
+    thumbnail server */
+class JsonValue final
+{
+public:
+  enum class Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  using Array = std::vector<JsonValue>;
+  using Object = std::vector<std::pair<std::string, JsonValue>>;
+
+private:
+  Type m_type;
+  bool m_bool;
+  double m_number;
+  std::string m_string;
+  Array m_array;
+  Object m_object;
+
+public:
+  /** Parses \a text, which must hold exactly one JSON value, throws
+      std::runtime_error on malformed input */
+  static JsonValue parse(std::string_view text);
+
+  JsonValue();
+  explicit JsonValue(bool value);
+  explicit JsonValue(double value);
+  explicit JsonValue(std::string value);
+  explicit JsonValue(Array value);
+  explicit JsonValue(Object value);
+
+  Type get_type() const { return m_type; }
+  bool is_null() const { return m_type == Type::kNull; }
+  bool is_bool() const { return m_type == Type::kBool; }
+  bool is_number() const { return m_type == Type::kNumber; }
+  bool is_string() const { return m_type == Type::kString; }
+  bool is_array() const { return m_type == Type::kArray; }
+  bool is_object() const { return m_type == Type::kObject; }
+
+  /** The accessors throw std::runtime_error when the value has a
+      different type */
+  bool as_bool() const;
+  double as_number() const;
+  std::string const& as_string() const;
+  Array const& as_array() const;
+  Object const& as_object() const;
+
+  /** Returns the member \a key of an object, nullptr when there is
+      none or this isn't an object */
+  JsonValue const* get(std::string_view key) const;
+};
+
+/** Returns \a text as a quoted JSON string, control characters,
+    quotes and backslashes escaped, everything else passed through as
+    UTF-8 */
+std::string json_quote(std::string_view text);
+
+#endif
+
+/* EOF */
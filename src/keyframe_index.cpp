@@ -0,0 +1,533 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "keyframe_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include <fmt/format.h>
+#include <glibmm.h>
+#include <gst/gst.h>
+#include <logmich/log.hpp>
+
+#include "element_probe.hpp"
+#include "image_writer.hpp"
+
+namespace {
+
+char const kMagic[4] = { 'V', 'T', 'K', 'I' };
+char const kVersion = 1;
+
+/** Identifies the version of the video file an index was built for */
+struct SourceStamp
+{
+  std::string path;
+  guint64 size;
+  gint64 mtime_sec;
+  gint64 mtime_nsec;
+
+  static SourceStamp from_file(const std::string& filename)
+  {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+    {
+      throw std::runtime_error("failed to stat " + filename);
+    }
+
+    return { Glib::canonicalize_filename(filename),
+             static_cast<guint64>(st.st_size),
+             static_cast<gint64>(st.st_mtim.tv_sec),
+             static_cast<gint64>(st.st_mtim.tv_nsec) };
+  }
+
+  bool operator==(SourceStamp const& other) const
+  {
+    return
+      path == other.path &&
+      size == other.size &&
+      mtime_sec == other.mtime_sec &&
+      mtime_nsec == other.mtime_nsec;
+  }
+};
+
+// The entries are stored as zigzag encoded LEB128 deltas, which keeps
+// the index at a few bytes per keyframe.
+
+void write_varint(std::string& out, guint64 value)
+{
+  do
+  {
+    unsigned char byte = value & 0x7f;
+    value >>= 7;
+    if (value)
+    {
+      byte |= 0x80;
+    }
+    out += static_cast<char>(byte);
+  }
+  while (value);
+}
+
+void write_signed_varint(std::string& out, gint64 value)
+{
+  write_varint(out, (static_cast<guint64>(value) << 1) ^ static_cast<guint64>(value >> 63));
+}
+
+class Reader
+{
+private:
+  std::string const& m_data;
+  size_t m_pos;
+
+public:
+  Reader(std::string const& data) :
+    m_data(data),
+    m_pos(0)
+  {}
+
+  std::string read_bytes(size_t len)
+  {
+    if (m_pos + len > m_data.size())
+    {
+      throw std::runtime_error("unexpected end of keyframe index");
+    }
+    std::string result = m_data.substr(m_pos, len);
+    m_pos += len;
+    return result;
+  }
+
+  guint64 read_varint()
+  {
+    guint64 value = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+      if (m_pos >= m_data.size())
+      {
+        throw std::runtime_error("unexpected end of keyframe index");
+      }
+      unsigned char byte = static_cast<unsigned char>(m_data[m_pos++]);
+      value |= static_cast<guint64>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+      {
+        return value;
+      }
+    }
+    throw std::runtime_error("malformed varint in keyframe index");
+  }
+
+  gint64 read_signed_varint()
+  {
+    guint64 value = read_varint();
+    return static_cast<gint64>(value >> 1) ^ -static_cast<gint64>(value & 1);
+  }
+};
+
+struct ScanState
+{
+  std::mutex mutex;
+  bool have_video;
+  GstSegment segment;
+  std::vector<KeyframeIndex::Entry> entries;
+
+  /** bytes read so far, the scan only times out when neither this
+      nor the entries grow */
+  std::atomic<guint64> bytes;
+};
+
+GstPadProbeReturn on_scan_probe(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data)
+{
+  ScanState& state = *static_cast<ScanState*>(user_data);
+
+  if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER)
+  {
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT) &&
+        !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_HEADER))
+    {
+      GstClockTime ts = GST_BUFFER_PTS_IS_VALID(buffer) ? GST_BUFFER_PTS(buffer) : GST_BUFFER_DTS(buffer);
+      if (GST_CLOCK_TIME_IS_VALID(ts))
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        // seeks are done in stream time, not in the demuxer's timestamps
+        guint64 stream_time = gst_segment_to_stream_time(&state.segment, GST_FORMAT_TIME, ts);
+        if (GST_CLOCK_TIME_IS_VALID(stream_time))
+        {
+          state.entries.push_back({ static_cast<gint64>(stream_time),
+                                    GST_BUFFER_OFFSET_IS_VALID(buffer) ?
+                                    static_cast<gint64>(GST_BUFFER_OFFSET(buffer)) : -1 });
+        }
+      }
+    }
+  }
+  else if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM)
+  {
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT)
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      gst_event_copy_segment(event, &state.segment);
+    }
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+void on_scan_pad_added(GstElement* parsebin, GstPad* pad, gpointer user_data)
+{
+  ScanState& state = *static_cast<ScanState*>(user_data);
+
+  // every stream needs a sink, an unlinked pad would stop the demuxer
+  GstElement* pipeline = GST_ELEMENT(gst_element_get_parent(parsebin));
+  GstElement* sink = gst_element_factory_make("fakesink", nullptr);
+  g_object_set(sink, "sync", FALSE, nullptr);
+  gst_bin_add(GST_BIN(pipeline), sink);
+  gst_element_sync_state_with_parent(sink);
+
+  GstPad* sinkpad = gst_element_get_static_pad(sink, "sink");
+  gst_pad_link(pad, sinkpad);
+  gst_object_unref(sinkpad);
+  gst_object_unref(pipeline);
+
+  GstCaps* caps = gst_pad_get_current_caps(pad);
+  if (!caps)
+  {
+    caps = gst_pad_query_caps(pad, nullptr);
+  }
+
+  bool const is_video = caps && !gst_caps_is_empty(caps) &&
+    g_str_has_prefix(gst_structure_get_name(gst_caps_get_structure(caps, 0)), "video/");
+  if (caps)
+  {
+    gst_caps_unref(caps);
+  }
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (is_video && !state.have_video)
+  {
+    state.have_video = true;
+    gst_pad_add_probe(pad,
+                      static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER |
+                                                   GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+                      on_scan_probe, &state, nullptr);
+  }
+}
+
+} // namespace
+
+KeyframeIndex
+KeyframeIndex::load_or_build(const std::string& filename, int timeout)
+{
+  std::string const cache_filename = get_cache_filename(filename);
+
+  KeyframeIndex index;
+  try
+  {
+    if (index.load(cache_filename, filename))
+    {
+      log_info("keyframe index: using cached {}", cache_filename);
+      return index;
+    }
+  }
+  catch(std::exception const& err)
+  {
+    log_warn("keyframe index: ignoring broken cache {}: {}", cache_filename, err.what());
+  }
+
+  try
+  {
+    index = build(filename, timeout);
+  }
+  catch(std::exception const& err)
+  {
+    // capturing without snapping still works, and nothing partial
+    // ends up in the cache
+    log_warn("{}, continuing without keyframe index", err.what());
+    return KeyframeIndex();
+  }
+
+  try
+  {
+    index.save(cache_filename, filename);
+  }
+  catch(std::exception const& err)
+  {
+    // the index is still usable for this run
+    log_warn("keyframe index: failed to write {}: {}", cache_filename, err.what());
+  }
+
+  return index;
+}
+
+KeyframeIndex
+KeyframeIndex::build(const std::string& filename, int timeout)
+{
+  log_info("keyframe index: scanning {}", filename);
+
+  ScanState state;
+  state.have_video = false;
+  gst_segment_init(&state.segment, GST_FORMAT_TIME);
+  state.bytes = 0;
+
+  GstElement* pipeline = gst_pipeline_new("keyframe-scan");
+  GstElement* src = gst_element_factory_make("filesrc", nullptr);
+  GstElement* parsebin = gst_element_factory_make("parsebin", nullptr);
+  if (!src || !parsebin)
+  {
+    gst_object_unref(pipeline);
+    throw std::runtime_error("keyframe index: filesrc or parsebin not available");
+  }
+
+  g_object_set(src, "location", filename.c_str(), nullptr);
+  gst_bin_add_many(GST_BIN(pipeline), src, parsebin, nullptr);
+  gst_element_link(src, parsebin);
+  g_signal_connect(parsebin, "pad-added", G_CALLBACK(on_scan_pad_added), &state);
+  add_source_byte_probe(src, [&state](GstPad* /*pad*/, guint64 size) {
+    state.bytes += size;
+    return true;
+  });
+
+  gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+  // like the capture timeout this limits the time without progress,
+  // scanning a long file as a whole takes as long as it takes
+  GstClockTime const poll_interval = 100 * GST_MSECOND;
+  GstClockTime const no_progress_limit = timeout < 0 ? GST_CLOCK_TIME_NONE : static_cast<GstClockTime>(timeout) * GST_MSECOND;
+  GstClockTime idle = 0;
+  guint64 last_bytes = 0;
+  size_t last_entries = 0;
+
+  GstBus* bus = gst_element_get_bus(pipeline);
+  GstMessage* msg = nullptr;
+  while (!msg)
+  {
+    msg = gst_bus_timed_pop_filtered(bus, poll_interval,
+                                     static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    if (!msg)
+    {
+      guint64 const bytes = state.bytes;
+      size_t entries;
+      {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        entries = state.entries.size();
+      }
+
+      if (bytes != last_bytes || entries != last_entries)
+      {
+        last_bytes = bytes;
+        last_entries = entries;
+        idle = 0;
+      }
+      else
+      {
+        idle += poll_interval;
+        if (no_progress_limit != GST_CLOCK_TIME_NONE && idle >= no_progress_limit)
+        {
+          break;
+        }
+      }
+    }
+  }
+
+  std::string error;
+  if (!msg)
+  {
+    error = fmt::format("no progress for {}ms after {} bytes", timeout, last_bytes);
+  }
+  else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR)
+  {
+    GError* err = nullptr;
+    gst_message_parse_error(msg, &err, nullptr);
+    error = err->message;
+    g_error_free(err);
+  }
+  if (msg)
+  {
+    gst_message_unref(msg);
+  }
+  gst_object_unref(bus);
+
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+
+  if (!error.empty())
+  {
+    throw std::runtime_error("keyframe index: " + error);
+  }
+
+  KeyframeIndex index;
+  index.m_entries = std::move(state.entries);
+  std::sort(index.m_entries.begin(), index.m_entries.end(),
+            [](Entry const& lhs, Entry const& rhs) { return lhs.pos < rhs.pos; });
+  index.m_entries.erase(std::unique(index.m_entries.begin(), index.m_entries.end(),
+                                    [](Entry const& lhs, Entry const& rhs) { return lhs.pos == rhs.pos; }),
+                        index.m_entries.end());
+
+  log_info("keyframe index: found {} keyframes", index.m_entries.size());
+
+  return index;
+}
+
+std::string
+KeyframeIndex::get_cache_filename(const std::string& filename)
+{
+  std::string const checksum = Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_MD5,
+                                                                Glib::canonicalize_filename(filename));
+  return Glib::build_filename(Glib::get_user_cache_dir(), "vidthumb", "keyframes", checksum + ".idx");
+}
+
+KeyframeIndex::KeyframeIndex() :
+  m_entries()
+{
+}
+
+gint64
+KeyframeIndex::snap(gint64 pos) const
+{
+  if (m_entries.empty())
+  {
+    return pos;
+  }
+
+  auto it = std::lower_bound(m_entries.begin(), m_entries.end(), pos,
+                             [](Entry const& entry, gint64 value) { return entry.pos < value; });
+  if (it == m_entries.end())
+  {
+    return m_entries.back().pos;
+  }
+  else if (it == m_entries.begin())
+  {
+    return it->pos;
+  }
+  else
+  {
+    auto prev = std::prev(it);
+    return (pos - prev->pos <= it->pos - pos) ? prev->pos : it->pos;
+  }
+}
+
+std::optional<gint64>
+KeyframeIndex::get_next_keyframe(gint64 pos) const
+{
+  auto it = std::upper_bound(m_entries.begin(), m_entries.end(), pos,
+                             [](gint64 value, Entry const& entry) { return value < entry.pos; });
+  if (it == m_entries.end())
+  {
+    return std::nullopt;
+  }
+  else
+  {
+    return it->pos;
+  }
+}
+
+std::optional<gint64>
+KeyframeIndex::get_average_interval() const
+{
+  if (m_entries.size() < 2)
+  {
+    return std::nullopt;
+  }
+  else
+  {
+    return (m_entries.back().pos - m_entries.front().pos) / static_cast<gint64>(m_entries.size() - 1);
+  }
+}
+
+bool
+KeyframeIndex::load(const std::string& cache_filename, const std::string& filename)
+{
+  std::ifstream in(cache_filename, std::ios::binary);
+  if (!in)
+  {
+    return false;
+  }
+
+  std::string const data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  Reader reader(data);
+
+  if (reader.read_bytes(sizeof(kMagic)) != std::string(kMagic, sizeof(kMagic)) ||
+      reader.read_bytes(1)[0] != kVersion)
+  {
+    throw std::runtime_error("not a keyframe index");
+  }
+
+  SourceStamp stamp;
+  stamp.size = reader.read_varint();
+  stamp.mtime_sec = reader.read_signed_varint();
+  stamp.mtime_nsec = reader.read_signed_varint();
+  stamp.path = reader.read_bytes(reader.read_varint());
+
+  if (!(stamp == SourceStamp::from_file(filename)))
+  {
+    log_info("keyframe index: {} is out of date", cache_filename);
+    return false;
+  }
+
+  guint64 const count = reader.read_varint();
+  std::vector<Entry> entries;
+  entries.reserve(static_cast<size_t>(std::min<guint64>(count, data.size())));
+  Entry last{0, -1};
+  for(guint64 i = 0; i < count; ++i)
+  {
+    last.pos += reader.read_signed_varint();
+    last.offset += reader.read_signed_varint();
+    entries.push_back(last);
+  }
+
+  m_entries = std::move(entries);
+  return true;
+}
+
+void
+KeyframeIndex::save(const std::string& cache_filename, const std::string& filename) const
+{
+  SourceStamp const stamp = SourceStamp::from_file(filename);
+
+  std::string out(kMagic, sizeof(kMagic));
+  out += kVersion;
+  write_varint(out, stamp.size);
+  write_signed_varint(out, stamp.mtime_sec);
+  write_signed_varint(out, stamp.mtime_nsec);
+  write_varint(out, stamp.path.size());
+  out += stamp.path;
+
+  write_varint(out, m_entries.size());
+  Entry last{0, -1};
+  for(auto const& entry : m_entries)
+  {
+    write_signed_varint(out, entry.pos - last.pos);
+    write_signed_varint(out, entry.offset - last.offset);
+    last = entry;
+  }
+
+  std::filesystem::path const path(cache_filename);
+  std::filesystem::create_directories(path.parent_path());
+
+  // write_file() goes through a temporary file, so that concurrent
+  // runs never see a half written index
+  write_file(path.string(), std::vector<uint8_t>(out.begin(), out.end()));
+}
+
+/* EOF */
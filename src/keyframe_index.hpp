@@ -0,0 +1,80 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_KEYFRAME_INDEX_HPP
+#define HEADER_KEYFRAME_INDEX_HPP
+
+#include <glib.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+/** The keyframe positions of a video stream, found by demuxing and
+    parsing the file without decoding it. The index is cached on disk
+    next to the user's other caches, keyed by path, size and mtime of
+    the video, so that re-thumbnailing a file skips the scan. */
+class KeyframeIndex
+{
+public:
+  struct Entry
+  {
+    /** stream time of the keyframe */
+    gint64 pos;
+
+    /** byte offset as reported by the demuxer, -1 if unknown */
+    gint64 offset;
+  };
+
+public:
+  /** Loads the index of \a filename from the cache or builds and
+      caches it when there is no valid cache entry, see build() for
+      \a timeout. When the scan fails the index is empty. */
+  static KeyframeIndex load_or_build(const std::string& filename, int timeout = -1);
+
+  /** Scans \a filename for keyframes, throws when the scan fails or
+      read nothing for \a timeout milliseconds, -1 for no limit */
+  static KeyframeIndex build(const std::string& filename, int timeout = -1);
+
+  static std::string get_cache_filename(const std::string& filename);
+
+public:
+  KeyframeIndex();
+
+  bool empty() const { return m_entries.empty(); }
+  std::vector<Entry> const& get_entries() const { return m_entries; }
+
+  /** Returns the keyframe closest to \a pos */
+  gint64 snap(gint64 pos) const;
+
+  /** Returns the first keyframe after \a pos, if any */
+  std::optional<gint64> get_next_keyframe(gint64 pos) const;
+
+  /** Returns the average distance between keyframes or nothing when
+      there are fewer than two keyframes */
+  std::optional<gint64> get_average_interval() const;
+
+  bool load(const std::string& cache_filename, const std::string& filename);
+  void save(const std::string& cache_filename, const std::string& filename) const;
+
+private:
+  std::vector<Entry> m_entries;
+};
+
+#endif
+
+/* EOF */
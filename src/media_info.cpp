@@ -17,25 +17,37 @@
 */
 
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string.h>
 #include <typeinfo>
+#include <vector>
 
 #include <glibmm.h>
 
 #include <logmich/log.hpp>
 
+#include "capture_stats.hpp"
 #include "media_info.hpp"
 
-MediaInfo::MediaInfo(std::string const& filename) :
+MediaInfo::MediaInfo(std::string const& filename, std::shared_ptr<CaptureStats> stats) :
   m_mainloop(),
   m_pipeline(),
   m_playbin(),
   m_fakesink(),
   m_duration(),
   m_width(),
-  m_height()
+  m_height(),
+  m_error(),
+  m_stats(std::move(stats)),
+  m_open_time(std::chrono::steady_clock::now())
 {
   m_playbin = Gst::Parse::launch("uridecodebin name=mysource ! fakesink name=mysink");
   m_pipeline = m_pipeline.cast_static(m_playbin);
+  if (m_stats)
+  {
+    CaptureStats::watch_pipeline(m_stats, GST_ELEMENT(m_pipeline->gobj()));
+  }
 
   Glib::RefPtr<Gst::Element> source = m_pipeline->get_element("mysource");
   Glib::ustring uri = Glib::filename_to_uri(Glib::canonicalize_filename(filename));
@@ -63,10 +75,12 @@ MediaInfo::MediaInfo(std::string const& filename) :
             Glib::Error err = msgError->parse_error();
             std::cerr << "Error: " << err.what() << std::endl;
             log_error("MessageError: {}", err.what().raw());
+            m_error = err.what().raw();
           }
           else
           {
             log_error("MessageError: unknown");
+            m_error = "unknown error";
           }
 
           m_pipeline->set_state(Gst::STATE_NULL);
@@ -90,6 +104,10 @@ MediaInfo::MediaInfo(std::string const& filename) :
       case Gst::MESSAGE_ASYNC_DONE:
         // triggered when PAUSE state reached
         log_debug("----- Gst::MESSAGE_ASYNC_DONE");
+        if (m_stats)
+        {
+          m_stats->add_preroll(std::chrono::steady_clock::now() - m_open_time);
+        }
 
         get_information();
         m_pipeline->set_state(Gst::STATE_NULL);
@@ -229,23 +247,60 @@ int main(int argc, char** argv)
   Gst::init(argc, argv);
 
   try {
+    std::unique_ptr<StatsWriter> stats_writer;
+    std::vector<std::string> filenames;
     for(int i = 1; i < argc; ++i)
     {
+      if (strcmp(argv[i], "--stats") == 0)
+      {
+        if (i >= argc - 1)
+        {
+          throw std::runtime_error("--stats requires an argument");
+        }
+        i += 1;
+        stats_writer = std::make_unique<StatsWriter>(argv[i]);
+      }
+      else
+      {
+        filenames.push_back(argv[i]);
+      }
+    }
+
+    for(std::string const& filename : filenames)
+    {
+      std::shared_ptr<CaptureStats> const stats = stats_writer ? std::make_shared<CaptureStats>() : nullptr;
+      if (stats)
+      {
+        // the files are probed one after another
+        stats->reset_peak_rss();
+      }
       try
       {
-        log_info("--- processing {}", argv[i]);
+        log_info("--- processing {}", filename);
 
-        MediaInfo video(argv[i]);
+        MediaInfo video(filename, stats);
         log_info("Duration: {} - {}:{}:{}",
                  video.get_duration(),
                  static_cast<int>(video.get_duration() / (GST_SECOND * 60 * 60)),
                  static_cast<int>(video.get_duration() / (GST_SECOND * 60)) % 60,
                  static_cast<int>(video.get_duration() / GST_SECOND) % 60);
         log_info("Size:     {}x{}", video.get_width(), video.get_height());
+
+        if (stats_writer)
+        {
+          stats_writer->write(*stats, filename,
+                              video.get_error().empty() ?
+                              CaptureError() :
+                              CaptureError(ErrorCode::kFailed, video.get_error()));
+        }
       }
       catch(const std::exception& err)
       {
         log_info("Exception: ", err.what());
+        if (stats_writer)
+        {
+          stats_writer->write(*stats, filename, CaptureError(ErrorCode::kFailed, err.what()));
+        }
       }
     }
   } catch (std::exception const& err) {
@@ -3,16 +3,22 @@
 
 #include <gstreamermm.h>
 #include <glibmm/main.h>
+#include <chrono>
+#include <memory>
+
+class CaptureStats;
 
 class MediaInfo
 {
 public:
-  MediaInfo(std::string const& filename);
+  /** \a stats may be nullptr */
+  MediaInfo(std::string const& filename, std::shared_ptr<CaptureStats> stats);
   ~MediaInfo();
 
   gint64 get_duration() const { return m_duration; }
   int get_width() const { return m_width; }
   int get_height() const { return m_height; }
+  std::string const& get_error() const { return m_error; }
 
   void get_information();
   bool shutdown();
@@ -28,6 +34,10 @@ private:
 
   int m_width;
   int m_height;
+  std::string m_error;
+
+  std::shared_ptr<CaptureStats> m_stats;
+  std::chrono::steady_clock::time_point m_open_time;
 
 private:
   MediaInfo(const MediaInfo&) = delete;
@@ -0,0 +1,125 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "output_template.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+
+std::string lookup_placeholder(const std::string& name,
+                               const std::filesystem::path& input,
+                               int index)
+{
+  if (name == "path")
+  {
+    return input.string();
+  }
+  else if (name == "dir")
+  {
+    std::string dir = input.parent_path().string();
+    return dir.empty() ? "." : dir;
+  }
+  else if (name == "name")
+  {
+    return input.filename().string();
+  }
+  else if (name == "stem")
+  {
+    return input.stem().string();
+  }
+  else if (name == "ext")
+  {
+    return input.extension().string();
+  }
+  else if (name == "index")
+  {
+    return std::to_string(index);
+  }
+  else
+  {
+    throw std::runtime_error("unknown output template placeholder: {" + name + "}");
+  }
+}
+
+} // namespace
+
+std::string
+expand_output_template(const std::string& tmpl,
+                       const std::string& input_filename,
+                       int index)
+{
+  std::filesystem::path input(input_filename);
+  std::string result;
+
+  for(std::string::size_type i = 0; i < tmpl.size(); ++i)
+  {
+    if (tmpl[i] == '{')
+    {
+      if (i + 1 < tmpl.size() && tmpl[i+1] == '{')
+      {
+        result += '{';
+        i += 1;
+      }
+      else
+      {
+        std::string::size_type end = tmpl.find('}', i);
+        if (end == std::string::npos)
+        {
+          throw std::runtime_error("unterminated placeholder in output template: " + tmpl);
+        }
+        result += lookup_placeholder(tmpl.substr(i + 1, end - i - 1), input, index);
+        i = end;
+      }
+    }
+    else if (tmpl[i] == '}' && i + 1 < tmpl.size() && tmpl[i+1] == '}')
+    {
+      result += '}';
+      i += 1;
+    }
+    else
+    {
+      result += tmpl[i];
+    }
+  }
+
+  return result;
+}
+
+bool
+is_output_template(const std::string& tmpl)
+{
+  for(std::string::size_type i = 0; i < tmpl.size(); ++i)
+  {
+    if (tmpl[i] == '{')
+    {
+      if (i + 1 < tmpl.size() && tmpl[i+1] == '{')
+      {
+        i += 1;
+      }
+      else
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* EOF */
@@ -0,0 +1,45 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_OUTPUT_TEMPLATE_HPP
+#define HEADER_OUTPUT_TEMPLATE_HPP
+
+#include <string>
+
+/** Expands an output filename template for the given input file, the
+    following placeholders are recognized:
+
+      {path}   the input filename as given
+      {dir}    the directory part of the input filename
+      {name}   the filename without the directory
+      {stem}   the filename without directory and extension
+      {ext}    the extension including the leading '.'
+      {index}  the position of the input in the batch, starting at 0
+      {{, }}   literal '{' and '}'
+
+    A template without placeholders is returned unchanged. */
+std::string expand_output_template(const std::string& tmpl,
+                                   const std::string& input_filename,
+                                   int index);
+
+/** Returns true when \a tmpl contains at least one placeholder */
+bool is_output_template(const std::string& tmpl);
+
+#endif
+
+/* EOF */
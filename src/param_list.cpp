@@ -84,7 +84,7 @@ ParamList::parse_string(const std::string& str)
 }
 
 bool
-ParamList::get(const std::string& name, int* value)
+ParamList::get(const std::string& name, int* value) const
 {
   auto it = m_params.find(name);
   if (it != m_params.end())
@@ -99,7 +99,7 @@ ParamList::get(const std::string& name, int* value)
 }
 
 bool
-ParamList::get(const std::string& name, double* value)
+ParamList::get(const std::string& name, double* value) const
 {
   auto it = m_params.find(name);
   if (it != m_params.end())
@@ -114,7 +114,7 @@ ParamList::get(const std::string& name, double* value)
 }
 
 bool
-ParamList::get(const std::string& name, bool* value)
+ParamList::get(const std::string& name, bool* value) const
 {
   auto it = m_params.find(name);
   if (it != m_params.end())
@@ -129,7 +129,7 @@ ParamList::get(const std::string& name, bool* value)
 }
 
 bool
-ParamList::get(const std::string& name, std::string* value)
+ParamList::get(const std::string& name, std::string* value) const
 {
   auto it = m_params.find(name);
   if (it != m_params.end())
@@ -33,14 +33,10 @@ public:
 
   void parse_string(const std::string& str);
 
-  bool get(const std::string& name, int* value);
-  bool get(const std::string& name, double* value);
-  bool get(const std::string& name, bool* value);
-  bool get(const std::string& name, std::string* value);
-
-private:
-  ParamList(const ParamList&);
-  ParamList& operator=(const ParamList&);
+  bool get(const std::string& name, int* value) const;
+  bool get(const std::string& name, double* value) const;
+  bool get(const std::string& name, bool* value) const;
+  bool get(const std::string& name, std::string* value) const;
 };
 
 #endif
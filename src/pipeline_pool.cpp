@@ -0,0 +1,303 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pipeline_pool.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+#include <optional>
+#include <stdexcept>
+
+#include "capture_error.hpp"
+
+namespace {
+
+GstElement* add_element(GstElement* pipeline, char const* factory, char const* name)
+{
+  GstElement* element = gst_element_factory_make(factory, name);
+  if (!element)
+  {
+    throw std::runtime_error(std::string("GStreamer element not available: ") + factory);
+  }
+  gst_bin_add(GST_BIN(pipeline), element);
+  return element;
+}
+
+void set_caps(GstElement* filter, std::string const& caps_str)
+{
+  GstCaps* caps = gst_caps_from_string(caps_str.c_str());
+  if (!caps)
+  {
+    throw std::runtime_error("invalid caps: " + caps_str);
+  }
+  g_object_set(filter, "caps", caps, nullptr);
+  gst_caps_unref(caps);
+}
+
+/** Links the first video pad uridecodebin exposes to \a user_data, the
+    first element behind it, other streams are left unlinked */
+void on_pad_added(GstElement* /*source*/, GstPad* pad, gpointer user_data)
+{
+  GstCaps* caps = gst_pad_get_current_caps(pad);
+  if (!caps)
+  {
+    caps = gst_pad_query_caps(pad, nullptr);
+  }
+
+  bool const is_video = caps && gst_caps_get_size(caps) > 0 &&
+    g_str_has_prefix(gst_structure_get_name(gst_caps_get_structure(caps, 0)), "video/");
+  if (caps)
+  {
+    gst_caps_unref(caps);
+  }
+
+  if (!is_video)
+  {
+    return;
+  }
+
+  GstPad* sinkpad = gst_element_get_static_pad(GST_ELEMENT(user_data), "sink");
+  if (!gst_pad_is_linked(sinkpad))
+  {
+    GstPadLinkReturn const ret = gst_pad_link(pad, sinkpad);
+    if (GST_PAD_LINK_FAILED(ret))
+    {
+      log_warn("failed to link {}: {}", GST_PAD_NAME(pad), gst_pad_link_get_name(ret));
+    }
+  }
+  gst_object_unref(sinkpad);
+}
+
+/** Fails right away when uridecodebin has exposed all its pads and
+    none of them was video, instead of waiting for a preroll that
+    never happens */
+void on_no_more_pads(GstElement* source, gpointer user_data)
+{
+  GstPad* sinkpad = gst_element_get_static_pad(GST_ELEMENT(user_data), "sink");
+  if (!gst_pad_is_linked(sinkpad))
+  {
+    post_error(source, ErrorCode::kNoVideo, "no video stream");
+  }
+  gst_object_unref(sinkpad);
+}
+
+void destroy_pipeline(GstElement* pipeline)
+{
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+  gst_object_unref(pipeline);
+}
+
+} // namespace
+
+GstElement*
+create_pipeline(VideoProcessorOptions const& opts, PipelineSink sink_type)
+{
+  GstElement* pipeline = gst_pipeline_new(nullptr);
+  gst_object_ref_sink(pipeline);
+
+  try
+  {
+    GstElement* source = add_element(pipeline, "uridecodebin", "mysource");
+
+    std::vector<GstElement*> chain;
+    if (!opts.fused_convert)
+    {
+      chain.push_back(add_element(pipeline, "videoscale", nullptr));
+    }
+    chain.push_back(add_element(pipeline, "videoconvert", nullptr));
+
+    GstElement* filter = add_element(pipeline, "capsfilter", "myfilter");
+    set_caps(filter, get_output_caps(opts));
+    chain.push_back(filter);
+
+    GstElement* sink = nullptr;
+    switch(sink_type)
+    {
+      case PipelineSink::kFakeSink:
+        sink = add_element(pipeline, "fakesink", "mysink");
+        g_object_set(sink,
+                     "signal-handoffs", TRUE,
+                     "sync", FALSE,
+                     nullptr);
+        break;
+
+      case PipelineSink::kAppSink:
+        // two samples let the decoder work on the next frame while the
+        // current one is pulled, without decoding far ahead in scan mode
+        sink = add_element(pipeline, "appsink", "mysink");
+        g_object_set(sink,
+                     "sync", FALSE,
+                     "max-buffers", 2u,
+                     "enable-last-sample", FALSE,
+                     nullptr);
+        break;
+    }
+    chain.push_back(sink);
+
+    for(size_t i = 1; i < chain.size(); ++i)
+    {
+      if (!gst_element_link(chain[i - 1], chain[i]))
+      {
+        throw std::runtime_error(fmt::format("failed to link {} to {}",
+                                             GST_ELEMENT_NAME(chain[i - 1]), GST_ELEMENT_NAME(chain[i])));
+      }
+    }
+
+    // the decoded pads only appear once the stream type is known, the
+    // first element outlives them, so it can be the handler's data
+    g_signal_connect(source, "pad-added", G_CALLBACK(on_pad_added), chain.front());
+    g_signal_connect(source, "no-more-pads", G_CALLBACK(on_no_more_pads), chain.front());
+  }
+  catch(...)
+  {
+    gst_object_unref(pipeline);
+    throw;
+  }
+
+  return pipeline;
+}
+
+PipelinePool::PipelinePool(size_t max_idle) :
+  m_max_idle(max_idle),
+  m_mutex(),
+  m_idle(),
+  m_busy()
+{
+}
+
+PipelinePool::~PipelinePool()
+{
+  for(auto const& entry : m_idle)
+  {
+    destroy_pipeline(entry.pipeline);
+  }
+}
+
+GstElement*
+PipelinePool::acquire(VideoProcessorOptions const& opts, PipelineSink sink)
+{
+  std::string const caps = get_output_caps(opts);
+
+  std::optional<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto const same_structure = [&](Entry const& e) {
+      return e.sink == sink && e.fused_convert == opts.fused_convert;
+    };
+
+    // prefer a pipeline whose caps already match
+    auto it = std::find_if(m_idle.begin(), m_idle.end(),
+                           [&](Entry const& e) { return same_structure(e) && e.caps == caps; });
+    if (it == m_idle.end())
+    {
+      it = std::find_if(m_idle.begin(), m_idle.end(), same_structure);
+    }
+
+    if (it != m_idle.end())
+    {
+      entry = *it;
+      m_idle.erase(it);
+    }
+  }
+
+  if (!entry)
+  {
+    entry = Entry{sink, opts.fused_convert, caps, create_pipeline(opts, sink)};
+  }
+  else if (entry->caps != caps)
+  {
+    log_info("pipeline pool: renegotiating {} -> {}", entry->caps, caps);
+    GstElement* filter = gst_bin_get_by_name(GST_BIN(entry->pipeline), "myfilter");
+    set_caps(filter, caps);
+    gst_object_unref(filter);
+    entry->caps = caps;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_busy.push_back(*entry);
+  return entry->pipeline;
+}
+
+void
+PipelinePool::release(GstElement* pipeline, bool reusable)
+{
+  std::optional<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find_if(m_busy.begin(), m_busy.end(),
+                           [pipeline](Entry const& e) { return e.pipeline == pipeline; });
+    if (it != m_busy.end())
+    {
+      entry = *it;
+      m_busy.erase(it);
+    }
+  }
+
+  if (!entry || !reusable ||
+      gst_element_set_state(pipeline, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE)
+  {
+    destroy_pipeline(pipeline);
+    return;
+  }
+
+  // the watchers of the previous user hold on to their own state
+  guint const signal_id = g_signal_lookup("deep-element-added", GST_TYPE_BIN);
+  g_signal_handlers_disconnect_matched(pipeline, G_SIGNAL_MATCH_ID, signal_id, 0,
+                                       nullptr, nullptr, nullptr);
+
+  // EOS, errors and state changes of the previous file must not reach
+  // the next bus watch
+  GstBus* bus = gst_element_get_bus(pipeline);
+  gst_bus_set_flushing(bus, TRUE);
+  gst_bus_set_flushing(bus, FALSE);
+  gst_object_unref(bus);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_idle.size() < m_max_idle)
+    {
+      m_idle.push_back(*entry);
+      return;
+    }
+  }
+
+  destroy_pipeline(pipeline);
+}
+
+GstElement*
+PipelinePool::acquire(PipelinePool* pool, VideoProcessorOptions const& opts, PipelineSink sink)
+{
+  return pool ? pool->acquire(opts, sink) : create_pipeline(opts, sink);
+}
+
+void
+PipelinePool::release(PipelinePool* pool, GstElement* pipeline, bool reusable)
+{
+  if (pool)
+  {
+    pool->release(pipeline, reusable);
+  }
+  else
+  {
+    destroy_pipeline(pipeline);
+  }
+}
+
+/* EOF */
@@ -0,0 +1,104 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_PIPELINE_POOL_HPP
+#define HEADER_PIPELINE_POOL_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+#include "capture_engine.hpp"
+
+enum class PipelineSink
+{
+  /** fakesink with handoff signals, for VideoProcessor */
+  kFakeSink,
+
+  /** appsink, for AppSinkProcessor */
+  kAppSink
+};
+
+/** Builds the decoding pipeline for \a opts element by element, the
+    same pipeline get_pipeline_desc() describes. The uridecodebin is
+    named 'mysource', the capsfilter 'myfilter' and the sink 'mysink'.
+    Throws when an element isn't available. */
+GstElement* create_pipeline(VideoProcessorOptions const& opts, PipelineSink sink);
+
+/** Keeps pipelines around between files. A released pipeline is put
+    back to READY, which drops uridecodebin's source and decoders but
+    keeps everything behind them, the next file only needs a new uri
+    and a preroll. A pipeline built for other options is reused when
+    only the output caps differ, the capsfilter is then updated and
+    the caps renegotiated, with the same options it is left alone.
+
+    The bus watch, the handoff connections and the sink probes of the
+    previous user must be removed before release(), the handlers of
+    the pipeline's deep-element-added signal and pending bus messages
+    are dropped by release(). Thread-safe. */
+class PipelinePool final
+{
+private:
+  struct Entry
+  {
+    PipelineSink sink;
+    bool fused_convert;
+    std::string caps;
+    GstElement* pipeline;
+  };
+
+private:
+  size_t m_max_idle;
+
+  std::mutex m_mutex;
+  std::vector<Entry> m_idle;
+
+  /** every pipeline handed out, for telling them apart on release() */
+  std::vector<Entry> m_busy;
+
+public:
+  /** Keeps at most \a max_idle unused pipelines */
+  PipelinePool(size_t max_idle);
+  ~PipelinePool();
+
+  /** Returns a pipeline in READY or NULL for \a opts, either an idle
+      one or a newly built one. The caller owns the reference and hands
+      it back with release(). */
+  GstElement* acquire(VideoProcessorOptions const& opts, PipelineSink sink);
+
+  /** Takes back \a pipeline, it is destroyed instead of kept when it
+      isn't \a reusable, e.g. after an error, or the pool is full */
+  void release(GstElement* pipeline, bool reusable);
+
+  /** Acquires from \a pool or, when it is nullptr, builds a fresh
+      pipeline */
+  static GstElement* acquire(PipelinePool* pool, VideoProcessorOptions const& opts, PipelineSink sink);
+
+  /** Releases to \a pool or, when it is nullptr, destroys \a pipeline */
+  static void release(PipelinePool* pool, GstElement* pipeline, bool reusable);
+
+private:
+  PipelinePool(const PipelinePool&) = delete;
+  PipelinePool& operator=(const PipelinePool&) = delete;
+};
+
+#endif
+
+/* EOF */
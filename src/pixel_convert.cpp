@@ -0,0 +1,436 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pixel_convert.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define VIDTHUMB_HAVE_X86 1
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+using AccumulateU8 = void (*)(uint32_t* acc, uint8_t const* src, int n);
+using AccumulateU16 = void (*)(uint32_t* acc, uint16_t const* src, int n);
+
+/** The only part of the conversion that touches every source sample */
+struct Kernels
+{
+  AccumulateU8 accumulate_u8;
+  AccumulateU16 accumulate_u16;
+};
+
+void accumulate_u8_scalar(uint32_t* acc, uint8_t const* src, int n)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    acc[i] += src[i];
+  }
+}
+
+void accumulate_u16_scalar(uint32_t* acc, uint16_t const* src, int n)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    acc[i] += src[i];
+  }
+}
+
+#ifdef VIDTHUMB_HAVE_X86
+
+__attribute__((target("sse2")))
+void accumulate_u8_sse2(uint32_t* acc, uint8_t const* src, int n)
+{
+  __m128i const zero = _mm_setzero_si128();
+
+  int i = 0;
+  for(; i + 16 <= n; i += 16)
+  {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+    __m128i const lo = _mm_unpacklo_epi8(v, zero);
+    __m128i const hi = _mm_unpackhi_epi8(v, zero);
+
+    __m128i* const out = reinterpret_cast<__m128i*>(acc + i);
+    _mm_storeu_si128(out + 0, _mm_add_epi32(_mm_loadu_si128(out + 0), _mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_si128(out + 2, _mm_add_epi32(_mm_loadu_si128(out + 2), _mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_si128(out + 3, _mm_add_epi32(_mm_loadu_si128(out + 3), _mm_unpackhi_epi16(hi, zero)));
+  }
+
+  accumulate_u8_scalar(acc + i, src + i, n - i);
+}
+
+__attribute__((target("sse2")))
+void accumulate_u16_sse2(uint32_t* acc, uint16_t const* src, int n)
+{
+  __m128i const zero = _mm_setzero_si128();
+
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+  {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+
+    __m128i* const out = reinterpret_cast<__m128i*>(acc + i);
+    _mm_storeu_si128(out + 0, _mm_add_epi32(_mm_loadu_si128(out + 0), _mm_unpacklo_epi16(v, zero)));
+    _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(v, zero)));
+  }
+
+  accumulate_u16_scalar(acc + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void accumulate_u8_avx2(uint32_t* acc, uint8_t const* src, int n)
+{
+  int i = 0;
+  for(; i + 16 <= n; i += 16)
+  {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+
+    __m256i* const out = reinterpret_cast<__m256i*>(acc + i);
+    _mm256_storeu_si256(out + 0, _mm256_add_epi32(_mm256_loadu_si256(out + 0), _mm256_cvtepu8_epi32(v)));
+    _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1),
+                                                  _mm256_cvtepu8_epi32(_mm_srli_si128(v, 8))));
+  }
+
+  accumulate_u8_scalar(acc + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void accumulate_u16_avx2(uint32_t* acc, uint16_t const* src, int n)
+{
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+  {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+
+    __m256i* const out = reinterpret_cast<__m256i*>(acc + i);
+    _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), _mm256_cvtepu16_epi32(v)));
+  }
+
+  accumulate_u16_scalar(acc + i, src + i, n - i);
+}
+
+#endif
+
+Kernels get_kernels(SimdLevel simd)
+{
+#ifdef VIDTHUMB_HAVE_X86
+  switch(simd)
+  {
+    case SimdLevel::kAVX2:
+      return { &accumulate_u8_avx2, &accumulate_u16_avx2 };
+
+    case SimdLevel::kSSE2:
+      return { &accumulate_u8_sse2, &accumulate_u16_sse2 };
+
+    case SimdLevel::kScalar:
+      break;
+  }
+#else
+  (void)simd;
+#endif
+
+  return { &accumulate_u8_scalar, &accumulate_u16_scalar };
+}
+
+/** The source span [begin, end) covered by each of \a dst_size target
+    pixels, upscaling repeats source samples */
+struct Span
+{
+  int begin;
+  int end;
+};
+
+std::vector<Span> get_spans(int src_size, int dst_size)
+{
+  std::vector<Span> spans(static_cast<size_t>(dst_size));
+  for(int i = 0; i < dst_size; ++i)
+  {
+    int const begin = static_cast<int>(static_cast<int64_t>(i) * src_size / dst_size);
+    int const end = static_cast<int>(static_cast<int64_t>(i + 1) * src_size / dst_size);
+    spans[static_cast<size_t>(i)] = Span{ begin, std::max(end, begin + 1) };
+  }
+  return spans;
+}
+
+/** Fixed point YCbCr to RGB coefficients, scaled by 256 */
+struct Coefficients
+{
+  int y_offset;
+  int y;
+  int r_v;
+  int g_u;
+  int g_v;
+  int b_u;
+};
+
+Coefficients get_coefficients(YuvMatrix matrix, bool full_range)
+{
+  if (full_range)
+  {
+    return (matrix == YuvMatrix::kBT709) ?
+      Coefficients{ 0, 256, 403, 48, 120, 475 } :
+      Coefficients{ 0, 256, 359, 88, 183, 454 };
+  }
+  else
+  {
+    return (matrix == YuvMatrix::kBT709) ?
+      Coefficients{ 16, 298, 459, 55, 136, 541 } :
+      Coefficients{ 16, 298, 409, 100, 208, 516 };
+  }
+}
+
+inline uint8_t clamp_u8(int v)
+{
+  return static_cast<uint8_t>(std::clamp(v, 0, 255));
+}
+
+inline int average(uint32_t sum, int count)
+{
+  return static_cast<int>((sum + static_cast<uint32_t>(count / 2)) / static_cast<uint32_t>(count));
+}
+
+inline void put_yuv(uint8_t* out, Coefficients const& k, int y, int u, int v)
+{
+  int const c = k.y * (y - k.y_offset) + 128;
+  int const d = u - 128;
+  int const e = v - 128;
+
+  out[0] = clamp_u8((c + k.b_u * d) >> 8);
+  out[1] = clamp_u8((c - k.g_u * d - k.g_v * e) >> 8);
+  out[2] = clamp_u8((c + k.r_v * e) >> 8);
+  out[3] = 0xff;
+}
+
+uint8_t const* get_row(SourceImage const& src, int plane, int y)
+{
+  return src.planes[plane] + static_cast<ptrdiff_t>(y) * src.strides[plane];
+}
+
+uint16_t const* get_row16(SourceImage const& src, int plane, int y)
+{
+  return reinterpret_cast<uint16_t const*>(get_row(src, plane, y));
+}
+
+void convert_bgrx(SourceImage const& src, TargetImage const& dst, Kernels const& kernels)
+{
+  std::vector<Span> const xspans = get_spans(src.width, dst.width);
+  std::vector<Span> const yspans = get_spans(src.height, dst.height);
+
+  std::vector<uint32_t> acc(static_cast<size_t>(src.width) * 4);
+
+  for(int oy = 0; oy < dst.height; ++oy)
+  {
+    Span const ys = yspans[static_cast<size_t>(oy)];
+
+    std::fill(acc.begin(), acc.end(), 0);
+    for(int y = ys.begin; y < ys.end; ++y)
+    {
+      kernels.accumulate_u8(acc.data(), get_row(src, 0, y), src.width * 4);
+    }
+
+    uint8_t* out = dst.data + static_cast<ptrdiff_t>(oy) * dst.stride;
+    for(int ox = 0; ox < dst.width; ++ox, out += 4)
+    {
+      Span const xs = xspans[static_cast<size_t>(ox)];
+      int const count = (xs.end - xs.begin) * (ys.end - ys.begin);
+
+      uint32_t sum[3] = {};
+      for(int x = xs.begin; x < xs.end; ++x)
+      {
+        for(int c = 0; c < 3; ++c)
+        {
+          sum[c] += acc[static_cast<size_t>(x * 4 + c)];
+        }
+      }
+
+      for(int c = 0; c < 3; ++c)
+      {
+        out[c] = static_cast<uint8_t>(average(sum[c], count));
+      }
+      out[3] = 0xff;
+    }
+  }
+}
+
+void convert_yuv(SourceImage const& src, TargetImage const& dst, Kernels const& kernels)
+{
+  bool const planar = (src.format == PixelFormat::kI420);
+  bool const wide = (src.format == PixelFormat::kP010);
+
+  // P010 keeps 10 significant bits in the upper bits of each sample,
+  // I420 and NV12 are already 8-bit
+  int const shift = wide ? 8 : 0;
+
+  int const chroma_width = (src.width + 1) / 2;
+  int const chroma_height = (src.height + 1) / 2;
+
+  std::vector<Span> const xspans = get_spans(src.width, dst.width);
+  std::vector<Span> const yspans = get_spans(src.height, dst.height);
+  std::vector<Span> const cxspans = get_spans(chroma_width, dst.width);
+  std::vector<Span> const cyspans = get_spans(chroma_height, dst.height);
+
+  Coefficients const k = get_coefficients(src.matrix, src.full_range);
+
+  // luma, followed by either U and V or interleaved UV
+  std::vector<uint32_t> acc_y(static_cast<size_t>(src.width));
+  std::vector<uint32_t> acc_u(static_cast<size_t>(planar ? chroma_width : chroma_width * 2));
+  std::vector<uint32_t> acc_v(static_cast<size_t>(planar ? chroma_width : 0));
+
+  auto accumulate = [&](uint32_t* acc, int plane, int y, int n) {
+    if (wide)
+    {
+      kernels.accumulate_u16(acc, get_row16(src, plane, y), n);
+    }
+    else
+    {
+      kernels.accumulate_u8(acc, get_row(src, plane, y), n);
+    }
+  };
+
+  for(int oy = 0; oy < dst.height; ++oy)
+  {
+    Span const ys = yspans[static_cast<size_t>(oy)];
+    Span const cys = cyspans[static_cast<size_t>(oy)];
+
+    std::fill(acc_y.begin(), acc_y.end(), 0);
+    std::fill(acc_u.begin(), acc_u.end(), 0);
+    std::fill(acc_v.begin(), acc_v.end(), 0);
+
+    for(int y = ys.begin; y < ys.end; ++y)
+    {
+      accumulate(acc_y.data(), 0, y, src.width);
+    }
+
+    for(int y = cys.begin; y < cys.end; ++y)
+    {
+      if (planar)
+      {
+        accumulate(acc_u.data(), 1, y, chroma_width);
+        accumulate(acc_v.data(), 2, y, chroma_width);
+      }
+      else
+      {
+        accumulate(acc_u.data(), 1, y, chroma_width * 2);
+      }
+    }
+
+    uint8_t* out = dst.data + static_cast<ptrdiff_t>(oy) * dst.stride;
+    for(int ox = 0; ox < dst.width; ++ox, out += 4)
+    {
+      Span const xs = xspans[static_cast<size_t>(ox)];
+      Span const cxs = cxspans[static_cast<size_t>(ox)];
+
+      uint32_t sum_y = 0;
+      for(int x = xs.begin; x < xs.end; ++x)
+      {
+        sum_y += acc_y[static_cast<size_t>(x)];
+      }
+
+      uint32_t sum_u = 0;
+      uint32_t sum_v = 0;
+      for(int x = cxs.begin; x < cxs.end; ++x)
+      {
+        if (planar)
+        {
+          sum_u += acc_u[static_cast<size_t>(x)];
+          sum_v += acc_v[static_cast<size_t>(x)];
+        }
+        else
+        {
+          sum_u += acc_u[static_cast<size_t>(2 * x + 0)];
+          sum_v += acc_u[static_cast<size_t>(2 * x + 1)];
+        }
+      }
+
+      int const count = (xs.end - xs.begin) * (ys.end - ys.begin);
+      int const chroma_count = (cxs.end - cxs.begin) * (cys.end - cys.begin);
+
+      put_yuv(out, k,
+              average(sum_y, count) >> shift,
+              average(sum_u, chroma_count) >> shift,
+              average(sum_v, chroma_count) >> shift);
+    }
+  }
+}
+
+} // namespace
+
+SimdLevel
+get_simd_level()
+{
+#ifdef VIDTHUMB_HAVE_X86
+  static SimdLevel const level = []{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      return SimdLevel::kAVX2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+      return SimdLevel::kSSE2;
+    }
+    else
+    {
+      return SimdLevel::kScalar;
+    }
+  }();
+  return level;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+void
+convert_downscale(SourceImage const& src, TargetImage const& dst, SimdLevel simd)
+{
+  if (src.width <= 0 || src.height <= 0 || dst.width <= 0 || dst.height <= 0)
+  {
+    throw std::invalid_argument("convert_downscale: empty image");
+  }
+
+  // keep the 32-bit sums from overflowing, 16-bit samples leave room
+  // for 65537 of them
+  int64_t const max_span = (static_cast<int64_t>(src.width) / dst.width + 1) *
+                           (static_cast<int64_t>(src.height) / dst.height + 1);
+  if (max_span > 65537)
+  {
+    throw std::invalid_argument("convert_downscale: scale factor too large");
+  }
+
+  Kernels const kernels = get_kernels(simd);
+
+  switch(src.format)
+  {
+    case PixelFormat::kBGRx:
+      convert_bgrx(src, dst, kernels);
+      break;
+
+    case PixelFormat::kI420:
+    case PixelFormat::kNV12:
+    case PixelFormat::kP010:
+      convert_yuv(src, dst, kernels);
+      break;
+  }
+}
+
+/* EOF */
@@ -0,0 +1,92 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_PIXEL_CONVERT_HPP
+#define HEADER_PIXEL_CONVERT_HPP
+
+#include <stdint.h>
+
+/** Source formats understood by convert_downscale() */
+enum class PixelFormat
+{
+  /** 8-bit planar Y, U, V with 2x2 subsampled chroma */
+  kI420,
+
+  /** 8-bit Y plane and an interleaved, 2x2 subsampled UV plane */
+  kNV12,
+
+  /** like NV12, but 16-bit little endian samples holding 10-bit
+      values in the upper bits */
+  kP010,
+
+  /** 8-bit B, G, R, x */
+  kBGRx
+};
+
+enum class YuvMatrix
+{
+  kBT601,
+  kBT709
+};
+
+/** A frame as handed out by the decoder, planes that the format
+    doesn't have are ignored */
+struct SourceImage
+{
+  PixelFormat format = PixelFormat::kBGRx;
+  int width = 0;
+  int height = 0;
+  uint8_t const* planes[3] = {};
+  int strides[3] = {};
+  YuvMatrix matrix = YuvMatrix::kBT601;
+  bool full_range = false;
+};
+
+/** BGRx pixels, as Cairo's FORMAT_RGB24 on little endian */
+struct TargetImage
+{
+  uint8_t* data = nullptr;
+  int width = 0;
+  int height = 0;
+  int stride = 0;
+};
+
+enum class SimdLevel
+{
+  kScalar,
+  kSSE2,
+  kAVX2
+};
+
+/** Returns the best instruction set supported by the CPU */
+SimdLevel get_simd_level();
+
+/** Converts \a src to BGRx and scales it to the size of \a dst in a
+    single pass. Every target pixel is the average of the source area
+    it covers, so downscaling doesn't alias.
+
+    Source rows are summed up with \a simd, the averaging and the color
+    conversion happen once per target pixel, so the cost beyond reading
+    the source is proportional to the target size. Results are
+    identical for every SimdLevel. */
+void convert_downscale(SourceImage const& src, TargetImage const& dst,
+                       SimdLevel simd = get_simd_level());
+
+#endif
+
+/* EOF */
@@ -0,0 +1,293 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "png_writer.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <stdint.h>
+#include <png.h>
+#include <sstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <vector>
+
+#include "image_writer.hpp"
+
+namespace {
+
+struct FileCloser
+{
+  void operator()(FILE* fp) const { fclose(fp); }
+};
+
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+/** libpng reports errors by longjmp()ing back to the last setjmp(),
+    so every method that calls into libpng sets its own jump target and
+    only objects without destructors may live across those calls */
+class PNGStream final : public ImageStream
+{
+private:
+  std::string m_filename;
+  std::string m_tmp_filename;
+  FilePtr m_fp;
+  png_structp m_png;
+  png_infop m_info;
+  int m_width;
+  int m_height;
+  int m_rows_written;
+  std::vector<unsigned char> m_row;
+
+public:
+  PNGStream(const std::string& filename, int width, int height,
+            PNGText const& text, PNGOptions const& opts) :
+    m_filename(filename),
+    m_tmp_filename(),
+    m_fp(open_tmp_file(filename, m_tmp_filename, opts.mode)),
+    m_png(nullptr),
+    m_info(nullptr),
+    m_width(width),
+    m_height(height),
+    m_rows_written(0),
+    m_row(static_cast<size_t>(width) * 3)
+  {
+    std::vector<png_text> chunks;
+    for(auto const& it : text)
+    {
+      png_text chunk{};
+      chunk.compression = PNG_TEXT_COMPRESSION_NONE;
+      chunk.key = const_cast<char*>(it.first.c_str());
+      chunk.text = const_cast<char*>(it.second.c_str());
+      chunk.text_length = it.second.size();
+      chunks.push_back(chunk);
+    }
+
+    m_png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    m_info = png_create_info_struct(m_png);
+
+    if (setjmp(png_jmpbuf(m_png)))
+    {
+      discard();
+      throw std::runtime_error("failed to encode " + m_filename);
+    }
+
+    png_init_io(m_png, m_fp.get());
+    if (opts.level >= 0)
+    {
+      png_set_compression_level(m_png, opts.level);
+    }
+    if (opts.filters >= 0)
+    {
+      png_set_filter(m_png, PNG_FILTER_TYPE_BASE, opts.filters);
+    }
+    png_set_IHDR(m_png, m_info,
+                 static_cast<png_uint_32>(width), static_cast<png_uint_32>(height),
+                 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    if (!chunks.empty())
+    {
+      png_set_text(m_png, m_info, chunks.data(), static_cast<int>(chunks.size()));
+    }
+    png_write_info(m_png, m_info);
+  }
+
+  ~PNGStream() override
+  {
+    discard();
+  }
+
+  void write_rows(Cairo::RefPtr<Cairo::ImageSurface> const& img, int y, int rows) override
+  {
+    if (img->get_format() != Cairo::FORMAT_RGB24 &&
+        img->get_format() != Cairo::FORMAT_ARGB32)
+    {
+      throw std::runtime_error("write_png: unsupported surface format");
+    }
+
+    if (!m_png || img->get_width() != m_width || m_rows_written + rows > m_height)
+    {
+      throw std::runtime_error("write_png: rows don't fit the image");
+    }
+
+    img->flush();
+
+    if (setjmp(png_jmpbuf(m_png)))
+    {
+      discard();
+      throw std::runtime_error("failed to encode " + m_filename);
+    }
+
+    for(int i = 0; i < rows; ++i)
+    {
+      convert_row_to_rgb(img->get_data() + (y + i) * img->get_stride(), m_row.data(), m_width);
+      png_write_row(m_png, m_row.data());
+    }
+    m_rows_written += rows;
+  }
+
+  void finish() override
+  {
+    if (!m_png || m_rows_written != m_height)
+    {
+      throw std::runtime_error("write_png: image is incomplete");
+    }
+
+    if (setjmp(png_jmpbuf(m_png)))
+    {
+      discard();
+      throw std::runtime_error("failed to encode " + m_filename);
+    }
+
+    png_write_end(m_png, m_info);
+    png_destroy_write_struct(&m_png, &m_info);
+
+    if (fclose(m_fp.release()) != 0)
+    {
+      std::filesystem::remove(m_tmp_filename);
+      throw std::runtime_error("failed to write " + m_tmp_filename);
+    }
+
+    std::filesystem::rename(m_tmp_filename, m_filename);
+  }
+
+private:
+  /** Drops the partially written file, a no-op once finished */
+  void discard()
+  {
+    if (m_png)
+    {
+      png_destroy_write_struct(&m_png, &m_info);
+    }
+
+    if (m_fp)
+    {
+      m_fp.reset();
+      std::filesystem::remove(m_tmp_filename);
+    }
+  }
+
+private:
+  PNGStream(const PNGStream&) = delete;
+  PNGStream& operator=(const PNGStream&) = delete;
+};
+
+} // namespace
+
+int
+png_filters_from_string(const std::string& text)
+{
+  int filters = 0;
+
+  std::istringstream in(text);
+  std::string name;
+  while(std::getline(in, name, ','))
+  {
+    if (name == "none")
+    {
+      filters |= PNG_FILTER_NONE;
+    }
+    else if (name == "sub")
+    {
+      filters |= PNG_FILTER_SUB;
+    }
+    else if (name == "up")
+    {
+      filters |= PNG_FILTER_UP;
+    }
+    else if (name == "avg")
+    {
+      filters |= PNG_FILTER_AVG;
+    }
+    else if (name == "paeth")
+    {
+      filters |= PNG_FILTER_PAETH;
+    }
+    else if (name == "all")
+    {
+      filters |= PNG_ALL_FILTERS;
+    }
+    else
+    {
+      throw std::runtime_error("unknown PNG filter: " + name);
+    }
+  }
+
+  return filters;
+}
+
+std::unique_ptr<ImageStream>
+open_png_stream(const std::string& filename,
+                int width, int height,
+                PNGText const& text,
+                PNGOptions const& opts)
+{
+  return std::make_unique<PNGStream>(filename, width, height, text, opts);
+}
+
+void
+write_png(Cairo::RefPtr<Cairo::ImageSurface> const& img,
+          const std::string& filename,
+          PNGText const& text,
+          PNGOptions const& opts)
+{
+  PNGStream stream(filename, img->get_width(), img->get_height(), text, opts);
+  stream.write_rows(img, 0, img->get_height());
+  stream.finish();
+}
+
+PNGText
+read_png_text(const std::string& filename)
+{
+  FilePtr fp(fopen(filename.c_str(), "rb"));
+  if (!fp)
+  {
+    throw std::runtime_error("failed to open " + filename);
+  }
+
+  png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  png_infop info = png_create_info_struct(png);
+
+  if (setjmp(png_jmpbuf(png)))
+  {
+    png_destroy_read_struct(&png, &info, nullptr);
+    throw std::runtime_error("failed to read " + filename);
+  }
+
+  png_init_io(png, fp.get());
+
+  // the text chunks written by write_png() come before the image data,
+  // so png_read_info() sees all of them without decoding anything
+  png_read_info(png, info);
+
+  png_textp chunks = nullptr;
+  int num_chunks = 0;
+  png_get_text(png, info, &chunks, &num_chunks);
+
+  PNGText result;
+  for(int i = 0; i < num_chunks; ++i)
+  {
+    result[chunks[i].key] = std::string(chunks[i].text, chunks[i].text_length);
+  }
+
+  png_destroy_read_struct(&png, &info, nullptr);
+
+  return result;
+}
+
+/* EOF */
@@ -0,0 +1,68 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_PNG_WRITER_HPP
+#define HEADER_PNG_WRITER_HPP
+
+#include <cairomm/cairomm.h>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "image_writer.hpp"
+
+using PNGText = std::map<std::string, std::string>;
+
+struct PNGOptions
+{
+  /** zlib compression level 0-9, -1 for the libpng default */
+  int level = -1;
+
+  /** PNG_FILTER_* flags, -1 for the libpng default */
+  int filters = -1;
+
+  /** permissions of the new file, minus the umask */
+  int mode = 0666;
+};
+
+/** Parses none, sub, up, avg, paeth or all, or a comma separated list
+    of them, into PNG_FILTER_* flags */
+int png_filters_from_string(const std::string& text);
+
+/** Opens \a filename for a \a width x \a height PNG that is written a
+    band of rows at a time */
+std::unique_ptr<ImageStream> open_png_stream(const std::string& filename,
+                                             int width, int height,
+                                             PNGText const& text = {},
+                                             PNGOptions const& opts = {});
+
+/** Writes \a img as PNG to \a filename, storing \a text as tEXt
+    chunks. The file is written to a temporary file first and renamed
+    into place, so readers never see a partial file. */
+void write_png(Cairo::RefPtr<Cairo::ImageSurface> const& img,
+               const std::string& filename,
+               PNGText const& text = {},
+               PNGOptions const& opts = {});
+
+/** Reads only the tEXt/zTXt/iTXt chunks of \a filename, the image
+    data is not decoded */
+PNGText read_png_text(const std::string& filename);
+
+#endif
+
+/* EOF */
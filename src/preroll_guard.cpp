@@ -0,0 +1,207 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "preroll_guard.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "capture_error.hpp"
+#include "element_probe.hpp"
+
+struct PrerollGuard::State
+{
+  std::mutex mutex;
+
+  /** set once the first frame arrived, the budget was exceeded or the
+      guard is gone, nothing is posted after that */
+  bool done;
+
+  GstElement* pipeline;
+  int timeout;
+  guint64 max_bytes;
+  std::atomic<guint64> bytes;
+
+  State(GstElement* pipeline_, int timeout_, guint64 max_bytes_) :
+    mutex(),
+    done(false),
+    pipeline(GST_ELEMENT(gst_object_ref(pipeline_))),
+    timeout(timeout_),
+    max_bytes(max_bytes_),
+    bytes(0)
+  {}
+
+  ~State()
+  {
+    gst_object_unref(pipeline);
+  }
+
+  bool is_done()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done;
+  }
+
+  void finish()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+
+  void fail(GstElement* element, std::string const& message)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (done)
+    {
+      return;
+    }
+    done = true;
+
+    log_warn("preroll budget exceeded: {}", message);
+    post_error(element, ErrorCode::kPrerollBudget, message);
+  }
+};
+
+namespace {
+
+using StatePtr = std::shared_ptr<PrerollGuard::State>;
+
+gpointer new_state_ref(StatePtr const& state)
+{
+  return new StatePtr(state);
+}
+
+void delete_state_ref(gpointer data)
+{
+  delete static_cast<StatePtr*>(data);
+}
+
+StatePtr const& get_state(gpointer data)
+{
+  return *static_cast<StatePtr*>(data);
+}
+
+void on_element_added(StatePtr const& state, GstElement* element)
+{
+  if (!state->max_bytes)
+  {
+    return;
+  }
+
+  add_source_byte_probe(element, [state](GstPad* pad, guint64 size) {
+    if (state->is_done())
+    {
+      return false;
+    }
+
+    guint64 const bytes = state->bytes += size;
+    if (bytes > state->max_bytes)
+    {
+      GstElement* source = gst_pad_get_parent_element(pad);
+      state->fail(source ? source : state->pipeline,
+                  fmt::format("read {:.1f} MiB without finding a frame",
+                              static_cast<double>(bytes) / (1024.0 * 1024.0)));
+      if (source)
+      {
+        gst_object_unref(source);
+      }
+      return false;
+    }
+    return true;
+  });
+}
+
+} // namespace
+
+PrerollGuard::PrerollGuard(GstElement* pipeline, int timeout, guint64 max_bytes) :
+  m_state(std::make_shared<State>(pipeline, timeout, max_bytes)),
+  m_pipeline(pipeline),
+  m_element_added_handler(0),
+  m_sink_probe(0),
+  m_clock_id(nullptr)
+{
+  // the source is only created once the pipeline leaves READY
+  auto added_callback = +[](GstBin* /*bin*/, GstBin* /*sub_bin*/, GstElement* element, gpointer user_data) {
+    on_element_added(get_state(user_data), element);
+  };
+  m_element_added_handler =
+    g_signal_connect_data(pipeline, "deep-element-added", G_CALLBACK(added_callback),
+                          new_state_ref(m_state),
+                          [](gpointer data, GClosure* /*closure*/) { delete_state_ref(data); },
+                          static_cast<GConnectFlags>(0));
+
+  // the first buffer at the sink ends the preroll, seeks and steps
+  // afterwards are up to the capture timeout
+  GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "mysink");
+  if (sink)
+  {
+    GstPad* sinkpad = gst_element_get_static_pad(sink, "sink");
+    auto probe = +[](GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) -> GstPadProbeReturn {
+      get_state(user_data)->finish();
+      return GST_PAD_PROBE_OK;
+    };
+    m_sink_probe = gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, probe,
+                                     new_state_ref(m_state), delete_state_ref);
+    gst_object_unref(sinkpad);
+    gst_object_unref(sink);
+  }
+
+  // a clock callback instead of a main loop timeout works the same for
+  // both engines
+  if (timeout >= 0)
+  {
+    GstClock* clock = gst_system_clock_obtain();
+    m_clock_id = gst_clock_new_single_shot_id(clock, gst_clock_get_time(clock) + timeout * GST_MSECOND);
+    gst_object_unref(clock);
+
+    auto clock_callback = +[](GstClock* /*clock*/, GstClockTime /*time*/, GstClockID /*id*/, gpointer user_data) -> gboolean {
+      StatePtr const& state = get_state(user_data);
+      state->fail(state->pipeline, fmt::format("no frame after {} ms", state->timeout));
+      return TRUE;
+    };
+    gst_clock_id_wait_async(m_clock_id, clock_callback, new_state_ref(m_state), delete_state_ref);
+  }
+}
+
+PrerollGuard::~PrerollGuard()
+{
+  m_state->finish();
+
+  if (m_clock_id)
+  {
+    gst_clock_id_unschedule(m_clock_id);
+    gst_clock_id_unref(m_clock_id);
+  }
+
+  if (m_sink_probe)
+  {
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(m_pipeline), "mysink");
+    GstPad* sinkpad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_remove_probe(sinkpad, m_sink_probe);
+    gst_object_unref(sinkpad);
+    gst_object_unref(sink);
+  }
+
+  g_signal_handler_disconnect(m_pipeline, m_element_added_handler);
+}
+
+/* EOF */
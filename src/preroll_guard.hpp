@@ -0,0 +1,63 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_PREROLL_GUARD_HPP
+#define HEADER_PREROLL_GUARD_HPP
+
+#include <memory>
+
+#include <gst/gst.h>
+
+/** Aborts a pipeline that doesn't get its first frame to 'mysink' in
+    time: once \a timeout milliseconds have passed or the source has
+    read more than \a max_bytes without a frame, an ErrorCode::
+    kPrerollBudget error is posted on the bus, the capture engines
+    handle it like any other pipeline error. A truncated file or one
+    the demuxer has to search through for a sync point fails this way
+    long before the capture timeout.
+
+    Must be created before the pipeline leaves READY and destroyed
+    before it goes back to the pipeline pool. */
+class PrerollGuard final
+{
+public:
+  /** shared with the probes and the clock callback, which can outlive
+      the guard for a moment */
+  struct State;
+
+private:
+  std::shared_ptr<State> m_state;
+  GstElement* m_pipeline;
+  gulong m_element_added_handler;
+  gulong m_sink_probe;
+  GstClockID m_clock_id;
+
+public:
+  /** \a timeout of -1 and \a max_bytes of 0 disable the respective
+      budget */
+  PrerollGuard(GstElement* pipeline, int timeout, guint64 max_bytes);
+  ~PrerollGuard();
+
+private:
+  PrerollGuard(const PrerollGuard&) = delete;
+  PrerollGuard& operator=(const PrerollGuard&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,155 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "qoi_writer.hpp"
+
+#include <stdexcept>
+
+#include "image_writer.hpp"
+
+namespace {
+
+constexpr uint8_t kOpIndex = 0x00;
+constexpr uint8_t kOpDiff = 0x40;
+constexpr uint8_t kOpLuma = 0x80;
+constexpr uint8_t kOpRun = 0xc0;
+constexpr uint8_t kOpRGB = 0xfe;
+
+struct Pixel
+{
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t a;
+
+  bool operator==(Pixel const& other) const {
+    return r == other.r && g == other.g && b == other.b && a == other.a;
+  }
+};
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v)
+{
+  out.push_back(static_cast<uint8_t>(v >> 24));
+  out.push_back(static_cast<uint8_t>(v >> 16));
+  out.push_back(static_cast<uint8_t>(v >>  8));
+  out.push_back(static_cast<uint8_t>(v >>  0));
+}
+
+} // namespace
+
+std::vector<uint8_t>
+encode_qoi(Cairo::RefPtr<Cairo::ImageSurface> const& img)
+{
+  if (img->get_format() != Cairo::FORMAT_RGB24 &&
+      img->get_format() != Cairo::FORMAT_ARGB32)
+  {
+    throw std::runtime_error("encode_qoi: unsupported surface format");
+  }
+
+  img->flush();
+
+  int const width = img->get_width();
+  int const height = img->get_height();
+
+  std::vector<uint8_t> out;
+  out.reserve(14 + static_cast<size_t>(width) * static_cast<size_t>(height) * 2 + 8);
+  out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+  put_u32(out, static_cast<uint32_t>(width));
+  put_u32(out, static_cast<uint32_t>(height));
+  out.push_back(3); // channels
+  out.push_back(0); // sRGB with linear alpha
+
+  // alpha is always 255, but the index starts out zeroed like the
+  // decoder's, so it still takes part in comparisons and hashing
+  Pixel index[64] = {};
+  Pixel prev{0, 0, 0, 255};
+  int run = 0;
+
+  std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+  for(int y = 0; y < height; ++y)
+  {
+    convert_row_to_rgb(img->get_data() + y * img->get_stride(), row.data(), width);
+
+    for(int x = 0; x < width; ++x)
+    {
+      Pixel const px{ row[3*x + 0], row[3*x + 1], row[3*x + 2], 255 };
+      bool const last = (y == height - 1 && x == width - 1);
+
+      if (px == prev)
+      {
+        run += 1;
+        if (run == 62 || last)
+        {
+          out.push_back(static_cast<uint8_t>(kOpRun | (run - 1)));
+          run = 0;
+        }
+        continue;
+      }
+
+      if (run > 0)
+      {
+        out.push_back(static_cast<uint8_t>(kOpRun | (run - 1)));
+        run = 0;
+      }
+
+      int const hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+      if (index[hash] == px)
+      {
+        out.push_back(static_cast<uint8_t>(kOpIndex | hash));
+      }
+      else
+      {
+        index[hash] = px;
+
+        int const vr = static_cast<int8_t>(px.r - prev.r);
+        int const vg = static_cast<int8_t>(px.g - prev.g);
+        int const vb = static_cast<int8_t>(px.b - prev.b);
+        int const vg_r = vr - vg;
+        int const vg_b = vb - vg;
+
+        if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1)
+        {
+          out.push_back(static_cast<uint8_t>(kOpDiff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+        }
+        else if (vg_r >= -8 && vg_r <= 7 && vg >= -32 && vg <= 31 && vg_b >= -8 && vg_b <= 7)
+        {
+          out.push_back(static_cast<uint8_t>(kOpLuma | (vg + 32)));
+          out.push_back(static_cast<uint8_t>((vg_r + 8) << 4 | (vg_b + 8)));
+        }
+        else
+        {
+          out.insert(out.end(), { kOpRGB, px.r, px.g, px.b });
+        }
+      }
+
+      prev = px;
+    }
+  }
+
+  out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+  return out;
+}
+
+void
+write_qoi(Cairo::RefPtr<Cairo::ImageSurface> const& img, const std::string& filename)
+{
+  write_file(filename, encode_qoi(img));
+}
+
+/* EOF */
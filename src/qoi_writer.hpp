@@ -0,0 +1,35 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_QOI_WRITER_HPP
+#define HEADER_QOI_WRITER_HPP
+
+#include <cairomm/cairomm.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Encodes \a img as a three channel "Quite OK Image", lossless and
+    several times faster to produce than PNG */
+std::vector<uint8_t> encode_qoi(Cairo::RefPtr<Cairo::ImageSurface> const& img);
+
+void write_qoi(Cairo::RefPtr<Cairo::ImageSurface> const& img, const std::string& filename);
+
+#endif
+
+/* EOF */
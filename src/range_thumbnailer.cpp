@@ -0,0 +1,208 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "range_thumbnailer.hpp"
+
+#include <stdexcept>
+
+#include "video_frame.hpp"
+
+FrameMerger::FrameMerger(Thumbnailer& thumbnailer, int num_ranges) :
+  m_thumbnailer(thumbnailer),
+  m_mutex(),
+  m_have_positions(false),
+  m_positions(),
+  m_ranges(static_cast<size_t>(num_ranges), Range{{}, false}),
+  m_current(0),
+  m_have_frame_size(false)
+{
+}
+
+std::vector<gint64>
+FrameMerger::get_range_pos(int range, gint64 duration)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // all pipelines play the same file, so the first one to preroll
+  // decides the positions for everybody
+  if (!m_have_positions)
+  {
+    m_positions = m_thumbnailer.get_thumbnail_pos(duration);
+    m_have_positions = true;
+  }
+
+  return std::vector<gint64>(m_positions.begin() + get_range_begin(range),
+                             m_positions.begin() + get_range_begin(range + 1));
+}
+
+size_t
+FrameMerger::get_num_positions()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_positions.size();
+}
+
+int
+FrameMerger::get_range_begin(int range) const
+{
+  size_t const n = m_positions.size();
+  size_t const k = m_ranges.size();
+  size_t const r = static_cast<size_t>(range);
+
+  return static_cast<int>(n * r / k);
+}
+
+void
+FrameMerger::set_frame_size(int width, int height)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (!m_have_frame_size)
+  {
+    m_thumbnailer.set_frame_size(width, height);
+    m_have_frame_size = true;
+  }
+}
+
+void
+FrameMerger::receive_frame(int range, Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  index += get_range_begin(range);
+  if (range == m_current)
+  {
+    m_thumbnailer.receive_frame(img, pos, index);
+  }
+  else
+  {
+    // the frame is only valid during this call
+    m_ranges[static_cast<size_t>(range)].pending.push_back({copy_surface(img), pos, index});
+  }
+}
+
+void
+FrameMerger::skip_frame(int range, gint64 pos, int index)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  index += get_range_begin(range);
+  if (range == m_current)
+  {
+    m_thumbnailer.skip_frame(pos, index);
+  }
+  else
+  {
+    m_ranges[static_cast<size_t>(range)].pending.push_back({{}, pos, index});
+  }
+}
+
+int
+FrameMerger::get_index(int range, int index)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return get_range_begin(range) + index;
+}
+
+void
+FrameMerger::finish_range(int range)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_ranges[static_cast<size_t>(range)].finished = true;
+  advance();
+}
+
+void
+FrameMerger::advance()
+{
+  while(m_current < get_num_ranges() &&
+        m_ranges[static_cast<size_t>(m_current)].finished)
+  {
+    m_current += 1;
+
+    if (m_current < get_num_ranges())
+    {
+      // catch up with what the next range has captured so far, its
+      // remaining frames will be passed through directly
+      Range& next = m_ranges[static_cast<size_t>(m_current)];
+      for(auto& frame : next.pending)
+      {
+        deliver(frame);
+      }
+      next.pending.clear();
+    }
+  }
+}
+
+void
+FrameMerger::deliver(Frame const& frame)
+{
+  if (frame.image)
+  {
+    m_thumbnailer.receive_frame(frame.image, frame.pos, frame.index);
+  }
+  else
+  {
+    m_thumbnailer.skip_frame(frame.pos, frame.index);
+  }
+}
+
+RangeThumbnailer::RangeThumbnailer(FrameMerger& merger, int range) :
+  m_merger(merger),
+  m_range(range)
+{
+}
+
+std::vector<gint64>
+RangeThumbnailer::get_thumbnail_pos(gint64 duration)
+{
+  return m_merger.get_range_pos(m_range, duration);
+}
+
+std::optional<size_t>
+RangeThumbnailer::get_total_positions()
+{
+  return m_merger.get_num_positions();
+}
+
+void
+RangeThumbnailer::set_frame_size(int width, int height)
+{
+  m_merger.set_frame_size(width, height);
+}
+
+void
+RangeThumbnailer::receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index)
+{
+  m_merger.receive_frame(m_range, img, pos, index);
+}
+
+void
+RangeThumbnailer::skip_frame(gint64 pos, int index)
+{
+  m_merger.skip_frame(m_range, pos, index);
+}
+
+void
+RangeThumbnailer::save(const std::string& /*filename*/, ImageWriter const& /*writer*/)
+{
+  throw std::logic_error("RangeThumbnailer::save(): save the merged Thumbnailer instead");
+}
+
+/* EOF */
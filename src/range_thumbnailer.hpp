@@ -0,0 +1,114 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_RANGE_THUMBNAILER_HPP
+#define HEADER_RANGE_THUMBNAILER_HPP
+
+#include "thumbnailer.hpp"
+
+#include <mutex>
+#include <vector>
+
+/** Splits the thumbnail positions of a Thumbnailer into contiguous
+    ranges, so that each range can be captured by its own pipeline,
+    and hands the frames back to the Thumbnailer in position order.
+    Frames of the range currently being delivered are passed through
+    directly, frames of later ranges are held back until all earlier
+    ranges have finished. */
+class FrameMerger final
+{
+private:
+  struct Frame
+  {
+    /** null for a skipped position */
+    Cairo::RefPtr<Cairo::ImageSurface> image;
+    gint64 pos;
+    int index;
+  };
+
+  struct Range
+  {
+    std::vector<Frame> pending;
+    bool finished;
+  };
+
+private:
+  Thumbnailer& m_thumbnailer;
+  std::mutex m_mutex;
+  bool m_have_positions;
+  std::vector<gint64> m_positions;
+  std::vector<Range> m_ranges;
+  int m_current;
+  bool m_have_frame_size;
+
+public:
+  FrameMerger(Thumbnailer& thumbnailer, int num_ranges);
+
+  int get_num_ranges() const { return static_cast<int>(m_ranges.size()); }
+
+  std::vector<gint64> get_range_pos(int range, gint64 duration);
+  size_t get_num_positions();
+  void set_frame_size(int width, int height);
+
+  /** \a index is relative to the positions of \a range */
+  void receive_frame(int range, Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index);
+  void skip_frame(int range, gint64 pos, int index);
+
+  /** Returns the index into the positions of the whole Thumbnailer for
+      \a index of \a range, only valid once the positions are known */
+  int get_index(int range, int index);
+
+  /** Marks \a range as complete, no more frames will arrive for it */
+  void finish_range(int range);
+
+private:
+  void advance();
+  void deliver(Frame const& frame);
+  int get_range_begin(int range) const;
+
+private:
+  FrameMerger(const FrameMerger&) = delete;
+  FrameMerger& operator=(const FrameMerger&) = delete;
+};
+
+/** The view of a single range of a FrameMerger, given to the
+    VideoProcessor responsible for that range */
+class RangeThumbnailer final : public Thumbnailer
+{
+private:
+  FrameMerger& m_merger;
+  int m_range;
+
+public:
+  RangeThumbnailer(FrameMerger& merger, int range);
+
+  std::vector<gint64> get_thumbnail_pos(gint64 duration) override;
+  std::optional<size_t> get_total_positions() override;
+  void set_frame_size(int width, int height) override;
+  void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index) override;
+  void skip_frame(gint64 pos, int index) override;
+  void save(const std::string& filename, ImageWriter const& writer) override;
+
+private:
+  RangeThumbnailer(const RangeThumbnailer&) = delete;
+  RangeThumbnailer& operator=(const RangeThumbnailer&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,117 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sampling.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+SamplingMode
+sampling_mode_from_string(const std::string& name)
+{
+  if (name == "seek")
+  {
+    return SamplingMode::kSeek;
+  }
+  else if (name == "scan")
+  {
+    return SamplingMode::kScan;
+  }
+  else if (name == "hybrid")
+  {
+    return SamplingMode::kHybrid;
+  }
+  else if (name == "auto")
+  {
+    return SamplingMode::kAuto;
+  }
+  else
+  {
+    throw std::runtime_error("unknown sampling mode: " + name + ", expected seek, scan, hybrid or auto");
+  }
+}
+
+std::string
+to_string(SamplingMode mode)
+{
+  switch(mode)
+  {
+    case SamplingMode::kSeek: return "seek";
+    case SamplingMode::kScan: return "scan";
+    case SamplingMode::kHybrid: return "hybrid";
+    case SamplingMode::kAuto: return "auto";
+  }
+  return "unknown";
+}
+
+SamplingCostModel::SamplingCostModel(gint64 gop_interval, bool accurate) :
+  m_gop_interval(gop_interval > 0 ? gop_interval : kDefaultGopInterval),
+  m_accurate(accurate)
+{
+}
+
+gint64
+SamplingCostModel::get_scan_threshold() const
+{
+  if (m_accurate)
+  {
+    // an accurate seek decodes from the previous keyframe, on average
+    // half a GOP, on top of the seek itself
+    return kSeekOverhead + m_gop_interval / 2;
+  }
+  else
+  {
+    // a key unit seek only decodes the keyframe, but positions closer
+    // than a GOP would snap to the same keyframe and repeat frames
+    return std::max(kSeekOverhead, m_gop_interval);
+  }
+}
+
+SamplingMode
+SamplingCostModel::choose(std::vector<gint64> const& positions) const
+{
+  if (positions.size() < 2)
+  {
+    return SamplingMode::kSeek;
+  }
+
+  gint64 const threshold = get_scan_threshold();
+  size_t scan_gaps = 0;
+  for(size_t i = 1; i < positions.size(); ++i)
+  {
+    if (positions[i] - positions[i-1] < threshold)
+    {
+      scan_gaps += 1;
+    }
+  }
+
+  if (scan_gaps == 0)
+  {
+    return SamplingMode::kSeek;
+  }
+  else if (scan_gaps == positions.size() - 1)
+  {
+    return SamplingMode::kScan;
+  }
+  else
+  {
+    return SamplingMode::kHybrid;
+  }
+}
+
+/* EOF */
@@ -0,0 +1,75 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_SAMPLING_HPP
+#define HEADER_SAMPLING_HPP
+
+#include <glib.h>
+#include <string>
+#include <vector>
+
+/** How the VideoProcessor gets from one thumbnail position to the next */
+enum class SamplingMode
+{
+  /** flush-seek to every position, each frame is a preroll */
+  kSeek,
+
+  /** play through the file, dropping every frame that isn't wanted */
+  kScan,
+
+  /** play through the file, but seek across gaps that are more
+      expensive to decode than to seek over */
+  kHybrid,
+
+  /** pick one of the above from the cost model */
+  kAuto
+};
+
+SamplingMode sampling_mode_from_string(const std::string& name);
+std::string to_string(SamplingMode mode);
+
+/** Estimates the cost of seeking versus decoding forward, all costs
+    are expressed in stream time that has to be decoded */
+class SamplingCostModel
+{
+public:
+  /** GOP interval assumed until one has been observed */
+  static constexpr gint64 kDefaultGopInterval = 2 * G_GINT64_CONSTANT(1000000000);
+
+  /** Fixed cost of a flush-seek and the following preroll, expressed
+      as stream time a decoder gets through in the same wall time */
+  static constexpr gint64 kSeekOverhead = G_GINT64_CONSTANT(500000000);
+
+private:
+  gint64 m_gop_interval;
+  bool m_accurate;
+
+public:
+  SamplingCostModel(gint64 gop_interval, bool accurate);
+
+  /** Gaps shorter than this are cheaper to decode through than to
+      seek across */
+  gint64 get_scan_threshold() const;
+
+  /** Picks seek, scan or hybrid for the ascending \a positions */
+  SamplingMode choose(std::vector<gint64> const& positions) const;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,167 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_SPSC_QUEUE_HPP
+#define HEADER_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+/** A bounded FIFO for exactly one producer and one consumer thread.
+    try_push() and try_pop() are lock-free, they only touch the head
+    and tail counters. push() and pop() fall back to sleeping on a
+    condition variable while the queue is full or empty, the mutex is
+    only taken to make those wakeups reliable. */
+template<typename T>
+class SPSCQueue final
+{
+private:
+  std::vector<T> m_slots;
+
+  /** number of elements popped so far, only written by the consumer */
+  alignas(64) std::atomic<size_t> m_head;
+
+  /** number of elements pushed so far, only written by the producer */
+  alignas(64) std::atomic<size_t> m_tail;
+
+  std::atomic<bool> m_closed;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+
+public:
+  explicit SPSCQueue(size_t capacity) :
+    m_slots(capacity > 0 ? capacity : 1),
+    m_head(0),
+    m_tail(0),
+    m_closed(false),
+    m_mutex(),
+    m_cond()
+  {}
+
+  size_t capacity() const { return m_slots.size(); }
+
+  /** Producer side, returns false when the queue is full */
+  bool try_push(T& value)
+  {
+    size_t const tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+    {
+      return false;
+    }
+
+    m_slots[tail % m_slots.size()] = std::move(value);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Consumer side, returns false when the queue is empty */
+  bool try_pop(T& value)
+  {
+    size_t const head = m_head.load(std::memory_order_relaxed);
+    if (m_tail.load(std::memory_order_acquire) == head)
+    {
+      return false;
+    }
+
+    value = std::move(m_slots[head % m_slots.size()]);
+    m_slots[head % m_slots.size()] = T();
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Producer side, waits while the queue is full. Returns false,
+      without taking \a value, once the queue has been closed. */
+  bool push(T value)
+  {
+    if (m_closed.load())
+    {
+      return false;
+    }
+
+    while(!try_push(value))
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]{
+        return m_closed.load() || m_tail.load() - m_head.load() < m_slots.size();
+      });
+      if (m_closed.load())
+      {
+        return false;
+      }
+    }
+
+    notify();
+    return true;
+  }
+
+  /** Consumer side, waits while the queue is empty. Returns false once
+      the queue has been closed and everything in it was popped. */
+  bool pop(T& value)
+  {
+    while(!try_pop(value))
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]{
+        return m_closed.load() || m_tail.load() != m_head.load();
+      });
+      if (m_closed.load() && m_tail.load() == m_head.load())
+      {
+        return false;
+      }
+    }
+
+    notify();
+    return true;
+  }
+
+  /** Wakes up both sides, push() fails from now on, pop() still
+      returns what is left in the queue */
+  void close()
+  {
+    m_closed.store(true);
+    notify();
+  }
+
+  bool empty() const
+  {
+    return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+  }
+
+private:
+  void notify()
+  {
+    // taking the mutex orders this against a waiter that has checked
+    // its condition but not yet gone to sleep
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_cond.notify_all();
+  }
+
+private:
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+};
+
+#endif
+
+/* EOF */
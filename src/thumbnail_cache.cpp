@@ -0,0 +1,262 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "thumbnail_cache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <glibmm.h>
+#include <logmich/log.hpp>
+
+#include "png_writer.hpp"
+
+namespace {
+
+std::string get_uri(const std::string& filename)
+{
+  return Glib::filename_to_uri(Glib::canonicalize_filename(filename));
+}
+
+/** Returns true when \a thumbnail_filename was written by store() */
+bool is_own_thumbnail(const std::string& thumbnail_filename)
+{
+  try
+  {
+    PNGText const text = read_png_text(thumbnail_filename);
+    auto it = text.find("Software");
+    return it != text.end() && it->second == "vidthumb" && text.count("X-VidThumb::Options");
+  }
+  catch(std::exception const&)
+  {
+    return false;
+  }
+}
+
+} // namespace
+
+ThumbnailCache::Flavor
+ThumbnailCache::flavor_from_string(const std::string& name)
+{
+  if (name == "normal")
+  {
+    return Flavor::kNormal;
+  }
+  else if (name == "large")
+  {
+    return Flavor::kLarge;
+  }
+  else if (name == "x-large")
+  {
+    return Flavor::kXLarge;
+  }
+  else
+  {
+    throw std::runtime_error("unknown thumbnail size: " + name + ", expected normal, large or x-large");
+  }
+}
+
+std::string
+ThumbnailCache::get_flavor_name(Flavor flavor)
+{
+  switch(flavor)
+  {
+    case Flavor::kNormal: return "normal";
+    case Flavor::kLarge: return "large";
+    case Flavor::kXLarge: return "x-large";
+  }
+  return "normal";
+}
+
+int
+ThumbnailCache::get_flavor_size(Flavor flavor)
+{
+  switch(flavor)
+  {
+    case Flavor::kNormal: return 128;
+    case Flavor::kLarge: return 256;
+    case Flavor::kXLarge: return 512;
+  }
+  return 128;
+}
+
+std::string
+ThumbnailCache::get_default_root()
+{
+  return Glib::build_filename(Glib::get_user_cache_dir(), "thumbnails");
+}
+
+ThumbnailCache::ThumbnailCache(const std::string& root, Flavor flavor, const std::string& options) :
+  m_root(root),
+  m_flavor(flavor),
+  m_options(options)
+{
+}
+
+std::string
+ThumbnailCache::get_flavor_directory() const
+{
+  return Glib::build_filename(m_root, get_flavor_name(m_flavor));
+}
+
+std::string
+ThumbnailCache::get_thumbnail_filename(const std::string& filename) const
+{
+  std::string const checksum = Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_MD5, get_uri(filename));
+  return Glib::build_filename(get_flavor_directory(), checksum + ".png");
+}
+
+bool
+ThumbnailCache::lookup(const std::string& filename) const
+{
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0)
+  {
+    return false;
+  }
+
+  std::string const thumbnail_filename = get_thumbnail_filename(filename);
+  if (access(thumbnail_filename.c_str(), R_OK) != 0)
+  {
+    return false;
+  }
+
+  try
+  {
+    PNGText const text = read_png_text(thumbnail_filename);
+
+    auto matches = [&text](const std::string& key, const std::string& value) {
+      auto it = text.find(key);
+      return it != text.end() && it->second == value;
+    };
+
+    // Thumb::Size is optional in the spec, but we always write it
+    return
+      matches("Thumb::URI", get_uri(filename)) &&
+      matches("Thumb::MTime", std::to_string(st.st_mtime)) &&
+      matches("Thumb::Size", std::to_string(st.st_size)) &&
+      matches("X-VidThumb::Options", m_options);
+  }
+  catch(std::exception const& err)
+  {
+    log_warn("ignoring broken thumbnail {}: {}", thumbnail_filename, err.what());
+    return false;
+  }
+}
+
+void
+ThumbnailCache::store(const std::string& filename, Cairo::RefPtr<Cairo::ImageSurface> const& img) const
+{
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0)
+  {
+    throw std::runtime_error("failed to stat " + filename);
+  }
+
+  // scale to fit into the flavor's box, but never scale up
+  int const size = get_flavor_size(m_flavor);
+  double const scale = std::min(1.0, std::min(static_cast<double>(size) / img->get_width(),
+                                              static_cast<double>(size) / img->get_height()));
+  int const width = std::max(1, static_cast<int>(img->get_width() * scale + 0.5));
+  int const height = std::max(1, static_cast<int>(img->get_height() * scale + 0.5));
+
+  Cairo::RefPtr<Cairo::ImageSurface> thumbnail = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, width, height);
+  {
+    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(thumbnail);
+    cr->scale(static_cast<double>(width) / img->get_width(),
+              static_cast<double>(height) / img->get_height());
+    Cairo::RefPtr<Cairo::SurfacePattern> pattern = Cairo::SurfacePattern::create(img);
+    pattern->set_filter(Cairo::FILTER_GOOD);
+    cr->set_source(pattern);
+    cr->paint();
+  }
+
+  // the spec asks for the cache to be only readable by the user
+  std::filesystem::path const directory(get_flavor_directory());
+  std::filesystem::create_directories(directory);
+  std::filesystem::permissions(directory, std::filesystem::perms::owner_all);
+
+  // created 0600 right away, not only once it is complete
+  PNGOptions opts;
+  opts.mode = 0600;
+
+  std::string const thumbnail_filename = get_thumbnail_filename(filename);
+  write_png(thumbnail, thumbnail_filename, {
+      { "Thumb::URI", get_uri(filename) },
+      { "Thumb::MTime", std::to_string(st.st_mtime) },
+      { "Thumb::Size", std::to_string(st.st_size) },
+      { "Software", "vidthumb" },
+      { "X-VidThumb::Options", m_options }
+    }, opts);
+}
+
+void
+ThumbnailCache::evict(std::uintmax_t max_bytes) const
+{
+  struct Entry
+  {
+    std::filesystem::path path;
+    std::filesystem::file_time_type mtime;
+    std::uintmax_t size;
+  };
+
+  std::error_code ec;
+  std::vector<Entry> entries;
+  std::uintmax_t total = 0;
+  for(auto const& it : std::filesystem::directory_iterator(get_flavor_directory(), ec))
+  {
+    // the directory is shared with other thumbnailers, and temporary
+    // files of concurrent writers don't end in .png
+    if (!it.is_regular_file(ec) || it.path().extension() != ".png" || !is_own_thumbnail(it.path().string()))
+    {
+      continue;
+    }
+
+    Entry entry{ it.path(), it.last_write_time(ec), it.file_size(ec) };
+    total += entry.size;
+    entries.push_back(entry);
+  }
+
+  if (total <= max_bytes)
+  {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](Entry const& lhs, Entry const& rhs) { return lhs.mtime < rhs.mtime; });
+
+  for(auto const& entry : entries)
+  {
+    if (total <= max_bytes)
+    {
+      break;
+    }
+
+    log_info("evicting {}", entry.path.string());
+    if (std::filesystem::remove(entry.path, ec))
+    {
+      total -= entry.size;
+    }
+  }
+}
+
+/* EOF */
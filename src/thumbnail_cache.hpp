@@ -0,0 +1,76 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_THUMBNAIL_CACHE_HPP
+#define HEADER_THUMBNAIL_CACHE_HPP
+
+#include <cairomm/cairomm.h>
+#include <cstdint>
+#include <string>
+
+/** A thumbnail cache following the freedesktop.org thumbnail
+    specification: thumbnails live in ROOT/{normal,large,x-large}/,
+    named by the MD5 of the file's URI, and carry Thumb::URI,
+    Thumb::MTime and Thumb::Size text chunks that are compared against
+    the file on lookup. The vidthumb options used to create the
+    thumbnail are stored as X-VidThumb::Options, so a thumbnail made
+    with different settings is not mistaken for a hit. */
+class ThumbnailCache
+{
+public:
+  enum class Flavor { kNormal, kLarge, kXLarge };
+
+  static Flavor flavor_from_string(const std::string& name);
+  static std::string get_flavor_name(Flavor flavor);
+  static int get_flavor_size(Flavor flavor);
+
+  /** Returns $XDG_CACHE_HOME/thumbnails */
+  static std::string get_default_root();
+
+private:
+  std::string m_root;
+  Flavor m_flavor;
+  std::string m_options;
+
+public:
+  ThumbnailCache(const std::string& root, Flavor flavor, const std::string& options);
+
+  /** Returns the cache location of the thumbnail for \a filename */
+  std::string get_thumbnail_filename(const std::string& filename) const;
+
+  /** Returns true if there is an up to date thumbnail for \a filename,
+      this only needs a stat() of the file and reading the header of
+      the thumbnail */
+  bool lookup(const std::string& filename) const;
+
+  /** Scales \a img down to the flavor's size and stores it as the
+      thumbnail of \a filename */
+  void store(const std::string& filename, Cairo::RefPtr<Cairo::ImageSurface> const& img) const;
+
+  /** Deletes the least recently modified thumbnails written by
+      vidthumb until they use no more than \a max_bytes, thumbnails of
+      other applications in the flavor's directory are left alone */
+  void evict(std::uintmax_t max_bytes) const;
+
+private:
+  std::string get_flavor_directory() const;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,475 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "thumbnail_server.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "json.hpp"
+#include "tracer.hpp"
+
+namespace {
+
+// longer lines are not a request anybody means to send
+constexpr size_t kMaxRequestSize = 64 * 1024;
+
+std::string get_string(JsonValue const& request, char const* key, bool required)
+{
+  JsonValue const* value = request.get(key);
+  if (!value || value->is_null())
+  {
+    if (required)
+    {
+      throw std::runtime_error(fmt::format("'{}' is required", key));
+    }
+    return {};
+  }
+
+  if (!value->is_string())
+  {
+    throw std::runtime_error(fmt::format("'{}' must be a string", key));
+  }
+  return value->as_string();
+}
+
+std::optional<int> get_int(JsonValue const& request, char const* key)
+{
+  JsonValue const* value = request.get(key);
+  if (!value || value->is_null())
+  {
+    return std::nullopt;
+  }
+
+  if (!value->is_number() || std::trunc(value->as_number()) != value->as_number() ||
+      std::abs(value->as_number()) > 1e9)
+  {
+    throw std::runtime_error(fmt::format("'{}' must be an integer", key));
+  }
+  return static_cast<int>(value->as_number());
+}
+
+std::string make_status(std::string const& id, char const* status)
+{
+  return fmt::format("{{\"id\":{},\"status\":\"{}\"}}", json_quote(id), status);
+}
+
+} // namespace
+
+ThumbnailJob
+ThumbnailJob::from_json(JsonValue const& request)
+{
+  if (!request.is_object())
+  {
+    throw std::runtime_error("request must be a JSON object");
+  }
+
+  ThumbnailJob job;
+  job.id = get_string(request, "id", true);
+  job.input = get_string(request, "input", true);
+  job.output = get_string(request, "output", false);
+  job.mode = get_string(request, "mode", false);
+  job.params = get_string(request, "params", false);
+  job.width = get_int(request, "width");
+  job.height = get_int(request, "height");
+  job.priority = get_int(request, "priority").value_or(0);
+  return job;
+}
+
+/** A client connection, responses can be sent from any thread */
+class ThumbnailServer::Connection final
+{
+private:
+  std::mutex m_mutex;
+  int m_fd;
+
+public:
+  Connection(int fd) :
+    m_mutex(),
+    m_fd(fd)
+  {}
+
+  ~Connection()
+  {
+    close();
+  }
+
+  int get_fd() const { return m_fd; }
+
+  void send(std::string const& line)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0)
+    {
+      return;
+    }
+
+    std::string const data = line + "\n";
+    size_t offset = 0;
+    while(offset < data.size())
+    {
+      ssize_t const ret = ::send(m_fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+      if (ret < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+
+        // the reader notices the broken connection and cleans up
+        log_info("failed to send response: {}", strerror(errno));
+        return;
+      }
+      offset += static_cast<size_t>(ret);
+    }
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd >= 0)
+    {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+private:
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+};
+
+ThumbnailServer::ThumbnailServer(std::string socket_path, int num_workers, Handler handler) :
+  m_socket_path(std::move(socket_path)),
+  m_num_workers(std::max(1, num_workers)),
+  m_handler(std::move(handler)),
+  m_fd(-1),
+  m_mutex(),
+  m_job_available(),
+  m_queue(),
+  m_running(),
+  m_next_serial(0)
+{
+}
+
+ThumbnailServer::~ThumbnailServer()
+{
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+    unlink(m_socket_path.c_str());
+  }
+}
+
+void
+ThumbnailServer::listen()
+{
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (m_socket_path.size() >= sizeof(addr.sun_path))
+  {
+    throw std::runtime_error("socket path too long: " + m_socket_path);
+  }
+  strncpy(addr.sun_path, m_socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  // a socket left behind by an earlier run, but never anything else
+  struct stat st;
+  if (lstat(m_socket_path.c_str(), &st) == 0)
+  {
+    if (!S_ISSOCK(st.st_mode))
+    {
+      throw std::runtime_error(m_socket_path + " exists and is not a socket");
+    }
+    unlink(m_socket_path.c_str());
+  }
+
+  m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_fd < 0)
+  {
+    throw std::runtime_error(fmt::format("failed to create socket: {}", strerror(errno)));
+  }
+
+  if (bind(m_fd, reinterpret_cast<sockaddr const*>(&addr), sizeof(addr)) != 0)
+  {
+    throw std::runtime_error(fmt::format("failed to bind {}: {}", m_socket_path, strerror(errno)));
+  }
+
+  if (::listen(m_fd, SOMAXCONN) != 0)
+  {
+    throw std::runtime_error(fmt::format("failed to listen on {}: {}", m_socket_path, strerror(errno)));
+  }
+}
+
+void
+ThumbnailServer::run()
+{
+  listen();
+  log_info("serving on {} with {} workers", m_socket_path, m_num_workers);
+
+  for(int worker = 0; worker < m_num_workers; ++worker)
+  {
+    std::thread(&ThumbnailServer::run_worker, this, worker).detach();
+  }
+
+  while(true)
+  {
+    int const fd = accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+      {
+        continue;
+      }
+      throw std::runtime_error(fmt::format("failed to accept connection: {}", strerror(errno)));
+    }
+
+    std::thread(&ThumbnailServer::run_connection, this, std::make_shared<Connection>(fd)).detach();
+  }
+}
+
+void
+ThumbnailServer::run_connection(std::shared_ptr<Connection> connection)
+{
+  log_info("client connected");
+
+  std::string buffer;
+  char chunk[4096];
+  while(true)
+  {
+    ssize_t const ret = read(connection->get_fd(), chunk, sizeof(chunk));
+    if (ret < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if (ret <= 0)
+    {
+      break;
+    }
+
+    buffer.append(chunk, static_cast<size_t>(ret));
+
+    size_t start = 0;
+    size_t newline;
+    while((newline = buffer.find('\n', start)) != std::string::npos)
+    {
+      std::string const line = buffer.substr(start, newline - start);
+      start = newline + 1;
+      if (line.find_first_not_of(" \t\r") != std::string::npos)
+      {
+        handle_request(connection, line);
+      }
+    }
+    buffer.erase(0, start);
+
+    if (buffer.size() > kMaxRequestSize)
+    {
+      connection->send(R"({"id":null,"status":"error","error":"request too large"})");
+      break;
+    }
+  }
+
+  log_info("client disconnected");
+
+  // nobody is left to receive the results
+  cancel_all(connection.get());
+  connection->close();
+}
+
+void
+ThumbnailServer::handle_request(std::shared_ptr<Connection> const& connection, std::string const& line)
+{
+  try
+  {
+    JsonValue const request = JsonValue::parse(line);
+
+    if (JsonValue const* cancel_id = request.get("cancel"))
+    {
+      if (!cancel_id->is_string())
+      {
+        throw std::runtime_error("'cancel' must be a job id");
+      }
+      cancel(connection.get(), cancel_id->as_string());
+    }
+    else
+    {
+      submit(connection, ThumbnailJob::from_json(request));
+    }
+  }
+  catch(std::exception const& err)
+  {
+    connection->send(fmt::format("{{\"id\":null,\"status\":\"error\",\"error\":{}}}", json_quote(err.what())));
+  }
+}
+
+void
+ThumbnailServer::submit(std::shared_ptr<Connection> const& connection, ThumbnailJob job)
+{
+  auto queued = std::make_shared<QueuedJob>();
+  queued->job = std::move(job);
+  queued->connection = connection;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    queued->serial = m_next_serial++;
+    m_queue.push_back(queued);
+  }
+  connection->send(make_status(queued->job.id, "queued"));
+  m_job_available.notify_one();
+}
+
+void
+ThumbnailServer::cancel(Connection const* connection, std::string const& id)
+{
+  std::shared_ptr<QueuedJob> dropped;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto const matches = [connection, &id](std::shared_ptr<QueuedJob> const& queued) {
+      return queued->connection.get() == connection && queued->job.id == id;
+    };
+
+    auto it = std::find_if(m_queue.begin(), m_queue.end(), matches);
+    if (it != m_queue.end())
+    {
+      dropped = *it;
+      m_queue.erase(it);
+    }
+    else
+    {
+      // the worker answers once the job has stopped
+      for(auto const& running : m_running)
+      {
+        if (matches(running))
+        {
+          running->cancel = true;
+        }
+      }
+      return;
+    }
+  }
+
+  dropped->connection->send(make_status(id, "cancelled"));
+}
+
+void
+ThumbnailServer::cancel_all(Connection const* connection)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+                               [connection](std::shared_ptr<QueuedJob> const& queued) {
+                                 return queued->connection.get() == connection;
+                               }),
+                m_queue.end());
+
+  for(auto const& running : m_running)
+  {
+    if (running->connection.get() == connection)
+    {
+      running->cancel = true;
+    }
+  }
+}
+
+std::shared_ptr<ThumbnailServer::QueuedJob>
+ThumbnailServer::pop()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_job_available.wait(lock, [this]{ return !m_queue.empty(); });
+
+  // highest priority first, oldest first among equals, the queue is
+  // short enough for a linear search
+  auto it = std::min_element(m_queue.begin(), m_queue.end(),
+                             [](std::shared_ptr<QueuedJob> const& lhs, std::shared_ptr<QueuedJob> const& rhs) {
+                               if (lhs->job.priority != rhs->job.priority)
+                               {
+                                 return lhs->job.priority > rhs->job.priority;
+                               }
+                               return lhs->serial < rhs->serial;
+                             });
+
+  std::shared_ptr<QueuedJob> queued = *it;
+  m_queue.erase(it);
+  m_running.push_back(queued);
+  return queued;
+}
+
+void
+ThumbnailServer::run_worker(int worker)
+{
+  Tracer::set_thread_name(fmt::format("server worker {}", worker));
+
+  // like the batch workers, every worker drives its pipelines from a
+  // main context of its own, kept for the lifetime of the server
+  Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::create();
+  g_main_context_push_thread_default(context->gobj());
+  Glib::RefPtr<Glib::MainLoop> mainloop = Glib::MainLoop::create(context, false);
+
+  while(true)
+  {
+    std::shared_ptr<QueuedJob> const queued = pop();
+    ThumbnailJob const& job = queued->job;
+    log_info("job {}: {} -> {}", job.id, job.input, job.output);
+
+    queued->connection->send(make_status(job.id, "started"));
+
+    CaptureError error;
+    try
+    {
+      error = m_handler(job, queued->cancel, mainloop);
+    }
+    catch(std::exception const& err)
+    {
+      error = { ErrorCode::kFailed, err.what() };
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running.erase(std::find(m_running.begin(), m_running.end(), queued));
+    }
+
+    if (queued->cancel)
+    {
+      queued->connection->send(make_status(job.id, "cancelled"));
+    }
+    else if (error.failed())
+    {
+      queued->connection->send(fmt::format("{{\"id\":{},\"status\":\"error\",\"code\":\"{}\",\"error\":{}}}",
+                                           json_quote(job.id), to_string(error.code),
+                                           json_quote(error.message)));
+    }
+    else
+    {
+      queued->connection->send(fmt::format("{{\"id\":{},\"status\":\"done\",\"output\":{}}}",
+                                           json_quote(job.id), json_quote(job.output)));
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,144 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_THUMBNAIL_SERVER_HPP
+#define HEADER_THUMBNAIL_SERVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glibmm.h>
+
+#include "capture_error.hpp"
+
+class JsonValue;
+
+/** A thumbnail request as received by ThumbnailServer */
+struct ThumbnailJob
+{
+  /** chosen by the client, unique among its pending jobs */
+  std::string id;
+
+  std::string input;
+  std::string output;
+
+  /** grid, directory or fourd, empty for the server's default */
+  std::string mode;
+
+  /** thumbnailer parameters, e.g. cols=5,rows=3, empty for the
+      server's default */
+  std::string params;
+
+  std::optional<int> width;
+  std::optional<int> height;
+
+  /** higher values are served first, jobs of the same priority in the
+      order they arrived */
+  int priority = 0;
+
+  /** Builds a job from a request object, throws std::runtime_error
+      when a member is missing or has the wrong type */
+  static ThumbnailJob from_json(JsonValue const& request);
+};
+
+/** Serves thumbnail requests over a Unix domain socket.
+
+    Clients send one JSON object per line and get one JSON object per
+    line back for every state change of their jobs:
+
+      > {"id":"1","input":"a.mkv","output":"a.png","mode":"grid","params":"cols=4,rows=4",
+      >  "width":320,"priority":10}
+      < {"id":"1","status":"queued"}
+      < {"id":"1","status":"started"}
+      < {"id":"1","status":"done","output":"a.png"}
+
+    A job fails with {"id":...,"status":"error","code":...,"error":...},
+    the code is one of the ErrorCode names, e.g. "corrupt". Sending
+    {"cancel":"1"} drops a queued job or stops a running one, either
+    way answered with {"id":"1","status":"cancelled"}. Closing the
+    connection cancels all of its jobs.
+
+    The jobs are run by a fixed set of workers, each with its own
+    GLib main context that stays alive between jobs. */
+class ThumbnailServer final
+{
+public:
+  /** Thumbnails \a job on a worker thread, \a mainloop runs on the
+      worker's thread-default context. Returns the error on failure.
+      \a cancel is set from another thread when the job should stop
+      early. */
+  using Handler = std::function<CaptureError (ThumbnailJob const& job,
+                                              std::atomic<bool> const& cancel,
+                                              Glib::RefPtr<Glib::MainLoop> const& mainloop)>;
+
+private:
+  class Connection;
+
+  struct QueuedJob
+  {
+    ThumbnailJob job;
+    std::shared_ptr<Connection> connection;
+    guint64 serial = 0;
+    std::atomic<bool> cancel{false};
+  };
+
+private:
+  std::string m_socket_path;
+  int m_num_workers;
+  Handler m_handler;
+  int m_fd;
+
+  std::mutex m_mutex;
+  std::condition_variable m_job_available;
+  std::vector<std::shared_ptr<QueuedJob>> m_queue;
+  std::vector<std::shared_ptr<QueuedJob>> m_running;
+  guint64 m_next_serial;
+
+public:
+  ThumbnailServer(std::string socket_path, int num_workers, Handler handler);
+  ~ThumbnailServer();
+
+  /** Listens on the socket and serves clients until the process is
+      terminated, throws when the socket can't be set up */
+  void run();
+
+private:
+  void listen();
+  void run_worker(int worker);
+  void run_connection(std::shared_ptr<Connection> connection);
+  void handle_request(std::shared_ptr<Connection> const& connection, std::string const& line);
+
+  void submit(std::shared_ptr<Connection> const& connection, ThumbnailJob job);
+  void cancel(Connection const* connection, std::string const& id);
+  void cancel_all(Connection const* connection);
+  std::shared_ptr<QueuedJob> pop();
+
+private:
+  ThumbnailServer(const ThumbnailServer&) = delete;
+  ThumbnailServer& operator=(const ThumbnailServer&) = delete;
+};
+
+#endif
+
+/* EOF */
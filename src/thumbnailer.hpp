@@ -19,17 +19,65 @@
 #ifndef HEADER_THUMBNAILER_HPP
 #define HEADER_THUMBNAILER_HPP
 
+#include <optional>
 #include <vector>
 #include <cairomm/cairomm.h>
 #include <glib.h>
 
+class ImageWriter;
+
+/** Receives the captured frames and turns them into the output.
+
+    Threading: prepare(), save() and get_image() are called from the
+    thread running the main loop. get_thumbnail_pos() and
+    set_frame_size() are called by the capture engine before any frame
+    is delivered, from the main loop thread for VideoProcessor and from
+    the capture thread for AppSinkProcessor. receive_frame() is called
+    from the engine's frame consumer thread, never from a GStreamer
+    streaming thread, and only after set_frame_size() has returned.
+    With a single pipeline there is one consumer thread, so
+    receive_frame() calls never overlap; with several pipelines the
+    FrameMerger serializes them. save() is only called once every frame
+    has been delivered. */
 class Thumbnailer
 {
 public:
   virtual ~Thumbnailer() {}
   virtual std::vector<gint64> get_thumbnail_pos(gint64 duration) =0;
-  virtual void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos) =0;
-  virtual void save(const std::string& filename) =0;
+
+  /** Returns how many positions the whole output has, when this
+      Thumbnailer only stands for a part of them, see RangeThumbnailer.
+      Only valid after get_thumbnail_pos(). */
+  virtual std::optional<size_t> get_total_positions() { return std::nullopt; }
+
+  /** Called with the arguments of the later save() before any frame
+      arrives, allows thumbnailers to write out frames as they come in */
+  virtual void prepare(const std::string& /*filename*/, ImageWriter const& /*writer*/) {}
+
+  /** Called once the size of the frames is known, before the first
+      frame arrives. Frames may still differ from it, e.g. after a
+      resolution change mid-stream. */
+  virtual void set_frame_size(int /*width*/, int /*height*/) {}
+
+  /** Receives the frame at \a pos, which was requested as element \a
+      index of get_thumbnail_pos(). Frames can arrive in any order. \a
+      img points into the mapped video buffer and is only valid for the
+      duration of the call, use copy_surface() when the pixels are
+      needed later on. */
+  virtual void receive_frame(Cairo::RefPtr<Cairo::ImageSurface> img, gint64 pos, int index) =0;
+
+  /** Called instead of receive_frame() when the capture engine gave up
+      on the position \a pos, element \a index of get_thumbnail_pos(),
+      from the same thread. Thumbnailers can fill the gap with a
+      placeholder. */
+  virtual void skip_frame(gint64 /*pos*/, int /*index*/) {}
+
+  /** Encodes the result to \a filename using \a writer */
+  virtual void save(const std::string& filename, ImageWriter const& writer) =0;
+
+  /** Returns the resulting image for thumbnailers that produce a
+      single one, used to feed the thumbnail cache */
+  virtual Cairo::RefPtr<Cairo::ImageSurface> get_image() const { return {}; }
 };
 
 #endif
@@ -0,0 +1,234 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timestamp_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <gst/gst.h>
+#include <stdexcept>
+
+namespace {
+
+char const kGlyphChars[] = "0123456789:";
+
+} // namespace
+
+TimestampRenderer::TimestampRenderer(double font_size) :
+  m_glyphs(),
+  m_cell_width(0),
+  m_cell_height(0),
+  m_ascent(0)
+{
+  // measure first, all glyphs share one cell size
+  Cairo::RefPtr<Cairo::ImageSurface> probe = Cairo::ImageSurface::create(Cairo::FORMAT_A8, 1, 1);
+
+  auto setup_font = [font_size](Cairo::RefPtr<Cairo::Context> const& cr) {
+    cr->set_font_size(font_size);
+    cr->select_font_face("Sans", Cairo::FONT_SLANT_NORMAL, Cairo::FONT_WEIGHT_NORMAL);
+    Cairo::FontOptions font_options;
+    font_options.set_hint_metrics(Cairo::HINT_METRICS_ON);
+    font_options.set_hint_style(Cairo::HINT_STYLE_FULL);
+    font_options.set_antialias(Cairo::ANTIALIAS_GRAY);
+    cr->set_font_options(font_options);
+  };
+
+  {
+    Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(probe);
+    setup_font(cr);
+
+    Cairo::FontExtents font_extents;
+    cr->get_font_extents(font_extents);
+    m_ascent = static_cast<int>(std::ceil(font_extents.ascent));
+    m_cell_height = m_ascent + static_cast<int>(std::ceil(font_extents.descent)) + 2 * kMargin;
+
+    int max_advance = 0;
+    for(size_t i = 0; i < m_glyphs.size(); ++i)
+    {
+      Cairo::TextExtents extents;
+      cr->get_text_extents(std::string(1, kGlyphChars[i]), extents);
+      m_glyphs[i].advance = static_cast<int>(std::lround(extents.x_advance));
+      max_advance = std::max(max_advance, m_glyphs[i].advance);
+    }
+    m_cell_width = max_advance + 2 * kMargin;
+  }
+
+  for(size_t i = 0; i < m_glyphs.size(); ++i)
+  {
+    Glyph& glyph = m_glyphs[i];
+
+    Cairo::RefPtr<Cairo::ImageSurface> surface = Cairo::ImageSurface::create(Cairo::FORMAT_A8,
+                                                                             m_cell_width, m_cell_height);
+    {
+      Cairo::RefPtr<Cairo::Context> cr = Cairo::Context::create(surface);
+      setup_font(cr);
+      cr->move_to(kMargin, kMargin + m_ascent);
+      cr->show_text(std::string(1, kGlyphChars[i]));
+    }
+    surface->flush();
+
+    size_t const size = static_cast<size_t>(m_cell_width * m_cell_height);
+    glyph.fill.resize(size);
+    for(int y = 0; y < m_cell_height; ++y)
+    {
+      std::copy_n(surface->get_data() + y * surface->get_stride(), m_cell_width,
+                  glyph.fill.begin() + y * m_cell_width);
+    }
+
+    // the outline is the fill grown by one pixel in every direction,
+    // what drawing the text at the eight neighbouring offsets gives
+    glyph.outline.resize(size);
+    for(int y = 0; y < m_cell_height; ++y)
+    {
+      for(int x = 0; x < m_cell_width; ++x)
+      {
+        uint8_t v = 0;
+        for(int iy = std::max(0, y - 1); iy <= std::min(m_cell_height - 1, y + 1); ++iy)
+        {
+          for(int ix = std::max(0, x - 1); ix <= std::min(m_cell_width - 1, x + 1); ++ix)
+          {
+            v = std::max(v, glyph.fill[static_cast<size_t>(iy * m_cell_width + ix)]);
+          }
+        }
+        glyph.outline[static_cast<size_t>(y * m_cell_width + x)] = v;
+      }
+    }
+  }
+}
+
+std::string
+TimestampRenderer::format(gint64 pos)
+{
+  pos = std::max<gint64>(0, pos);
+
+  int hour = static_cast<int>(pos / (GST_SECOND * 60 * 60));
+  int min  = static_cast<int>(pos / (GST_SECOND * 60)) % 60;
+  int sec  = static_cast<int>(pos / GST_SECOND) % 60;
+  return fmt::format("{:02d}:{:02d}:{:02d}", hour, min, sec);
+}
+
+TimestampRenderer::Glyph const*
+TimestampRenderer::get_glyph(char c) const
+{
+  if (c >= '0' && c <= '9')
+  {
+    return &m_glyphs[static_cast<size_t>(c - '0')];
+  }
+  else if (c == ':')
+  {
+    return &m_glyphs[10];
+  }
+  else
+  {
+    return nullptr;
+  }
+}
+
+int
+TimestampRenderer::get_width(gint64 pos) const
+{
+  int width = 0;
+  for(char c : format(pos))
+  {
+    width += get_glyph(c)->advance;
+  }
+  return width;
+}
+
+void
+TimestampRenderer::render(Cairo::RefPtr<Cairo::ImageSurface> const& surface, int x, int y, gint64 pos) const
+{
+  if (surface->get_format() != Cairo::FORMAT_RGB24 &&
+      surface->get_format() != Cairo::FORMAT_ARGB32)
+  {
+    throw std::runtime_error("TimestampRenderer: unsupported surface format");
+  }
+
+  std::string const text = format(pos);
+
+  // combine the glyphs into one mask first, so that the outline of a
+  // glyph never covers the fill of its neighbour
+  int const width = get_width(pos) + m_cell_width;
+  int const height = m_cell_height;
+  std::vector<uint8_t> fill(static_cast<size_t>(width * height));
+  std::vector<uint8_t> outline(static_cast<size_t>(width * height));
+
+  int pen = 0;
+  for(char c : text)
+  {
+    Glyph const& glyph = *get_glyph(c);
+    for(int gy = 0; gy < m_cell_height; ++gy)
+    {
+      uint8_t const* src_fill = glyph.fill.data() + gy * m_cell_width;
+      uint8_t const* src_outline = glyph.outline.data() + gy * m_cell_width;
+      uint8_t* dst_fill = fill.data() + gy * width + pen;
+      uint8_t* dst_outline = outline.data() + gy * width + pen;
+      for(int gx = 0; gx < m_cell_width; ++gx)
+      {
+        dst_fill[gx] = std::max(dst_fill[gx], src_fill[gx]);
+        dst_outline[gx] = std::max(dst_outline[gx], src_outline[gx]);
+      }
+    }
+    pen += glyph.advance;
+  }
+
+  // blend black with the outline coverage, then white with the fill
+  int const left = x - kMargin;
+  int const top = y - m_ascent - kMargin;
+
+  int const x0 = std::max(0, -left);
+  int const y0 = std::max(0, -top);
+  int const x1 = std::min(width, surface->get_width() - left);
+  int const y1 = std::min(height, surface->get_height() - top);
+  if (x0 >= x1 || y0 >= y1)
+  {
+    return;
+  }
+
+  surface->flush();
+  unsigned char* const data = surface->get_data();
+  int const stride = surface->get_stride();
+
+  for(int my = y0; my < y1; ++my)
+  {
+    uint8_t const* row_fill = fill.data() + my * width;
+    uint8_t const* row_outline = outline.data() + my * width;
+    unsigned char* dst = data + (top + my) * stride + (left + x0) * 4;
+
+    for(int mx = x0; mx < x1; ++mx, dst += 4)
+    {
+      int const af = row_fill[mx];
+      int const ao = row_outline[mx];
+      if (ao == 0 && af == 0)
+      {
+        continue;
+      }
+
+      int const mul = ((255 - ao) * (255 - af) + 127) / 255;
+      for(int c = 0; c < 3; ++c)
+      {
+        dst[c] = static_cast<unsigned char>(std::min(255, (dst[c] * mul + 127) / 255 + af));
+      }
+    }
+  }
+
+  surface->mark_dirty();
+}
+
+/* EOF */
@@ -0,0 +1,82 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_TIMESTAMP_RENDERER_HPP
+#define HEADER_TIMESTAMP_RENDERER_HPP
+
+#include <array>
+#include <cairomm/cairomm.h>
+#include <glib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** Draws HH:MM:SS timestamps, white with a black outline, onto
+    RGB24/ARGB32 surfaces. The digits and the colon are rasterized
+    once into coverage masks, drawing a timestamp only combines those
+    and blends the result into the surface, no Cairo text rendering is
+    involved.
+
+    The object is immutable after construction and can be shared
+    between threads. */
+class TimestampRenderer final
+{
+private:
+  struct Glyph
+  {
+    int advance;
+    std::vector<uint8_t> fill;
+    std::vector<uint8_t> outline;
+  };
+
+private:
+  /** space around each glyph for the outline and for parts of the
+      glyph that reach past its advance */
+  static constexpr int kMargin = 2;
+
+  /** 0-9 followed by ':' */
+  std::array<Glyph, 11> m_glyphs;
+  int m_cell_width;
+  int m_cell_height;
+  int m_ascent;
+
+public:
+  TimestampRenderer(double font_size = 12.0);
+
+  /** Formats \a pos as HH:MM:SS */
+  static std::string format(gint64 pos);
+
+  /** Width of the timestamp for \a pos, without the outline */
+  int get_width(gint64 pos) const;
+
+  /** Draws the timestamp for \a pos with the pen at \a x, \a y on the
+      baseline, like Cairo's move_to() plus show_text(), clipped to the
+      surface */
+  void render(Cairo::RefPtr<Cairo::ImageSurface> const& surface, int x, int y, gint64 pos) const;
+
+private:
+  Glyph const* get_glyph(char c) const;
+
+private:
+  TimestampRenderer(const TimestampRenderer&) = delete;
+  TimestampRenderer& operator=(const TimestampRenderer&) = delete;
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,331 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tracer.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <fmt/format.h>
+#include <logmich/log.hpp>
+
+#include "element_probe.hpp"
+#include "json.hpp"
+
+namespace {
+
+std::atomic<int> g_next_thread_id(1);
+
+thread_local int t_thread_id = 0;
+thread_local bool t_thread_named = false;
+
+/** when the decoder on this streaming thread got its last input, -1 if
+    it has produced output since */
+thread_local gint64 t_decode_start = -1;
+
+} // namespace
+
+std::atomic<Tracer*> Tracer::s_current(nullptr);
+
+Tracer::Tracer(std::string const& filename) :
+  m_filename(filename),
+  m_start(Clock::now()),
+  m_next_id(1),
+  m_mutex(),
+  m_events()
+{
+}
+
+void
+Tracer::start(std::string const& filename)
+{
+  // fail early rather than after the whole batch
+  {
+    std::ofstream out(filename);
+    if (!out)
+    {
+      throw std::runtime_error("failed to open " + filename);
+    }
+  }
+
+  delete s_current.exchange(new Tracer(filename));
+  set_thread_name("main");
+}
+
+void
+Tracer::stop()
+{
+  Tracer* tracer = s_current.exchange(nullptr);
+  if (!tracer)
+  {
+    return;
+  }
+
+  tracer->write();
+  delete tracer;
+}
+
+int
+Tracer::get_thread_id()
+{
+  if (t_thread_id == 0)
+  {
+    t_thread_id = g_next_thread_id++;
+  }
+  return t_thread_id;
+}
+
+void
+Tracer::set_thread_name(std::string const& name)
+{
+  Tracer* tracer = get();
+  if (!tracer || t_thread_named)
+  {
+    return;
+  }
+  t_thread_named = true;
+
+  tracer->add(Event{"thread_name", "__metadata", 'M', 0, 0, get_thread_id(), 0,
+                    "{\"name\":" + json_quote(name) + "}"});
+}
+
+void
+Tracer::watch_pipeline(GstElement* pipeline)
+{
+  auto callback = +[](GstBin* /*bin*/, GstBin* /*sub_bin*/, GstElement* element, gpointer /*user_data*/) {
+    on_element_added(element);
+  };
+  g_signal_connect(pipeline, "deep-element-added", G_CALLBACK(callback), nullptr);
+
+  GstElement* sink = gst_bin_get_by_name(GST_BIN(pipeline), "mysink");
+  if (!sink)
+  {
+    return;
+  }
+
+  // the probe only depends on the current tracer, add it just once to
+  // a sink that is reused from the pipeline pool
+  GstPad* sinkpad = gst_element_get_static_pad(sink, "sink");
+  if (sinkpad && !g_object_get_data(G_OBJECT(sinkpad), "vidthumb-traced"))
+  {
+    g_object_set_data(G_OBJECT(sinkpad), "vidthumb-traced", GINT_TO_POINTER(1));
+    auto probe = +[](GstPad* /*pad*/, GstPadProbeInfo* info, gpointer /*user_data*/) -> GstPadProbeReturn {
+      if (Tracer* tracer = get())
+      {
+        GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+        tracer->instant("frame", "gstreamer",
+                        GST_BUFFER_PTS_IS_VALID(buffer) ?
+                        fmt::format("{{\"pts\":{}}}", GST_BUFFER_PTS(buffer)) :
+                        std::string());
+      }
+      return GST_PAD_PROBE_OK;
+    };
+    gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, probe, nullptr, nullptr);
+  }
+
+  if (sinkpad)
+  {
+    gst_object_unref(sinkpad);
+  }
+  gst_object_unref(sink);
+}
+
+void
+Tracer::on_element_added(GstElement* element)
+{
+  if (!is_video_decoder(element))
+  {
+    return;
+  }
+
+  // a decode span runs from the decoder's input to its next output on
+  // the same streaming thread, with frame threading that includes the
+  // wait for the frames still in flight
+  GstPad* sinkpad = gst_element_get_static_pad(element, "sink");
+  if (sinkpad)
+  {
+    auto probe = +[](GstPad* pad, GstPadProbeInfo* /*info*/, gpointer /*user_data*/) -> GstPadProbeReturn {
+      if (Tracer* tracer = get())
+      {
+        if (!t_thread_named)
+        {
+          set_thread_name(fmt::format("{} streaming", GST_OBJECT_NAME(GST_OBJECT_PARENT(pad))));
+        }
+        if (t_decode_start < 0)
+        {
+          t_decode_start = tracer->to_usec(Clock::now());
+        }
+      }
+      return GST_PAD_PROBE_OK;
+    };
+    gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, probe, nullptr, nullptr);
+    gst_object_unref(sinkpad);
+  }
+
+  GstPad* srcpad = gst_element_get_static_pad(element, "src");
+  if (srcpad)
+  {
+    auto probe = +[](GstPad* pad, GstPadProbeInfo* /*info*/, gpointer /*user_data*/) -> GstPadProbeReturn {
+      Tracer* tracer = get();
+      if (tracer && t_decode_start >= 0)
+      {
+        gint64 const now = tracer->to_usec(Clock::now());
+        tracer->add(Event{"decode", "gstreamer", 'X', t_decode_start, now - t_decode_start,
+                          get_thread_id(), 0,
+                          "{\"element\":" + json_quote(GST_OBJECT_NAME(GST_OBJECT_PARENT(pad))) + "}"});
+        t_decode_start = -1;
+      }
+      return GST_PAD_PROBE_OK;
+    };
+    gst_pad_add_probe(srcpad, GST_PAD_PROBE_TYPE_BUFFER, probe, nullptr, nullptr);
+    gst_object_unref(srcpad);
+  }
+}
+
+gint64
+Tracer::to_usec(Clock::time_point time) const
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(time - m_start).count();
+}
+
+void
+Tracer::add(Event event)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_events.push_back(std::move(event));
+}
+
+void
+Tracer::complete(std::string name, char const* category,
+                 Clock::time_point start, Clock::time_point end, std::string args)
+{
+  add(Event{std::move(name), category, 'X', to_usec(start), to_usec(end) - to_usec(start),
+            get_thread_id(), 0, std::move(args)});
+}
+
+void
+Tracer::async(std::string name, char const* category,
+              Clock::time_point start, Clock::time_point end, std::string args)
+{
+  guint64 const id = m_next_id++;
+  add(Event{name, category, 'b', to_usec(start), 0, get_thread_id(), id, std::move(args)});
+  add(Event{std::move(name), category, 'e', to_usec(end), 0, get_thread_id(), id, {}});
+}
+
+void
+Tracer::instant(std::string name, char const* category, std::string args)
+{
+  add(Event{std::move(name), category, 'i', to_usec(Clock::now()), 0, get_thread_id(), 0, std::move(args)});
+}
+
+void
+Tracer::write() const
+{
+  std::ofstream out(m_filename);
+  if (!out)
+  {
+    log_error("failed to write trace to {}", m_filename);
+    return;
+  }
+
+  int const pid = static_cast<int>(getpid());
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for(Event const& event : m_events)
+  {
+    out << (first ? "" : ",\n")
+        << "{\"name\":" << json_quote(event.name)
+        << ",\"cat\":" << json_quote(event.category)
+        << ",\"ph\":\"" << event.phase << "\""
+        << ",\"ts\":" << event.ts
+        << ",\"pid\":" << pid
+        << ",\"tid\":" << event.tid;
+
+    switch(event.phase)
+    {
+      case 'X':
+        out << ",\"dur\":" << event.dur;
+        break;
+
+      case 'b':
+      case 'e':
+        out << ",\"id\":" << event.id;
+        break;
+
+      case 'i':
+        out << ",\"s\":\"t\"";
+        break;
+
+      default:
+        break;
+    }
+
+    if (!event.args.empty())
+    {
+      out << ",\"args\":" << event.args;
+    }
+    out << "}";
+    first = false;
+  }
+  out << "\n]}\n";
+
+  if (!out)
+  {
+    log_error("failed to write trace to {}", m_filename);
+  }
+}
+
+TraceSpan::TraceSpan(char const* name, char const* category) :
+  m_tracer(Tracer::get()),
+  m_name(name),
+  m_category(category),
+  m_start(m_tracer ? Tracer::Clock::now() : Tracer::Clock::time_point()),
+  m_args()
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+  if (m_tracer)
+  {
+    m_tracer->complete(m_name, m_category, m_start, Tracer::Clock::now(),
+                       m_args.empty() ? std::string() : "{" + m_args + "}");
+  }
+}
+
+void
+TraceSpan::set_arg(char const* key, std::string const& value)
+{
+  if (m_tracer)
+  {
+    m_args += (m_args.empty() ? "" : ",") + json_quote(key) + ":" + json_quote(value);
+  }
+}
+
+void
+TraceSpan::set_arg(char const* key, gint64 value)
+{
+  if (m_tracer)
+  {
+    m_args += (m_args.empty() ? "" : ",") + json_quote(key) + ":" + std::to_string(value);
+  }
+}
+
+/* EOF */
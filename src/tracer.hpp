@@ -0,0 +1,134 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_TRACER_HPP
+#define HEADER_TRACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gst/gst.h>
+
+/** Records spans in the Chrome trace-event format, the file loads in
+    Perfetto or chrome://tracing. There is at most one Tracer per
+    process, installed with start(), when there is none all the
+    recording functions do nothing and cost an atomic load. */
+class Tracer final
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  struct Event
+  {
+    std::string name;
+    char const* category;
+    char phase;
+    gint64 ts;
+    gint64 dur;
+    int tid;
+    guint64 id;
+
+    /** rendered JSON object or empty */
+    std::string args;
+  };
+
+private:
+  static std::atomic<Tracer*> s_current;
+
+  std::string m_filename;
+  Clock::time_point const m_start;
+  std::atomic<guint64> m_next_id;
+
+  std::mutex m_mutex;
+  std::vector<Event> m_events;
+
+public:
+  static Tracer* get() { return s_current.load(std::memory_order_acquire); }
+
+  /** Starts recording, the events are written to \a filename by
+      stop() */
+  static void start(std::string const& filename);
+
+  /** Writes the trace and stops recording, nothing must be recorded
+      concurrently */
+  static void stop();
+
+  /** Names the calling thread in the trace, only the first name
+      given to a thread sticks */
+  static void set_thread_name(std::string const& name);
+
+  /** Records the buffers passing through the video decoders and the
+      sink 'mysink' of \a pipeline on the streaming threads */
+  static void watch_pipeline(GstElement* pipeline);
+
+  /** Records a span that starts and ends on the calling thread */
+  void complete(std::string name, char const* category,
+                Clock::time_point start, Clock::time_point end, std::string args = {});
+
+  /** Records a span that may start and end on different threads, it
+      gets a track of its own */
+  void async(std::string name, char const* category,
+             Clock::time_point start, Clock::time_point end, std::string args = {});
+
+  void instant(std::string name, char const* category, std::string args = {});
+
+private:
+  Tracer(std::string const& filename);
+
+  gint64 to_usec(Clock::time_point time) const;
+  void add(Event event);
+  void write() const;
+
+  static int get_thread_id();
+  static void on_element_added(GstElement* element);
+
+private:
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+};
+
+/** Records the lifetime of the object as a span on the calling thread */
+class TraceSpan final
+{
+private:
+  Tracer* m_tracer;
+  char const* m_name;
+  char const* m_category;
+  Tracer::Clock::time_point m_start;
+  std::string m_args;
+
+public:
+  TraceSpan(char const* name, char const* category = "vidthumb");
+  ~TraceSpan();
+
+  /** Attaches an argument to the span, does nothing when not tracing */
+  void set_arg(char const* key, std::string const& value);
+  void set_arg(char const* key, gint64 value);
+
+private:
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#endif
+
+/* EOF */
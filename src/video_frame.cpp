@@ -0,0 +1,252 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "video_frame.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+
+#include "pixel_convert.hpp"
+
+namespace {
+
+bool get_pixel_format(GstVideoFormat format, PixelFormat& result)
+{
+  switch(format)
+  {
+    case GST_VIDEO_FORMAT_I420:
+      result = PixelFormat::kI420;
+      return true;
+
+    case GST_VIDEO_FORMAT_NV12:
+      result = PixelFormat::kNV12;
+      return true;
+
+    case GST_VIDEO_FORMAT_P010_10LE:
+      result = PixelFormat::kP010;
+      return true;
+
+    case GST_VIDEO_FORMAT_BGRx:
+      result = PixelFormat::kBGRx;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/** The area of a \a width x \a height surface the picture covers when
+    it has to keep its display aspect ratio, centered with borders on
+    two sides, like videoscale's add-borders */
+Cairo::RectangleInt get_letterbox(GstVideoInfo const& info, int width, int height)
+{
+  guint64 const src_width = static_cast<guint64>(GST_VIDEO_INFO_WIDTH(&info)) * std::max(1, GST_VIDEO_INFO_PAR_N(&info));
+  guint64 const src_height = static_cast<guint64>(GST_VIDEO_INFO_HEIGHT(&info)) * std::max(1, GST_VIDEO_INFO_PAR_D(&info));
+
+  int fit_width = width;
+  int fit_height = height;
+  if (static_cast<guint64>(width) * src_height > static_cast<guint64>(height) * src_width)
+  {
+    fit_width = std::max(1, static_cast<int>((static_cast<guint64>(height) * src_width + src_height / 2) / src_height));
+  }
+  else
+  {
+    fit_height = std::max(1, static_cast<int>((static_cast<guint64>(width) * src_height + src_width / 2) / src_width));
+  }
+
+  return { (width - fit_width) / 2, (height - fit_height) / 2, fit_width, fit_height };
+}
+
+} // namespace
+
+VideoFrame::VideoFrame(Glib::RefPtr<Gst::Buffer> const& buffer,
+                       Glib::RefPtr<Gst::Caps> const& caps) :
+  VideoFrame(buffer, caps, std::nullopt, std::nullopt)
+{
+}
+
+VideoFrame::VideoFrame(Glib::RefPtr<Gst::Buffer> const& buffer,
+                       Glib::RefPtr<Gst::Caps> const& caps,
+                       std::optional<int> width, std::optional<int> height,
+                       bool keep_aspect_ratio) :
+  m_info(),
+  m_frame(),
+  m_mapped(false),
+  m_surface()
+{
+  if (!gst_video_info_from_caps(&m_info, caps->gobj()))
+  {
+    throw std::runtime_error("VideoFrame: failed to parse caps");
+  }
+
+  PixelFormat format;
+  if (!get_pixel_format(GST_VIDEO_INFO_FORMAT(&m_info), format))
+  {
+    throw std::runtime_error("VideoFrame: unsupported format: " +
+                             std::string(gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&m_info))));
+  }
+
+  int const src_width = GST_VIDEO_INFO_WIDTH(&m_info);
+  int const src_height = GST_VIDEO_INFO_HEIGHT(&m_info);
+  auto const [dst_width, dst_height] = get_frame_size(m_info, width, height, keep_aspect_ratio);
+  Cairo::RectangleInt const rect = (keep_aspect_ratio && width && height) ?
+    get_letterbox(m_info, dst_width, dst_height) :
+    Cairo::RectangleInt{ 0, 0, dst_width, dst_height };
+
+  if (!gst_video_frame_map(&m_frame, &m_info, buffer->gobj(), GST_MAP_READ))
+  {
+    throw std::runtime_error("VideoFrame: failed to map buffer");
+  }
+  m_mapped = true;
+
+  if (format == PixelFormat::kBGRx && rect.width == src_width && rect.height == src_height &&
+      rect.width == dst_width && rect.height == dst_height)
+  {
+    // BGRx is what Cairo calls RGB24 on little endian, every pixel is
+    // four bytes, so any GStreamer stride is also a valid Cairo stride.
+    // The memory is only mapped for reading, which is fine as nothing
+    // ever draws onto the frame.
+    m_surface = Cairo::ImageSurface::create(static_cast<unsigned char*>(GST_VIDEO_FRAME_PLANE_DATA(&m_frame, 0)),
+                                            Cairo::FORMAT_RGB24,
+                                            GST_VIDEO_FRAME_WIDTH(&m_frame),
+                                            GST_VIDEO_FRAME_HEIGHT(&m_frame),
+                                            GST_VIDEO_FRAME_PLANE_STRIDE(&m_frame, 0));
+  }
+  else
+  {
+    SourceImage src;
+    src.format = format;
+    src.width = src_width;
+    src.height = src_height;
+    for(guint i = 0; i < GST_VIDEO_FRAME_N_PLANES(&m_frame) && i < 3; ++i)
+    {
+      src.planes[i] = static_cast<uint8_t const*>(GST_VIDEO_FRAME_PLANE_DATA(&m_frame, i));
+      src.strides[i] = GST_VIDEO_FRAME_PLANE_STRIDE(&m_frame, i);
+    }
+    src.matrix = (GST_VIDEO_INFO_COLORIMETRY(&m_info).matrix == GST_VIDEO_COLOR_MATRIX_BT709) ?
+      YuvMatrix::kBT709 : YuvMatrix::kBT601;
+    src.full_range = (GST_VIDEO_INFO_COLORIMETRY(&m_info).range == GST_VIDEO_COLOR_RANGE_0_255);
+
+    // a new surface is black, which gives the borders
+    m_surface = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, dst_width, dst_height);
+
+    TargetImage dst;
+    dst.data = m_surface->get_data() + rect.y * m_surface->get_stride() + rect.x * 4;
+    dst.width = rect.width;
+    dst.height = rect.height;
+    dst.stride = m_surface->get_stride();
+    try
+    {
+      convert_downscale(src, dst);
+    }
+    catch(...)
+    {
+      gst_video_frame_unmap(&m_frame);
+      throw;
+    }
+
+    m_surface->mark_dirty();
+
+    // the surface owns its pixels, no need to hold on to the buffer
+    gst_video_frame_unmap(&m_frame);
+    m_mapped = false;
+  }
+}
+
+VideoFrame::~VideoFrame()
+{
+  m_surface->finish();
+  m_surface.clear();
+
+  if (m_mapped)
+  {
+    gst_video_frame_unmap(&m_frame);
+  }
+}
+
+std::pair<int, int>
+get_frame_size(GstVideoInfo const& info, std::optional<int> width, std::optional<int> height,
+               bool keep_aspect_ratio)
+{
+  int const src_width = GST_VIDEO_INFO_WIDTH(&info);
+  int const src_height = GST_VIDEO_INFO_HEIGHT(&info);
+  int const par_n = std::max(1, GST_VIDEO_INFO_PAR_N(&info));
+  int const par_d = std::max(1, GST_VIDEO_INFO_PAR_D(&info));
+
+  int dst_width = src_width;
+  int dst_height = src_height;
+  if (!keep_aspect_ratio)
+  {
+    // -A, whatever isn't given stays as it is
+    dst_width = width.value_or(src_width);
+    dst_height = height.value_or(src_height);
+  }
+  else if (width && height)
+  {
+    dst_width = *width;
+    dst_height = *height;
+  }
+  else if (width)
+  {
+    dst_width = *width;
+    dst_height = static_cast<int>(gst_util_uint64_scale_int_round(static_cast<guint64>(*width),
+                                                                  src_height * par_d, src_width * par_n));
+  }
+  else if (height)
+  {
+    dst_height = *height;
+    dst_width = static_cast<int>(gst_util_uint64_scale_int_round(static_cast<guint64>(*height),
+                                                                 src_width * par_n, src_height * par_d));
+  }
+  else
+  {
+    // square pixels at the same height, like videoscale with
+    // pixel-aspect-ratio=1/1
+    dst_width = static_cast<int>(gst_util_uint64_scale_int_round(static_cast<guint64>(src_width),
+                                                                 par_n, par_d));
+  }
+
+  return { std::max(1, dst_width), std::max(1, dst_height) };
+}
+
+Cairo::RefPtr<Cairo::ImageSurface>
+copy_surface(Cairo::RefPtr<Cairo::ImageSurface> const& img)
+{
+  img->flush();
+
+  Cairo::RefPtr<Cairo::ImageSurface> result = Cairo::ImageSurface::create(img->get_format(),
+                                                                          img->get_width(),
+                                                                          img->get_height());
+
+  int const row_size = std::min(img->get_stride(), result->get_stride());
+  unsigned char const* src = img->get_data();
+  unsigned char* dst = result->get_data();
+  for(int y = 0; y < img->get_height(); ++y)
+  {
+    memcpy(dst + y * result->get_stride(),
+           src + y * img->get_stride(),
+           static_cast<size_t>(row_size));
+  }
+
+  result->mark_dirty();
+
+  return result;
+}
+
+/* EOF */
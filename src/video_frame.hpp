@@ -0,0 +1,84 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_VIDEO_FRAME_HPP
+#define HEADER_VIDEO_FRAME_HPP
+
+#include <cairomm/cairomm.h>
+#include <gstreamermm.h>
+#include <gst/video/video.h>
+#include <optional>
+#include <utility>
+
+/** Maps a BGRx Gst::Buffer for reading and exposes the pixels as a
+    Cairo::ImageSurface without copying them. Plane offset and stride
+    are taken from the GstVideoMeta when the buffer carries one.
+
+    I420, NV12 and P010_10LE buffers, or BGRx buffers that need
+    scaling, are converted and area-averaged into a surface of their
+    own by convert_downscale() instead.
+
+    The surface points into the mapped buffer and is only valid for
+    the lifetime of the VideoFrame, it is finished on destruction, so
+    that a stray reference can't read unmapped memory. Use
+    copy_surface() to keep the pixels around. */
+class VideoFrame final
+{
+private:
+  GstVideoInfo m_info;
+  GstVideoFrame m_frame;
+  bool m_mapped;
+  Cairo::RefPtr<Cairo::ImageSurface> m_surface;
+
+public:
+  VideoFrame(Glib::RefPtr<Gst::Buffer> const& buffer,
+             Glib::RefPtr<Gst::Caps> const& caps);
+
+  /** Scales the frame to \a width x \a height, see get_frame_size() */
+  VideoFrame(Glib::RefPtr<Gst::Buffer> const& buffer,
+             Glib::RefPtr<Gst::Caps> const& caps,
+             std::optional<int> width, std::optional<int> height,
+             bool keep_aspect_ratio = true);
+  ~VideoFrame();
+
+  Cairo::RefPtr<Cairo::ImageSurface> get_surface() const { return m_surface; }
+
+private:
+  VideoFrame(const VideoFrame&) = delete;
+  VideoFrame& operator=(const VideoFrame&) = delete;
+};
+
+/** Returns the size of the surface VideoFrame produces for frames
+    described by \a info when asked to scale them to \a width and/or
+    \a height. Follows what videoscale does with the caps of
+    get_output_caps(): with \a keep_aspect_ratio the pixels come out
+    square and a missing dimension follows from the display aspect
+    ratio, keeping the height when neither is given. When both are
+    given the surface has that size and VideoFrame letterboxes the
+    picture into it. Without \a keep_aspect_ratio missing dimensions
+    stay as they are. */
+std::pair<int, int> get_frame_size(GstVideoInfo const& info,
+                                   std::optional<int> width, std::optional<int> height,
+                                   bool keep_aspect_ratio = true);
+
+/** Returns a deep copy of \a img that owns its pixel data */
+Cairo::RefPtr<Cairo::ImageSurface> copy_surface(Cairo::RefPtr<Cairo::ImageSurface> const& img);
+
+#endif
+
+/* EOF */
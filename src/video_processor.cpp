@@ -31,7 +31,27 @@
 #include <fmt/ostream.h>
 #include <logmich/log.hpp>
 
+#include "capture_stats.hpp"
+#include "element_probe.hpp"
+#include "frame_consumer.hpp"
+#include "keyframe_index.hpp"
+#include "pipeline_pool.hpp"
+#include "preroll_guard.hpp"
 #include "thumbnailer.hpp"
+#include "tracer.hpp"
+#include "video_frame.hpp"
+
+namespace {
+
+// enough to cover the time a slow thumbnailer needs for one frame,
+// while holding on to only a few of the decoder's buffers
+constexpr size_t kFrameQueueSize = 4;
+
+// how often the timeout is checked, a poll every m_timeout would let a
+// stuck file take up to twice the timeout
+constexpr int kTimeoutPollInterval = 100;
+
+} // namespace
 
 std::string to_string(Gst::State state)
 {
@@ -52,81 +72,262 @@ std::string to_string(Gst::State state)
   }
 }
 
-VideoProcessor::VideoProcessor(Glib::RefPtr<Glib::MainLoop> mainloop,
+VideoProcessor::VideoProcessor(Glib::RefPtr<Glib::MainContext> context,
                                Thumbnailer& thumbnailer) :
-  m_mainloop(mainloop),
+  m_context(context),
   m_thumbnailer(thumbnailer),
+  m_stats(),
+  m_open_time(),
+  m_seek_time(),
+  m_stepping(false),
+  m_consumer(),
+  m_pool(),
   m_pipeline(),
   m_fakesink(),
+  m_element_added_handler(0),
+  m_sink_probe(0),
+  m_handoff_connections(),
+  m_preroll_guard(),
   m_thumbnailer_pos(),
+  m_positions(),
+  m_current_index(-1),
+  m_current_target(),
+  m_fallback(),
+  m_deadline_connection(),
+  m_degraded(),
+  m_duration(0),
+  m_total_positions(0),
   m_done(false),
   m_running(false),
-  m_timeout_id(0),
+  m_finished(false),
+  m_timeout_connection(),
   m_timeout(-1),
   m_accurate(false),
   m_last_screenshot(),
-  m_opts()
+  m_expected_frames(0),
+  m_frame_count(0),
+  m_error(),
+  m_error_code(ErrorCode::kNone),
+  m_sig_finished(),
+  m_opts(),
+  m_keyframe_index(),
+  m_last_pos(-1),
+  m_sampling(SamplingMode::kSeek),
+  m_gop_interval(-1),
+  m_last_keyframe(-1),
+  m_gop_sum(0),
+  m_gop_count(0),
+  m_gop_probe_from(-1),
+  m_gop_probing(false),
+  m_gop_probe_pos(-1),
+  m_gop_probed(false),
+  m_scan_mutex(),
+  m_scanning(false),
+  m_scan_targets(),
+  m_scan_next(0),
+  m_scan_seek_pending(false),
+  m_scan_accept_next(false),
+  m_segment(),
+  m_seek_waiting(false),
+  m_seek_flushing(false)
 {
+  gst_segment_init(&m_segment, GST_FORMAT_TIME);
 }
 
 VideoProcessor::~VideoProcessor()
 {
-  if (m_timeout_id)
+  m_timeout_connection.disconnect();
+  m_deadline_connection.disconnect();
+
+  if (m_pipeline)
   {
-    g_source_remove(m_timeout_id);
-    m_timeout_id = 0;
+    // no streaming thread may still be in one of the callbacks below
+    m_pipeline->set_state(Gst::STATE_READY);
+    m_preroll_guard.reset();
+
+    if (m_element_added_handler)
+    {
+      g_signal_handler_disconnect(m_pipeline->gobj(), m_element_added_handler);
+    }
+
+    for(auto& connection : m_handoff_connections)
+    {
+      connection.disconnect();
+    }
+
+    if (m_sink_probe)
+    {
+      GstPad* sinkpad = gst_element_get_static_pad(GST_ELEMENT(m_fakesink->gobj()), "sink");
+      gst_pad_remove_probe(sinkpad, m_sink_probe);
+      gst_object_unref(sinkpad);
+    }
+
+    // the main context is reused for the next file and the pipeline
+    // possibly too, so the watch must not outlive this object
+    gst_bus_remove_watch(m_pipeline->get_bus()->gobj());
+
+    GstElement* pipeline = GST_ELEMENT(m_pipeline->gobj_copy());
+    m_fakesink.reset();
+    m_pipeline.reset();
+    PipelinePool::release(m_pool.get(), pipeline, !has_error());
   }
+
+  m_consumer.reset();
 }
 
 std::string
 VideoProcessor::get_pipeline_desc() const
 {
-  std::ostringstream pipeline_desc;
+  return ::get_pipeline_desc(m_opts, "fakesink name=mysink signal-handoffs=True sync=False");
+}
+
+void
+VideoProcessor::setup_pipeline()
+{
+  log_info("Using pipeline: {}", get_pipeline_desc());
+  m_pipeline = Glib::wrap(GST_PIPELINE(PipelinePool::acquire(m_pool.get(), m_opts, PipelineSink::kFakeSink)));
+
+  m_fakesink = Glib::RefPtr<Gst::FakeSink>::cast_static(m_pipeline->get_element("mysink"));
+
+  Glib::RefPtr<Gst::Bus> thumbnail_bus = m_pipeline->get_bus();
 
-  pipeline_desc <<
-    "uridecodebin name=mysource "
-    "  ! videoscale "
-    "  ! videoconvert ";
+  // intercept the frame data and makes thumbnails, preroll-handoff
+  // delivers the frames after each seek, handoff the frames while
+  // playing through the file in scan mode
+  m_handoff_connections = {
+    m_fakesink->signal_preroll_handoff().connect(sigc::mem_fun(*this, &VideoProcessor::on_preroll_handoff)),
+    m_fakesink->signal_handoff().connect(sigc::mem_fun(*this, &VideoProcessor::on_handoff))
+  };
 
-  // force output format
-  pipeline_desc << "  ! video/x-raw,format=BGRx";
-  if (m_opts.width)
+  // track segments and flushes, needed to map buffer timestamps to
+  // stream time and to tell when a seek has taken effect
   {
-    pipeline_desc << ",width=" << *m_opts.width;
+    auto callback = +[](GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) -> GstPadProbeReturn {
+      static_cast<VideoProcessor*>(user_data)->on_sink_event(GST_PAD_PROBE_INFO_EVENT(info));
+      return GST_PAD_PROBE_OK;
+    };
+    GstPad* sinkpad = gst_element_get_static_pad(GST_ELEMENT(m_fakesink->gobj()), "sink");
+    m_sink_probe = gst_pad_add_probe(sinkpad,
+                                     static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
+                                                                  GST_PAD_PROBE_TYPE_EVENT_FLUSH),
+                                     callback, this, nullptr);
+    gst_object_unref(sinkpad);
   }
 
-  if (m_opts.height)
+  // listen to bus messages, the watch is attached to the thread-default
+  // main context, which must be m_context
+  thumbnail_bus->add_watch(sigc::mem_fun(*this, &VideoProcessor::on_bus_message));
+
+  // decoders are only created once uridecodebin has figured out the
+  // stream type, catch them as they get plugged in
   {
-    pipeline_desc << ",height=" << *m_opts.height;
+    auto callback = +[](GstBin* /*bin*/, GstBin* /*sub_bin*/, GstElement* element, gpointer user_data) {
+      static_cast<VideoProcessor*>(user_data)->on_element_added(element);
+    };
+    m_element_added_handler = g_signal_connect(m_pipeline->gobj(), "deep-element-added",
+                                               G_CALLBACK(callback), this);
+  }
+}
+
+void
+VideoProcessor::on_element_added(GstElement* element)
+{
+  if (!is_video_decoder(element))
+  {
+    return;
+  }
+
+  // watch the keyframes going into the decoder to learn the GOP
+  // interval for the sampling cost model
+  {
+    GstPad* sinkpad = gst_element_get_static_pad(element, "sink");
+    if (sinkpad)
+    {
+      auto callback = +[](GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) -> GstPadProbeReturn {
+        static_cast<VideoProcessor*>(user_data)->on_decoder_buffer(GST_PAD_PROBE_INFO_BUFFER(info));
+        return GST_PAD_PROBE_OK;
+      };
+      gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, callback, this, nullptr);
+      gst_object_unref(sinkpad);
+    }
   }
 
-  if (m_opts.keep_aspect_ratio)
+  if (!m_opts.keyframes_only)
   {
-    pipeline_desc << ",pixel-aspect-ratio=1/1";
+    return;
   }
 
-  pipeline_desc << "  ! fakesink name=mysink signal-handoffs=True sync=False ";
+  log_info("keyframes-only: configuring decoder {}", GST_ELEMENT_NAME(element));
 
-  return pipeline_desc.str();
+  // reduced resolution decoding is a decoder specific feature, avdec_*
+  // exposes it as 'lowres' for the codecs that support it, the level
+  // has to be picked before the decoder is opened, i.e. when the caps
+  // arrive
+  if ((m_opts.width || m_opts.height) &&
+      g_object_class_find_property(G_OBJECT_GET_CLASS(element), "lowres"))
+  {
+    GstPad* sinkpad = gst_element_get_static_pad(element, "sink");
+    if (sinkpad)
+    {
+      auto callback = +[](GstPad* pad, GstPadProbeInfo* info, gpointer user_data) -> GstPadProbeReturn {
+        GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+        if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS)
+        {
+          GstCaps* caps = nullptr;
+          gst_event_parse_caps(event, &caps);
+          GstElement* decoder = gst_pad_get_parent_element(pad);
+          if (decoder)
+          {
+            static_cast<VideoProcessor*>(user_data)->on_decoder_caps(decoder, caps);
+            gst_object_unref(decoder);
+          }
+        }
+        return GST_PAD_PROBE_OK;
+      };
+      gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, callback, this, nullptr);
+      gst_object_unref(sinkpad);
+    }
+  }
 }
 
 void
-VideoProcessor::setup_pipeline()
+VideoProcessor::on_decoder_caps(GstElement* decoder, GstCaps* caps)
 {
-  auto pipeline_desc = get_pipeline_desc();
-  log_info("Using pipeline: {}", pipeline_desc);
-  Glib::RefPtr<Gst::Element> playbin = Gst::Parse::launch(pipeline_desc);
-  m_pipeline = m_pipeline.cast_static(playbin);
-
-  m_fakesink = Glib::RefPtr<Gst::FakeSink>::cast_static(m_pipeline->get_element("mysink"));
+  GstStructure* structure = gst_caps_get_structure(caps, 0);
+  int width = 0;
+  int height = 0;
+  if (!gst_structure_get_int(structure, "width", &width) ||
+      !gst_structure_get_int(structure, "height", &height))
+  {
+    return;
+  }
 
-  Glib::RefPtr<Gst::Bus> thumbnail_bus = m_pipeline->get_bus();
+  GParamSpec* pspec = g_object_class_find_property(G_OBJECT_GET_CLASS(decoder), "lowres");
+  int max_level = 0;
+  if (G_IS_PARAM_SPEC_ENUM(pspec))
+  {
+    max_level = G_PARAM_SPEC_ENUM(pspec)->enum_class->maximum;
+  }
+  else if (G_IS_PARAM_SPEC_INT(pspec))
+  {
+    max_level = G_PARAM_SPEC_INT(pspec)->maximum;
+  }
 
-  // intercept the frame data and makes thumbnails
-  m_fakesink->signal_preroll_handoff().connect(sigc::mem_fun(*this, &VideoProcessor::on_preroll_handoff));
+  // each level halves the decoded size, stop before it would drop
+  // below the requested size
+  int level = 0;
+  while (level < max_level &&
+         (!m_opts.width || (width >> (level + 1)) >= *m_opts.width) &&
+         (!m_opts.height || (height >> (level + 1)) >= *m_opts.height))
+  {
+    level += 1;
+  }
 
-  // listen to bus messages
-  thumbnail_bus->add_watch(sigc::mem_fun(*this, &VideoProcessor::on_bus_message));
+  if (level > 0)
+  {
+    log_info("keyframes-only: decoding {}x{} at 1/{} resolution", width, height, 1 << level);
+    g_object_set(decoder, "lowres", level, nullptr);
+  }
 }
 
 void
@@ -135,20 +336,34 @@ VideoProcessor::set_accurate(bool accurate)
   m_accurate = accurate;
 }
 
+void
+VideoProcessor::set_keyframe_index(std::shared_ptr<KeyframeIndex const> index)
+{
+  m_keyframe_index = std::move(index);
+}
+
+void
+VideoProcessor::set_stats(std::shared_ptr<CaptureStats> stats)
+{
+  m_stats = std::move(stats);
+}
+
 void
 VideoProcessor::set_options(const VideoProcessorOptions opts)
 {
   m_opts = opts;
 }
 
+void
+VideoProcessor::set_pipeline_pool(std::shared_ptr<PipelinePool> pool)
+{
+  m_pool = std::move(pool);
+}
+
 void
 VideoProcessor::set_timeout(int timeout)
 {
-  if (m_timeout_id)
-  {
-    g_source_remove(m_timeout_id);
-    m_timeout_id = 0;
-  }
+  m_timeout_connection.disconnect();
 
   m_timeout = timeout;
 
@@ -156,18 +371,32 @@ VideoProcessor::set_timeout(int timeout)
   {
     m_last_screenshot = g_get_real_time();
     log_info("------------------------------------ install time out " );
-    auto callback = [](gpointer user_data) -> gboolean
-      {
-        return static_cast<VideoProcessor*>(user_data)->on_timeout();
-      };
-    g_timeout_add(m_timeout, callback, this);
+    m_timeout_connection = m_context->signal_timeout().connect(sigc::mem_fun(*this, &VideoProcessor::on_timeout),
+                                                               std::min(m_timeout, kTimeoutPollInterval));
   }
 }
 
 void
 VideoProcessor::open(const std::string& filename)
 {
+  TraceSpan span("VideoProcessor::open");
+  span.set_arg("file", filename);
+
+  m_open_time = std::chrono::steady_clock::now();
+
   setup_pipeline();
+  if (m_stats)
+  {
+    CaptureStats::watch_pipeline(m_stats, GST_ELEMENT(m_pipeline->gobj()));
+  }
+
+  if (Tracer::get())
+  {
+    Tracer::watch_pipeline(GST_ELEMENT(m_pipeline->gobj()));
+  }
+
+  m_preroll_guard = std::make_unique<PrerollGuard>(GST_ELEMENT(m_pipeline->gobj()),
+                                                   m_opts.preroll_timeout, m_opts.preroll_max_bytes);
 
   Glib::ustring uri = Glib::filename_to_uri(Glib::canonicalize_filename(filename));
 
@@ -178,6 +407,16 @@ VideoProcessor::open(const std::string& filename)
   m_pipeline->set_state(Gst::STATE_PAUSED);
 }
 
+void
+VideoProcessor::cancel()
+{
+  if (!m_finished)
+  {
+    set_error(ErrorCode::kCancelled, "cancelled");
+    queue_shutdown();
+  }
+}
+
 gint64
 VideoProcessor::get_duration()
 {
@@ -212,90 +451,691 @@ VideoProcessor::get_position()
   return 0;
 }
 
+Gst::SeekFlags
+VideoProcessor::get_seek_flags() const
+{
+  return ::get_seek_flags(m_opts, m_accurate, m_keyframe_index && !m_keyframe_index->empty());
+}
+
 void
 VideoProcessor::seek_step()
 {
   log_info("!!!!!!!!!!!!!!!! seek_step: {}", m_thumbnailer_pos.size());
+  TraceSpan span("seek_step");
+
+  m_deadline_connection.disconnect();
+
+  // the frame of a probe seek that missed its deadline may still be on
+  // its way too
+  bool const after_fallback = m_fallback.has_value() || m_gop_probed;
+  m_gop_probed = false;
+  if (m_fallback)
+  {
+    // the previous position got its frame, or was given up on, only
+    // after missing the deadline
+    m_degraded.push_back(DegradedCell{m_current_target.index, m_current_target.pos, *m_fallback});
+    m_fallback.reset();
+  }
 
   if (!m_thumbnailer_pos.empty())
   {
-    Gst::SeekFlags seek_flags;
-    if (m_accurate)
+    m_current_target = m_thumbnailer_pos.back();
+    m_thumbnailer_pos.pop_back();
+
+    gint64 const target = m_current_target.pos;
+    m_current_index = m_current_target.index;
+
     {
-      seek_flags = Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_ACCURATE;  // slow
+      std::lock_guard<std::mutex> lock(m_scan_mutex);
+      m_seek_waiting = true;
+
+      // a frame of an abandoned fallback seek may still be on its way
+      // and where the decoder stands is anybody's guess, so only a
+      // flushing seek will do and only frames after its flush count
+      m_seek_flushing = after_fallback;
+      if (after_fallback)
+      {
+        m_last_pos = -1;
+      }
     }
-    else
+    arm_seek_deadline();
+
+    if (!after_fallback && can_decode_forward(target))
     {
-      seek_flags = Gst::SEEK_FLAG_FLUSH | Gst::SEEK_FLAG_KEY_UNIT | Gst::SEEK_FLAG_SNAP_NEAREST;  // fast
+      // the target is in the GOP that is already being decoded, step
+      // the sink forward instead of decoding from the keyframe again,
+      // the sink prerolls on the frame at the end of the step
+      log_info("--> REQUEST STEP: {} -> {}", m_last_pos, target);
+      m_seek_time = std::chrono::steady_clock::now();
+      m_stepping = true;
+      if (gst_element_send_event(GST_ELEMENT(m_pipeline->gobj()),
+                                 gst_event_new_step(GST_FORMAT_TIME, target - m_last_pos, 1.0, TRUE, FALSE)))
+      {
+        return;
+      }
+
+      log_warn("step to {} failed, seeking instead", target);
     }
 
-    log_info("--> REQUEST SEEK: {}", m_thumbnailer_pos.back());
+    Gst::SeekFlags const seek_flags = get_seek_flags();
+
+    log_info("--> REQUEST SEEK: {}", target);
+    m_seek_time = std::chrono::steady_clock::now();
+    m_stepping = false;
     if (!m_pipeline->seek(Gst::FORMAT_TIME,
                           seek_flags,
-                          m_thumbnailer_pos.back()))
+                          target))
     {
-      log_info(">>>>>>>>>>>>>>>>>>>> SEEK FAILURE <<<<<<<<<<<<<<<<<<");
+      log_warn("seek to {} failed", target);
+      seek_fallback();
     }
-
-    m_thumbnailer_pos.pop_back();
   }
   else
   {
     log_info("---------- DONE ------------");
 
+    if (m_frame_count == 0 && m_expected_frames > 0)
+    {
+      set_error(ErrorCode::kCorrupt, "no frames captured");
+    }
+
     queue_shutdown();
 
     m_done = true;
   }
 }
 
-Cairo::RefPtr<Cairo::ImageSurface> buffer2cairo(Glib::RefPtr<Gst::Buffer> const& buffer, Glib::RefPtr<Gst::Pad> const& pad)
+void
+VideoProcessor::on_preroll_handoff(Glib::RefPtr<Gst::Buffer> const& buffer,
+                                   Glib::RefPtr<Gst::Pad> const& pad)
 {
-  Glib::RefPtr<Gst::Caps> caps = pad->get_current_caps();
-  Gst::Structure structure = caps->get_structure(0);
+  log_debug("preroll_handoff: {}", get_position());
+
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    if (m_gop_probing)
+    {
+      if (!m_seek_flushing)
+      {
+        m_gop_probing = false;
+        guint64 const stream_time = GST_BUFFER_PTS_IS_VALID(buffer->gobj()) ?
+          gst_segment_to_stream_time(&m_segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer->gobj())) :
+          GST_CLOCK_TIME_NONE;
+        m_gop_probe_pos = GST_CLOCK_TIME_IS_VALID(stream_time) ? static_cast<gint64>(stream_time) : -1;
+        m_context->signal_idle().connect(sigc::mem_fun(*this, &VideoProcessor::on_idle_gop_probe));
+      }
+      return;
+    }
+  }
+
+  if (m_running && m_sampling == SamplingMode::kSeek)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_scan_mutex);
+      if (!m_seek_waiting || m_seek_flushing)
+      {
+        // left over from a seek that missed its deadline
+        return;
+      }
+      m_seek_waiting = false;
+    }
+
+    m_last_screenshot = g_get_real_time();
 
-  int width, height;
-  structure.get_field("width",  width);
-  structure.get_field("height", height);
+    gint64 const pos = get_position();
+
+    auto const now = std::chrono::steady_clock::now();
+    if (m_stats)
+    {
+      m_stats->add_seek(now - m_seek_time);
+    }
+
+    if (Tracer* tracer = Tracer::get())
+    {
+      tracer->async(m_stepping ? "step" : "seek", "vidthumb", m_seek_time, now,
+                    fmt::format("{{\"pos\":{},\"index\":{}}}", pos, m_current_index));
+    }
+
+    // the conversion and compositing happen on the consumer thread,
+    // the next seek doesn't have to wait for them
+    m_consumer->push(buffer, pad->get_current_caps(), pos, {m_current_index});
+    m_frame_count += 1;
+
+    // the frame the decoder stopped at, stepping forward continues from here
+    {
+      std::lock_guard<std::mutex> lock(m_scan_mutex);
+      guint64 const stream_time = GST_BUFFER_PTS_IS_VALID(buffer->gobj()) ?
+        gst_segment_to_stream_time(&m_segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buffer->gobj())) :
+        GST_CLOCK_TIME_NONE;
+      m_last_pos = GST_CLOCK_TIME_IS_VALID(stream_time) ? static_cast<gint64>(stream_time) : pos;
+    }
 
-  Cairo::RefPtr<Cairo::ImageSurface> img = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, width, height);
+    m_context->signal_idle().connect(sigc::mem_fun(*this, &VideoProcessor::on_idle_seek_step));
+  }
+}
 
-  unsigned char* op = img->get_data();
+bool
+VideoProcessor::on_idle_seek_step()
+{
+  seek_step();
+  return false;
+}
 
-  int ostride = img->get_stride();
-  int istride = static_cast<int>(buffer->get_size() / height);
-  for(int y = 0; y < height; ++y)
+void
+VideoProcessor::arm_seek_deadline()
+{
+  m_deadline_connection.disconnect();
+  if (m_opts.seek_deadline >= 0)
   {
-    buffer->extract(y * istride,
-                    op + y * ostride,
-                    width * 4);
+    m_deadline_connection = m_context->signal_timeout().connect(sigc::mem_fun(*this, &VideoProcessor::on_seek_deadline),
+                                                                m_opts.seek_deadline);
   }
+}
 
-  return img;
+bool
+VideoProcessor::on_seek_deadline()
+{
+  seek_fallback();
+  return false;
 }
 
 void
-VideoProcessor::on_preroll_handoff(Glib::RefPtr<Gst::Buffer> const& buffer,
-                                   Glib::RefPtr<Gst::Pad> const& pad)
+VideoProcessor::seek_fallback()
 {
-  log_info(">>>>>>>>>>>>>>>>> preroll_handoff: {}", get_position());
-  if (m_running)
+  if (m_finished)
   {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    if (!m_seek_waiting)
+    {
+      // the frame made it after all, seek_step() is already queued
+      return;
+    }
+    m_seek_flushing = true;
+  }
+
+  m_fallback = get_next_seek_fallback(m_fallback);
+  log_warn("no frame for position {} at {}, falling back to: {}",
+           m_current_target.index, m_current_target.pos, to_string(*m_fallback));
+
+  if (*m_fallback == SeekFallback::kSkipped)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_scan_mutex);
+      m_seek_waiting = false;
+      m_seek_flushing = false;
+    }
+
+    // giving up on a position is progress too, as far as the timeout
+    // is concerned
     m_last_screenshot = g_get_real_time();
-    auto img = buffer2cairo(buffer, pad);
-    m_thumbnailer.receive_frame(img, get_position());
+    m_consumer->skip(m_current_target.pos, m_current_target.index);
+    seek_step();
+    return;
+  }
 
-    Glib::signal_idle().connect([this]() -> gboolean {
+  gint64 const pos = (*m_fallback == SeekFallback::kNeighbour) ?
+    get_neighbour_pos(m_current_target.pos, m_duration, m_total_positions) :
+    m_current_target.pos;
+
+  log_info("--> REQUEST FALLBACK SEEK: {}", pos);
+  m_seek_time = std::chrono::steady_clock::now();
+  m_stepping = false;
+  arm_seek_deadline();
+  if (!m_pipeline->seek(Gst::FORMAT_TIME, get_fallback_seek_flags(m_opts), pos))
+  {
+    log_warn("fallback seek to {} failed", pos);
+    seek_fallback();
+  }
+}
+
+void
+VideoProcessor::on_handoff(Glib::RefPtr<Gst::Buffer> const& buffer,
+                           Glib::RefPtr<Gst::Pad> const& pad)
+{
+  std::lock_guard<std::mutex> lock(m_scan_mutex);
+
+  // frames still in flight from before a seek are of no interest
+  if (!m_scanning || m_scan_seek_pending || m_scan_next >= m_scan_targets.size())
+  {
+    return;
+  }
+
+  // decoding makes progress, even if the frame gets dropped
+  m_last_screenshot = g_get_real_time();
+
+  GstBuffer* buf = buffer->gobj();
+  if (!GST_BUFFER_PTS_IS_VALID(buf))
+  {
+    return;
+  }
+
+  guint64 const stream_time = gst_segment_to_stream_time(&m_segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buf));
+  if (!GST_CLOCK_TIME_IS_VALID(stream_time))
+  {
+    return;
+  }
+
+  gint64 const pos = static_cast<gint64>(stream_time);
+  gint64 const frame_end = pos + (GST_BUFFER_DURATION_IS_VALID(buf) ?
+                                  static_cast<gint64>(GST_BUFFER_DURATION(buf)) : 1);
+
+  if (!m_scan_accept_next && m_scan_targets[m_scan_next].pos >= frame_end)
+  {
+    // not there yet, keep decoding
+    return;
+  }
+  m_scan_accept_next = false;
+
+  // with very dense positions a single frame can cover several of them
+  size_t const first = m_scan_next;
+  do
+  {
+    m_scan_next += 1;
+  }
+  while (m_scan_next < m_scan_targets.size() && m_scan_targets[m_scan_next].pos < frame_end);
+
+  log_debug("handoff: {} ({} positions)", pos, m_scan_next - first);
+  std::vector<int> indices;
+  for(size_t i = first; i < m_scan_next; ++i)
+  {
+    indices.push_back(m_scan_targets[i].index);
+  }
+  m_consumer->push(buffer, pad->get_current_caps(), pos, std::move(indices));
+  m_frame_count += static_cast<int>(m_scan_next - first);
+
+  if (m_scan_next >= m_scan_targets.size())
+  {
+    // m_thumbnailer_pos is empty, so seek_step() finishes the run
+    m_scanning = false;
+    m_context->signal_idle().connect(sigc::mem_fun(*this, &VideoProcessor::on_idle_seek_step));
+  }
+  else if (m_sampling == SamplingMode::kHybrid &&
+           m_scan_targets[m_scan_next].pos - pos > SamplingCostModel(get_gop_interval(), m_accurate).get_scan_threshold())
+  {
+    m_scan_seek_pending = true;
+    m_context->signal_idle().connect(sigc::mem_fun(*this, &VideoProcessor::on_idle_scan_seek));
+  }
+}
+
+void
+VideoProcessor::on_sink_event(GstEvent* event)
+{
+  switch(GST_EVENT_TYPE(event))
+  {
+    case GST_EVENT_FLUSH_STOP:
+      {
+        std::lock_guard<std::mutex> lock(m_scan_mutex);
+        m_seek_flushing = false;
+        if (m_scan_seek_pending)
+        {
+          // everything from here on is from after the seek, a key unit
+          // seek lands next to the position, so take whatever comes first
+          m_scan_seek_pending = false;
+          m_scan_accept_next = !m_accurate;
+        }
+      }
+      break;
+
+    case GST_EVENT_SEGMENT:
+      {
+        std::lock_guard<std::mutex> lock(m_scan_mutex);
+        gst_event_copy_segment(event, &m_segment);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void
+VideoProcessor::on_decoder_buffer(GstBuffer* buffer)
+{
+  if (GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DISCONT))
+  {
+    // the distance to the keyframe before a seek says nothing about
+    // the GOP
+    m_last_keyframe = -1;
+  }
+
+  if (GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+  {
+    return;
+  }
+
+  GstClockTime const ts = GST_BUFFER_PTS_IS_VALID(buffer) ? GST_BUFFER_PTS(buffer) : GST_BUFFER_DTS(buffer);
+  if (!GST_CLOCK_TIME_IS_VALID(ts))
+  {
+    return;
+  }
+
+  gint64 const keyframe = static_cast<gint64>(ts);
+  if (m_last_keyframe >= 0 && keyframe > m_last_keyframe)
+  {
+    m_gop_sum += keyframe - m_last_keyframe;
+    m_gop_count += 1;
+    m_gop_interval = m_gop_sum / m_gop_count;
+  }
+  m_last_keyframe = keyframe;
+}
+
+gint64
+VideoProcessor::get_gop_interval() const
+{
+  if (m_gop_interval > 0)
+  {
+    return m_gop_interval;
+  }
+  else if (m_keyframe_index)
+  {
+    return m_keyframe_index->get_average_interval().value_or(-1);
+  }
+  else
+  {
+    return -1;
+  }
+}
+
+void
+VideoProcessor::start_sampling()
+{
+  auto const now = std::chrono::steady_clock::now();
+  if (m_stats)
+  {
+    m_stats->add_preroll(now - m_open_time);
+  }
+
+  if (Tracer* tracer = Tracer::get())
+  {
+    tracer->async("preroll", "vidthumb", m_open_time, now);
+  }
+
+  m_duration = get_duration();
+  m_positions = get_capture_positions(m_thumbnailer, m_duration,
+                                      m_accurate, m_keyframe_index.get());
+  m_expected_frames = m_positions.size();
+  m_total_positions = m_thumbnailer.get_total_positions().value_or(m_positions.size());
+
+  announce_frame_size();
+
+  m_consumer = std::make_unique<FrameConsumer>(m_thumbnailer,
+                                               m_opts.fused_convert ? m_opts.width : std::nullopt,
+                                               m_opts.fused_convert ? m_opts.height : std::nullopt,
+                                               m_opts.keep_aspect_ratio,
+                                               kFrameQueueSize, m_stats);
+
+  m_running = true;
+
+  if (m_opts.sampling == SamplingMode::kAuto && get_gop_interval() <= 0 && m_positions.size() >= 2)
+  {
+    // the choice depends on the GOP interval, measure it instead of
+    // guessing
+    start_gop_probe();
+  }
+  else
+  {
+    start_capture();
+  }
+}
+
+void
+VideoProcessor::start_capture()
+{
+  SamplingCostModel const cost_model(get_gop_interval(), m_accurate);
+  m_sampling = (m_opts.sampling == SamplingMode::kAuto) ? cost_model.choose(m_positions) : m_opts.sampling;
+  log_info("sampling: {} for {} positions, GOP interval: {}{}",
+           to_string(m_sampling), m_positions.size(), get_gop_interval(),
+           get_gop_interval() > 0 ? "" : " (assuming the default)");
+
+  std::vector<Target> targets;
+  for(size_t i = 0; i < m_positions.size(); ++i)
+  {
+    targets.push_back(Target{m_positions[i], static_cast<int>(i)});
+  }
+
+  if (m_sampling == SamplingMode::kSeek)
+  {
+    m_thumbnailer_pos = targets;
+    std::reverse(m_thumbnailer_pos.begin(), m_thumbnailer_pos.end());
+    seek_step();
+  }
+  else
+  {
+    if (targets.empty())
+    {
       seek_step();
+      return;
+    }
+
+    std::stable_sort(targets.begin(), targets.end(),
+                     [](Target const& lhs, Target const& rhs) { return lhs.pos < rhs.pos; });
+    m_scan_targets = targets;
+    m_scan_next = 0;
+    start_scan();
+  }
+}
+
+void
+VideoProcessor::announce_frame_size()
+{
+  // the sink has prerolled, so the caps are negotiated and the
+  // thumbnailer can set up its canvas before the first frame
+  GstPad* sinkpad = gst_element_get_static_pad(GST_ELEMENT(m_fakesink->gobj()), "sink");
+  GstCaps* caps = gst_pad_get_current_caps(sinkpad);
+  gst_object_unref(sinkpad);
+  if (!caps)
+  {
+    return;
+  }
+
+  GstVideoInfo info;
+  bool const valid = gst_video_info_from_caps(&info, caps);
+  gst_caps_unref(caps);
+  if (!valid)
+  {
+    return;
+  }
+
+  auto const [width, height] = get_frame_size(info,
+                                              m_opts.fused_convert ? m_opts.width : std::nullopt,
+                                              m_opts.fused_convert ? m_opts.height : std::nullopt,
+                                              m_opts.keep_aspect_ratio);
+  m_thumbnailer.set_frame_size(width, height);
+}
+
+void
+VideoProcessor::start_gop_probe()
+{
+  m_gop_probe_from = get_position();
+  m_gop_probed = true;
+
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    m_gop_probing = true;
+
+    // only the frame after the flush is the probe's
+    m_seek_flushing = true;
+  }
+
+  m_deadline_connection.disconnect();
+  m_deadline_connection = m_context->signal_timeout().connect(sigc::mem_fun(*this, &VideoProcessor::on_gop_probe_deadline),
+                                                              get_gop_probe_deadline(m_opts));
+
+  log_info("--> REQUEST GOP PROBE SEEK: {}", m_gop_probe_from + 1);
+  if (!m_pipeline->seek(Gst::FORMAT_TIME, get_gop_probe_seek_flags(m_opts), m_gop_probe_from + 1))
+  {
+    log_warn("GOP probe: seek failed");
+    {
+      std::lock_guard<std::mutex> lock(m_scan_mutex);
+      m_gop_probing = false;
+      m_seek_flushing = false;
+    }
+    finish_gop_probe(-1);
+  }
+}
+
+bool
+VideoProcessor::on_idle_gop_probe()
+{
+  gint64 pos;
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    pos = m_gop_probe_pos;
+  }
+  finish_gop_probe(pos);
+  return false;
+}
+
+bool
+VideoProcessor::on_gop_probe_deadline()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    if (!m_gop_probing)
+    {
+      // the frame made it after all, on_idle_gop_probe() is queued
+      return false;
+    }
+    m_gop_probing = false;
+  }
+
+  log_warn("GOP probe: no keyframe after {}", m_gop_probe_from);
+  finish_gop_probe(-1);
+  return false;
+}
+
+void
+VideoProcessor::finish_gop_probe(gint64 pos)
+{
+  m_deadline_connection.disconnect();
+  if (m_finished)
+  {
+    return;
+  }
+
+  if (pos > m_gop_probe_from)
+  {
+    log_info("GOP probe: keyframes at {} and {}", m_gop_probe_from, pos);
+    m_gop_interval = pos - m_gop_probe_from;
+  }
+
+  start_capture();
+}
+
+void
+VideoProcessor::skip_past_eos()
+{
+  std::lock_guard<std::mutex> lock(m_scan_mutex);
+  if (!m_scanning)
+  {
+    return;
+  }
+
+  for(size_t i = m_scan_next; i < m_scan_targets.size(); ++i)
+  {
+    Target const& target = m_scan_targets[i];
+    log_warn("no frame for position {} at {}, the stream ended before it", target.index, target.pos);
+    m_degraded.push_back(DegradedCell{target.index, target.pos, SeekFallback::kSkipped});
+    m_consumer->skip(target.pos, target.index);
+  }
+  m_scan_next = m_scan_targets.size();
+  m_scanning = false;
+}
+
+void
+VideoProcessor::start_scan()
+{
+  bool seek = false;
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    m_scanning = true;
+
+    // don't decode the whole beginning of the file just to get to the
+    // first position, this matters for the later ranges of --pipelines,
+    // after the GOP probe the pipeline has to go back anyway
+    if (m_gop_probed ||
+        m_scan_targets.front().pos > SamplingCostModel(get_gop_interval(), m_accurate).get_scan_threshold())
+    {
+      m_scan_seek_pending = true;
+      seek = true;
+    }
+  }
+  m_gop_probed = false;
+
+  if (seek)
+  {
+    on_idle_scan_seek();
+  }
+
+  m_pipeline->set_state(Gst::STATE_PLAYING);
+}
+
+bool
+VideoProcessor::can_decode_forward(gint64 target) const
+{
+  // key unit seeks land on the keyframe and decode nothing else, only
+  // accurate seeks decode the GOP up to the target
+  if (!m_accurate || m_opts.keyframes_only || m_last_pos < 0 || target <= m_last_pos)
+  {
+    return false;
+  }
+
+  if (m_keyframe_index && !m_keyframe_index->empty())
+  {
+    // a keyframe in between means a seek decodes less
+    std::optional<gint64> const next_keyframe = m_keyframe_index->get_next_keyframe(m_last_pos);
+    return !next_keyframe || *next_keyframe > target;
+  }
+  else
+  {
+    // without knowing where the keyframes are, fall back to the
+    // estimated GOP interval
+    return target - m_last_pos < SamplingCostModel(get_gop_interval(), m_accurate).get_scan_threshold();
+  }
+}
+
+Gst::SeekFlags
+VideoProcessor::get_scan_seek_flags() const
+{
+  return ::get_scan_seek_flags(m_opts, m_accurate);
+}
+
+bool
+VideoProcessor::on_idle_scan_seek()
+{
+  gint64 target;
+  {
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    if (!m_scanning || m_scan_next >= m_scan_targets.size())
+    {
+      m_scan_seek_pending = false;
       return false;
-    });
+    }
+    target = m_scan_targets[m_scan_next].pos;
+  }
+
+  log_info("--> REQUEST SCAN SEEK: {}", target);
+  if (!m_pipeline->seek(Gst::FORMAT_TIME, get_scan_seek_flags(), target))
+  {
+    // keep decoding forward instead
+    log_warn("scan seek to {} failed", target);
+    std::lock_guard<std::mutex> lock(m_scan_mutex);
+    m_scan_seek_pending = false;
   }
+
+  return false;
 }
 
 bool
 VideoProcessor::on_bus_message(Glib::RefPtr<Gst::Bus> const& bus,
                                Glib::RefPtr<Gst::Message> const& message)
 {
+  TraceSpan span("on_bus_message");
+
   switch(message->get_message_type())
   {
     case Gst::MESSAGE_ERROR:
@@ -306,10 +1146,25 @@ VideoProcessor::on_bus_message(Glib::RefPtr<Gst::Bus> const& bus,
         std::cerr << "Error: " << err.what() << std::endl;
         log_error("MessageError: {}", err.what().raw());
 
+        set_error(error_code_from_gerror(err.domain(), err.code()), err.what().raw());
         queue_shutdown();
       }
       break;
 
+    case Gst::MESSAGE_ELEMENT:
+      {
+        // decodebin carries on without the stream, which for the video
+        // stream means waiting for the timeout
+        std::string description;
+        if (is_missing_video_plugin(message->gobj(), &description))
+        {
+          log_error("missing plugin: {}", description);
+          set_error(ErrorCode::kMissingPlugin, "missing plugin: " + description);
+          queue_shutdown();
+        }
+      }
+      break;
+
     case Gst::MESSAGE_STATE_CHANGED:
       {
         Gst::State oldstate;
@@ -325,13 +1180,10 @@ VideoProcessor::on_bus_message(Glib::RefPtr<Gst::Bus> const& bus,
 
         if (state_changed_msg->get_source() == m_fakesink &&
             newstate == Gst::STATE_PAUSED &&
-            !m_running)
+            !m_running && !m_finished)
         {
           log_info("##################################### ONLY ONCE: ################");
-          m_thumbnailer_pos = m_thumbnailer.get_thumbnail_pos(get_duration());
-          std::reverse(m_thumbnailer_pos.begin(), m_thumbnailer_pos.end());
-          m_running = true;
-          seek_step();
+          start_sampling();
         }
       }
       break;
@@ -339,6 +1191,10 @@ VideoProcessor::on_bus_message(Glib::RefPtr<Gst::Bus> const& bus,
     case Gst::MESSAGE_EOS:
       {
         log_debug("GST_MESSAGE_EOS");
+
+        // positions past the last frame, e.g. with a duration that
+        // overstates the stream, never see a handoff
+        skip_past_eos();
         queue_shutdown();
       }
       break;
@@ -412,33 +1268,82 @@ VideoProcessor::on_bus_message(Glib::RefPtr<Gst::Bus> const& bus,
 void
 VideoProcessor::queue_shutdown()
 {
-  Glib::signal_idle().connect([this]() -> gboolean {
-    shutdown();
-    return false;
-  });
+  m_context->signal_idle().connect(sigc::mem_fun(*this, &VideoProcessor::on_idle_shutdown));
+}
+
+bool
+VideoProcessor::on_idle_shutdown()
+{
+  shutdown();
+  return false;
+}
+
+void
+VideoProcessor::set_error(ErrorCode code, std::string const& error)
+{
+  // keep the first error, later ones are usually just consequences of it
+  if (m_error.empty())
+  {
+    m_error = error;
+    m_error_code = code;
+  }
 }
 
 void
 VideoProcessor::shutdown()
 {
   log_info("Going to shutdown!!!!!!!!!!!");
-  m_pipeline->set_state(Gst::STATE_NULL);
-  m_mainloop->quit();
+
+  // queue_shutdown() can be triggered more than once, e.g. by EOS
+  // followed by a timeout, only report the first one
+  if (m_finished)
+  {
+    return;
+  }
+  m_finished = true;
+  m_deadline_connection.disconnect();
+
+  TraceSpan span("shutdown");
+  // READY stops the streaming threads just as well and leaves the
+  // pipeline ready for the pool
+  m_pipeline->set_state(Gst::STATE_READY);
+
+  // the streaming threads are gone, deliver what is still queued
+  if (m_consumer)
+  {
+    m_consumer->finish();
+    std::string const error = m_consumer->get_error();
+    if (!error.empty())
+    {
+      set_error(ErrorCode::kFailed, error);
+    }
+  }
+
+  m_sig_finished.emit();
 }
 
 bool
 VideoProcessor::on_timeout()
 {
+  if (m_finished)
+  {
+    return false;
+  }
+
   guint64 t = g_get_real_time();
 
   t = t - m_last_screenshot;
 
   double t_d = static_cast<double>(t) / G_USEC_PER_SEC;
 
-  log_info("TIMEOUT: {} {}", t_d, m_timeout);
+  log_debug("TIMEOUT: {} {}", t_d, m_timeout);
   if (t_d > m_timeout/1000.0)
   {
     log_info("--------- timeout ----------------: {}", t_d);
+    if (!m_done)
+    {
+      set_error(ErrorCode::kTimeout, fmt::format("timeout after {:.1f}s", t_d));
+    }
     queue_shutdown();
   }
 
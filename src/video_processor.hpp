@@ -23,32 +23,45 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <optional>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
 #include <glibmm.h>
 #include <gstreamermm.h>
 
-class Thumbnailer;
+#include "capture_engine.hpp"
+#include "sampling.hpp"
 
-struct VideoProcessorOptions
-{
-  std::optional<int> width = {};
-  std::optional<int> height = {};
-  bool keep_aspect_ratio = true;
-};
+class CaptureStats;
+class FrameConsumer;
+class KeyframeIndex;
+class PipelinePool;
+class PrerollGuard;
+class Thumbnailer;
 
-class VideoProcessor final
+/** Captures frames with fakesink's handoff signals, every step of the
+    capture is driven by bus messages and idle callbacks on the main
+    context */
+class VideoProcessor final : public CaptureEngine
 {
 public:
-  VideoProcessor(Glib::RefPtr<Glib::MainLoop> mainloop,
+  VideoProcessor(Glib::RefPtr<Glib::MainContext> context,
                  Thumbnailer& thumbnailer);
   ~VideoProcessor();
 
-  void set_accurate(bool accurate);
-  void set_timeout(int timeout);
-  void set_options(const VideoProcessorOptions opts);
-  void open(const std::string& filename);
+  void set_accurate(bool accurate) override;
+  void set_timeout(int timeout) override;
+  void set_options(const VideoProcessorOptions opts) override;
+  void set_keyframe_index(std::shared_ptr<KeyframeIndex const> index) override;
+  void set_stats(std::shared_ptr<CaptureStats> stats) override;
+  void set_pipeline_pool(std::shared_ptr<PipelinePool> pool) override;
+  void open(const std::string& filename) override;
+  void cancel() override;
   void setup_pipeline();
   std::string get_pipeline_desc() const;
 
@@ -60,28 +73,154 @@ public:
                       Glib::RefPtr<Gst::Message> const& message);
   void on_preroll_handoff(Glib::RefPtr<Gst::Buffer> const& buffer,
                           Glib::RefPtr<Gst::Pad> const& pad);
+  void on_handoff(Glib::RefPtr<Gst::Buffer> const& buffer,
+                  Glib::RefPtr<Gst::Pad> const& pad);
   void shutdown();
   void queue_shutdown();
 
   bool on_timeout();
 
+  bool has_error() const override { return !m_error.empty(); }
+  std::string const& get_error() const override { return m_error; }
+  ErrorCode get_error_code() const override { return m_error_code; }
+  std::vector<DegradedCell> const& get_degraded() const override { return m_degraded; }
+  sigc::signal<void>& signal_finished() override { return m_sig_finished; }
+
+private:
+  bool on_idle_seek_step();
+  void arm_seek_deadline();
+  bool on_seek_deadline();
+  void seek_fallback();
+  bool on_idle_shutdown();
+  void on_element_added(GstElement* element);
+  void on_decoder_caps(GstElement* decoder, GstCaps* caps);
+  void on_decoder_buffer(GstBuffer* buffer);
+  void on_sink_event(GstEvent* event);
+
+  Gst::SeekFlags get_seek_flags() const;
+  Gst::SeekFlags get_scan_seek_flags() const;
+  bool can_decode_forward(gint64 target) const;
+  void start_sampling();
+  void start_capture();
+  void announce_frame_size();
+  void start_gop_probe();
+  bool on_idle_gop_probe();
+  bool on_gop_probe_deadline();
+  void finish_gop_probe(gint64 pos);
+  void skip_past_eos();
+  void start_scan();
+  bool on_idle_scan_seek();
+  gint64 get_gop_interval() const;
+  void set_error(ErrorCode code, std::string const& error);
+
+private:
+  /** a position to capture and its index in get_thumbnail_pos() */
+  struct Target
+  {
+    gint64 pos;
+    int index;
+  };
+
 private:
-  Glib::RefPtr<Glib::MainLoop> m_mainloop;
+  Glib::RefPtr<Glib::MainContext> m_context;
   Thumbnailer& m_thumbnailer;
 
+  std::shared_ptr<CaptureStats> m_stats;
+
+  /** when open() was called and when the last seek or step was
+      requested, for m_stats and the trace */
+  std::chrono::steady_clock::time_point m_open_time;
+  std::chrono::steady_clock::time_point m_seek_time;
+
+  /** whether the last request was a step rather than a seek */
+  bool m_stepping;
+
+  /** delivers the captured frames to m_thumbnailer, created once the
+      pipeline has prerolled */
+  std::unique_ptr<FrameConsumer> m_consumer;
+
+  std::shared_ptr<PipelinePool> m_pool;
   Glib::RefPtr<Gst::Pipeline> m_pipeline;
   Glib::RefPtr<Gst::FakeSink> m_fakesink;
 
-  std::vector<gint64> m_thumbnailer_pos;
+  /** everything connected to the pipeline, removed again before it
+      goes back to m_pool */
+  gulong m_element_added_handler;
+  gulong m_sink_probe;
+  std::vector<sigc::connection> m_handoff_connections;
+
+  std::unique_ptr<PrerollGuard> m_preroll_guard;
+
+  std::vector<Target> m_thumbnailer_pos;
+
+  /** the positions to capture, kept until start_capture() */
+  std::vector<gint64> m_positions;
+
+  /** index of the position the last seek or step went to */
+  int m_current_index;
+
+  /** the position the last seek or step went to, the fallback taken
+      for it when the seek missed its deadline and the positions that
+      needed one, see seek_fallback() */
+  Target m_current_target;
+  std::optional<SeekFallback> m_fallback;
+  sigc::connection m_deadline_connection;
+  std::vector<DegradedCell> m_degraded;
+  gint64 m_duration;
+  size_t m_total_positions;
 
   bool m_done;
   bool m_running;
-  guint m_timeout_id;
+  bool m_finished;
+  sigc::connection m_timeout_connection;
   int  m_timeout;
   bool m_accurate;
   guint64 m_last_screenshot;
+  size_t m_expected_frames;
+  int m_frame_count;
+  std::string m_error;
+  ErrorCode m_error_code;
+  sigc::signal<void> m_sig_finished;
 
   VideoProcessorOptions m_opts;
+  std::shared_ptr<KeyframeIndex const> m_keyframe_index;
+
+  /** stream time of the last frame delivered in seek mode, -1 if none */
+  gint64 m_last_pos;
+
+  /** the sampling mode actually in use, m_opts.sampling resolved */
+  SamplingMode m_sampling;
+
+  /** GOP interval observed at the decoder input, -1 if unknown */
+  std::atomic<gint64> m_gop_interval;
+  gint64 m_last_keyframe;
+  gint64 m_gop_sum;
+  gint64 m_gop_count;
+
+  /** the probe seek of start_gop_probe(): the position it started
+      from, whether its frame is still to come, where that frame
+      landed, and whether the probe moved the pipeline away from the
+      preroll frame */
+  gint64 m_gop_probe_from;
+  bool m_gop_probing;
+  gint64 m_gop_probe_pos;
+  bool m_gop_probed;
+
+  /** state of scan and hybrid sampling, shared between the streaming
+      thread and the main context */
+  std::mutex m_scan_mutex;
+  bool m_scanning;
+  std::vector<Target> m_scan_targets;
+  size_t m_scan_next;
+  bool m_scan_seek_pending;
+  bool m_scan_accept_next;
+  GstSegment m_segment;
+
+  /** whether the frame of the current seek or step is still to come,
+      and whether a fallback seek has been sent whose flush is still to
+      come, the frames before that flush belong to the abandoned seek */
+  bool m_seek_waiting;
+  bool m_seek_flushing;
 
 private:
   VideoProcessor(const VideoProcessor&) = delete;
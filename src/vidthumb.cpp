@@ -18,46 +18,130 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <cairomm/cairomm.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <vector>
+#include <fmt/format.h>
 #include <logmich/log.hpp>
 
+#include "capture_engine.hpp"
+#include "capture_stats.hpp"
 #include "fourd_thumbnailer.hpp"
 #include "grid_thumbnailer.hpp"
+#include "image_writer.hpp"
 #include "directory_thumbnailer.hpp"
+#include "keyframe_index.hpp"
+#include "output_template.hpp"
 #include "param_list.hpp"
+#include "pipeline_pool.hpp"
+#include "png_writer.hpp"
+#include "range_thumbnailer.hpp"
+#include "sampling.hpp"
+#include "thumbnail_cache.hpp"
+#include "thumbnail_server.hpp"
 #include "thumbnailer.hpp"
-#include "video_processor.hpp"
+#include "timestamp_renderer.hpp"
+#include "tracer.hpp"
+#include "work_queue.hpp"
 
 class Options
 {
 public:
-  std::string input_filename;
+  enum Mode { kDirectoryThumbnailer, kGridThumbnailer, kFourdThumbnailer };
+
+public:
+  std::vector<std::string> input_filenames;
+  std::string files_from;
   std::string output_filename;
   VideoProcessorOptions vp_opts;
+  CaptureEngineType engine;
+  ImageWriterOptions writer_opts;
+  std::optional<bool> timestamp;
+  std::shared_ptr<TimestampRenderer const> timestamp_renderer;
   int timeout;
   bool accurate;
-  enum { kDirectoryThumbnailer, kGridThumbnailer, kFourdThumbnailer } mode;
+  int jobs;
+  int pipelines;
+  bool keyframe_index;
+  bool cache;
+  std::string cache_dir;
+  std::string cache_size;
+  std::uintmax_t cache_max_size;
+  std::shared_ptr<StatsWriter> stats;
+  std::shared_ptr<PipelinePool> pipeline_pool;
+  std::string trace_filename;
+  std::string serve_socket;
+  Mode mode;
   ParamList params;
+  std::string params_string;
 
 public:
   Options() :
-    input_filename(),
+    input_filenames(),
+    files_from(),
     output_filename(),
     vp_opts(),
+    engine(CaptureEngineType::kHandoff),
+    writer_opts(),
+    timestamp(),
+    timestamp_renderer(),
     timeout(5000),
     accurate(false),
+    jobs(1),
+    pipelines(1),
+    keyframe_index(false),
+    cache(false),
+    cache_dir(),
+    cache_size("normal"),
+    cache_max_size(0),
+    stats(),
+    pipeline_pool(),
+    trace_filename(),
+    serve_socket(),
     mode(kGridThumbnailer),
-    params()
+    params(),
+    params_string()
   {}
 
   void parse_args(int argc, char** argv);
+
+  /** Derives the settings that depend on the mode and parameters,
+      called again for every job of --serve */
+  void resolve();
+
+  static Mode mode_from_string(std::string const& name);
+
+  bool is_batch() const { return input_filenames.size() > 1 || !files_from.empty(); }
+  std::unique_ptr<Thumbnailer> create_thumbnailer() const;
+  std::unique_ptr<ThumbnailCache> create_cache() const;
 };
 
+namespace {
+
+void read_file_list(std::istream& in, std::vector<std::string>& filenames)
+{
+  std::string line;
+  while(std::getline(in, line))
+  {
+    if (!line.empty())
+    {
+      filenames.push_back(line);
+    }
+  }
+}
+
+} // namespace
+
 void
 Options::parse_args(int argc, char** argv)
 {
@@ -69,31 +153,69 @@ Options::parse_args(int argc, char** argv)
       throw std::runtime_error(out.str());                              \
     } else { i += 1; }
 
+    std::optional<int> preroll_timeout;
     for(int i = 1; i < argc; ++i)
     {
       if (strcmp(argv[i], "-h") == 0 ||
           strcmp(argv[i], "--help") == 0)
       {
-        std::cout << "Usage: " << argv[0] << " [OPTIONS] FILENAME" << std::endl;
+        std::cout << "Usage: " << argv[0] << " [OPTIONS] FILENAME..." << std::endl;
         std::cout << std::endl;
         std::cout <<
           "  -v, --verbose          Print verbose messages\n"
           "  -d, --debug            Print debug messages\n"
-          "  -o, --output FILE      Write thumbnail to FILE\n"
+          "  -o, --output FILE      Write thumbnail to FILE, with multiple input files\n"
+          "                         FILE is a template, e.g. '{dir}/{stem}.png'\n"
+          "                         (placeholders: path, dir, name, stem, ext, index)\n"
+          "  -f, --files-from FILE  Read input filenames from FILE, one per line, '-' for stdin\n"
           "  -W, --width INT        Rescale the video to width\n"
           "  -H, --height INT       Rescale the video to height\n"
           "  -A, --ignore-aspect-ratio\n"
           "                         Ignore aspect-ratio\n"
           "  -p, --params PARAMS    Pass additional parameter to the thumbnailer (e.g. cols=5,rows=3)\n"
           "  --fourd                Use fourd thumbnailer\n"
-          "                           parameter: slices=INT\n"
+          "                           parameter: slices=INT,slice_width=INT,onepass=BOOL\n"
           "  --grid                 Use grid thumbnailer (default)\n"
-          "                           parameter: cols=INT,rows=INT\n"
+          "                           parameter: cols=INT,rows=INT,stream=BOOL\n"
           "  --directory            Use directory thumbnailer (default)\n"
           "                           parameter: num=INT\n"
           "  -t, --timeout SECONDS  Wait for SECONDS before giving up, -1 for infinity\n"
-          "  -T, --timestamp        Timestamp the frames\n"
-          "  -a, --accurate         Use accurate, but slow seeking\n";
+          "  --preroll-timeout SECONDS\n"
+          "                         Give up when the first frame takes longer than SECONDS,\n"
+          "                         -1 for no limit (default: 3, at most --timeout)\n"
+          "  --preroll-max-mb MB    Give up when MB have been read without a frame, 0 for\n"
+          "                         no limit (default: 64)\n"
+          "  --seek-deadline SECONDS\n"
+          "                         Retry a seek as key unit seek, then at a neighbouring\n"
+          "                         position, then skip it, each after SECONDS without a\n"
+          "                         frame, -1 to only use --timeout (default: 1)\n"
+          "  -T, --timestamp        Timestamp the frames (default for --grid)\n"
+          "  --no-timestamp         Don't timestamp the frames\n"
+          "  -a, --accurate         Use accurate, but slow seeking\n"
+          "  -k, --keyframes-only   Only decode keyframes, at reduced resolution where possible\n"
+          "  -j, --jobs INT         Thumbnail INT files in parallel, 0 for one per CPU core\n"
+          "  --pipelines INT        Split the positions of a single file over INT pipelines\n"
+          "  --keyframe-index       Snap positions to keyframes from a cached keyframe index\n"
+          "  --format FORMAT        Output format: png, jpeg, webp or qoi (default: from extension)\n"
+          "  --quality INT          JPEG and WebP quality, 0-100 (default: 85)\n"
+          "  --png-level INT        zlib compression level for PNG, 0-9\n"
+          "  --png-filter FILTERS   PNG row filters: none, sub, up, avg, paeth or all\n"
+          "  --fused-convert        Convert and downscale the decoded frames in a single pass\n"
+          "  --sampling MODE        How to reach the positions: seek, scan, hybrid or auto\n"
+          "                         (default: auto, chosen from the GOP interval of\n"
+          "                         --keyframe-index or measured with a probe seek)\n"
+          "  --engine ENGINE        How frames are captured: handoff or appsink (default: handoff)\n"
+          "  -c, --cache            Store thumbnails in the freedesktop.org thumbnail cache\n"
+          "                         and reuse them as long as the file is unchanged\n"
+          "  --cache-dir DIR        Use DIR as cache root instead of ~/.cache/thumbnails/\n"
+          "  --cache-size SIZE      Thumbnail size: normal, large or x-large (default: normal)\n"
+          "  --cache-max-size MB    Evict the oldest thumbnails once the cache exceeds MB\n"
+          "  --stats FILE           Append timings and counters of each file to FILE as\n"
+          "                         JSON lines, '-' for stdout\n"
+          "  --trace FILE           Record a timeline of the run to FILE in Chrome\n"
+          "                         trace-event format, for Perfetto or chrome://tracing\n"
+          "  --serve SOCKET         Run as a daemon, taking JSON job requests on the Unix\n"
+          "                         socket SOCKET, the other options are the job defaults\n";
         exit(0);
       }
       else if (strcmp(argv[i], "-d") == 0 ||
@@ -112,6 +234,12 @@ Options::parse_args(int argc, char** argv)
         NEXT_ARG;
         output_filename = argv[i];
       }
+      else if (strcmp(argv[i], "-f") == 0 ||
+               strcmp(argv[i], "--files-from") == 0)
+      {
+        NEXT_ARG;
+        files_from = argv[i];
+      }
       else if (strcmp(argv[i], "-W") == 0 ||
                strcmp(argv[i], "--width") == 0)
       {
@@ -134,6 +262,8 @@ Options::parse_args(int argc, char** argv)
       {
         NEXT_ARG;
         params.parse_string(argv[i]);
+        params_string += params_string.empty() ? "" : ",";
+        params_string += argv[i];
       }
       else if (strcmp(argv[i], "--fourd") == 0)
       {
@@ -153,100 +283,810 @@ Options::parse_args(int argc, char** argv)
         NEXT_ARG;
         timeout = static_cast<int>(atof(argv[i]) * 1000.0);
       }
+      else if (strcmp(argv[i], "--preroll-timeout") == 0)
+      {
+        NEXT_ARG;
+        double const seconds = atof(argv[i]);
+        preroll_timeout = seconds < 0 ? -1 : static_cast<int>(seconds * 1000.0);
+      }
+      else if (strcmp(argv[i], "--preroll-max-mb") == 0)
+      {
+        NEXT_ARG;
+        vp_opts.preroll_max_bytes = static_cast<guint64>(std::max(0.0, atof(argv[i])) * 1024.0 * 1024.0);
+      }
+      else if (strcmp(argv[i], "--seek-deadline") == 0)
+      {
+        NEXT_ARG;
+        double const seconds = atof(argv[i]);
+        vp_opts.seek_deadline = seconds < 0 ? -1 : static_cast<int>(seconds * 1000.0);
+      }
       else if (strcmp(argv[i], "--accurate") == 0 ||
                strcmp(argv[i], "-a") == 0)
       {
         accurate = true;
       }
+      else if (strcmp(argv[i], "--keyframes-only") == 0 ||
+               strcmp(argv[i], "-k") == 0)
+      {
+        vp_opts.keyframes_only = true;
+      }
+      else if (strcmp(argv[i], "--jobs") == 0 ||
+               strcmp(argv[i], "-j") == 0)
+      {
+        NEXT_ARG;
+        jobs = atoi(argv[i]);
+        if (jobs <= 0)
+        {
+          jobs = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+      }
+      else if (strcmp(argv[i], "--pipelines") == 0)
+      {
+        NEXT_ARG;
+        pipelines = std::max(1, atoi(argv[i]));
+      }
+      else if (strcmp(argv[i], "--keyframe-index") == 0)
+      {
+        keyframe_index = true;
+      }
+      else if (strcmp(argv[i], "--format") == 0)
+      {
+        NEXT_ARG;
+        writer_opts.format = image_format_from_string(argv[i]);
+      }
+      else if (strcmp(argv[i], "--quality") == 0)
+      {
+        NEXT_ARG;
+        writer_opts.quality = std::clamp(atoi(argv[i]), 0, 100);
+      }
+      else if (strcmp(argv[i], "--png-level") == 0)
+      {
+        NEXT_ARG;
+        writer_opts.png_level = std::clamp(atoi(argv[i]), 0, 9);
+      }
+      else if (strcmp(argv[i], "--png-filter") == 0)
+      {
+        NEXT_ARG;
+        writer_opts.png_filters = png_filters_from_string(argv[i]);
+      }
+      else if (strcmp(argv[i], "--fused-convert") == 0)
+      {
+        vp_opts.fused_convert = true;
+      }
+      else if (strcmp(argv[i], "--sampling") == 0)
+      {
+        NEXT_ARG;
+        vp_opts.sampling = sampling_mode_from_string(argv[i]);
+      }
+      else if (strcmp(argv[i], "--engine") == 0)
+      {
+        NEXT_ARG;
+        engine = capture_engine_type_from_string(argv[i]);
+      }
+      else if (strcmp(argv[i], "--cache") == 0 ||
+               strcmp(argv[i], "-c") == 0)
+      {
+        cache = true;
+      }
+      else if (strcmp(argv[i], "--cache-dir") == 0)
+      {
+        NEXT_ARG;
+        cache = true;
+        cache_dir = argv[i];
+      }
+      else if (strcmp(argv[i], "--cache-size") == 0)
+      {
+        NEXT_ARG;
+        cache_size = argv[i];
+      }
+      else if (strcmp(argv[i], "--cache-max-size") == 0)
+      {
+        NEXT_ARG;
+        cache_max_size = static_cast<std::uintmax_t>(atof(argv[i]) * 1024.0 * 1024.0);
+      }
+      else if (strcmp(argv[i], "--stats") == 0)
+      {
+        NEXT_ARG;
+        stats = std::make_shared<StatsWriter>(argv[i]);
+      }
+      else if (strcmp(argv[i], "--serve") == 0)
+      {
+        NEXT_ARG;
+        serve_socket = argv[i];
+      }
+      else if (strcmp(argv[i], "--trace") == 0)
+      {
+        NEXT_ARG;
+        trace_filename = argv[i];
+      }
       else if (strcmp(argv[i], "--timestamp") == 0 ||
                strcmp(argv[i], "-T") == 0)
       {
-        // FIXME: implement me
+        timestamp = true;
+      }
+      else if (strcmp(argv[i], "--no-timestamp") == 0)
+      {
+        timestamp = false;
       }
       else
       {
-        input_filename = argv[i];
+        input_filenames.push_back(argv[i]);
       }
     }
 #undef NEXT_ARG
 
-    if (input_filename.empty())
+    // the preroll budget is meant to fail broken files early, not to
+    // be stricter than the timeout the user asked for
+    if (preroll_timeout)
+    {
+      vp_opts.preroll_timeout = *preroll_timeout;
+    }
+    else if (timeout == -1)
+    {
+      vp_opts.preroll_timeout = -1;
+    }
+    else
+    {
+      vp_opts.preroll_timeout = std::min(vp_opts.preroll_timeout, timeout);
+    }
+
+    if (!files_from.empty())
+    {
+      if (files_from == "-")
+      {
+        read_file_list(std::cin, input_filenames);
+      }
+      else
+      {
+        std::ifstream in(files_from);
+        if (!in)
+        {
+          throw std::runtime_error("failed to open " + files_from);
+        }
+        read_file_list(in, input_filenames);
+      }
+    }
+
+    if (!serve_socket.empty())
+    {
+      if (!input_filenames.empty())
+      {
+        throw std::runtime_error("--serve takes its input files from the requests");
+      }
+
+      if (!trace_filename.empty())
+      {
+        throw std::runtime_error("--trace can't be used with --serve, the trace is written on exit");
+      }
+
+      // the requests name their output files and the mode, resolve()
+      // runs per job, only the glyphs are shared by all of them
+      if (timestamp.value_or(true))
+      {
+        timestamp_renderer = std::make_shared<TimestampRenderer>();
+      }
+      return;
+    }
+
+    if (input_filenames.empty())
     {
       throw std::runtime_error("input filename required");
     }
 
-    if (output_filename.empty())
+    if (cache && mode == kDirectoryThumbnailer)
+    {
+      throw std::runtime_error("--cache can't be used with --directory");
+    }
+
+    // with the cache the output file is optional, the thumbnail
+    // ends up in the cache either way
+    if (output_filename.empty() && !cache)
     {
       throw std::runtime_error("output filename required");
     }
+
+    if (is_batch() && !output_filename.empty() && !is_output_template(output_filename))
+    {
+      throw std::runtime_error("multiple input files require an output template, e.g. '{stem}.png'");
+    }
+
+    resolve();
 }
 
-int main(int argc, char** argv)
+void
+Options::resolve()
+{
+  // fourd wants a frame from nearly every part of the file, which a
+  // single forward pass delivers cheaper than one seek per slice
+  bool onepass = false;
+  if (mode == kFourdThumbnailer && params.get("onepass", &onepass) && onepass &&
+      vp_opts.sampling == SamplingMode::kAuto)
+  {
+    vp_opts.sampling = SamplingMode::kScan;
+  }
+
+  // the glyphs are rasterized once and shared by all thumbnailers
+  if (!timestamp.value_or(mode == kGridThumbnailer))
+  {
+    timestamp_renderer.reset();
+  }
+  else if (!timestamp_renderer)
+  {
+    timestamp_renderer = std::make_shared<TimestampRenderer>();
+  }
+}
+
+Options::Mode
+Options::mode_from_string(std::string const& name)
+{
+  if (name == "grid")
+  {
+    return kGridThumbnailer;
+  }
+  else if (name == "directory")
+  {
+    return kDirectoryThumbnailer;
+  }
+  else if (name == "fourd")
+  {
+    return kFourdThumbnailer;
+  }
+  else
+  {
+    throw std::runtime_error("unknown mode: " + name + ", expected grid, directory or fourd");
+  }
+}
+
+std::unique_ptr<Thumbnailer>
+Options::create_thumbnailer() const
+{
+  switch(mode)
+  {
+    case kGridThumbnailer: {
+      int cols = 4;
+      int rows = 4;
+      bool stream = false;
+      params.get("cols", &cols);
+      params.get("rows", &rows);
+      params.get("stream", &stream);
+      return std::make_unique<GridThumbnailer>(cols, rows, stream, timestamp_renderer);
+    }
+
+    case kDirectoryThumbnailer: {
+      int num = 16;
+      params.get("num", &num);
+      return std::make_unique<DirectoryThumbnailer>(num, timestamp_renderer);
+    }
+
+    case kFourdThumbnailer: {
+      int slices = 100;
+      int slice_width = 0;
+      params.get("slices", &slices);
+      params.get("slice_width", &slice_width);
+      return std::make_unique<FourdThumbnailer>(slices, slice_width, timestamp_renderer);
+    }
+
+    default:
+      assert(!"never reached");
+      return {};
+  }
+}
+
+std::unique_ptr<ThumbnailCache>
+Options::create_cache() const
 {
+  if (!cache)
+  {
+    return {};
+  }
+
+  // everything that changes the look of the thumbnail
+  std::ostringstream options;
+  options << "mode=" << (mode == kFourdThumbnailer ? "fourd" : "grid")
+          << ";params=" << params_string
+          << ";width=" << vp_opts.width.value_or(-1)
+          << ";height=" << vp_opts.height.value_or(-1)
+          << ";aspect=" << vp_opts.keep_aspect_ratio
+          << ";accurate=" << accurate
+          << ";keyframes-only=" << vp_opts.keyframes_only
+          << ";sampling=" << to_string(vp_opts.sampling)
+          << ";fused-convert=" << vp_opts.fused_convert
+          << ";timestamp=" << (timestamp_renderer != nullptr);
+
+  return std::make_unique<ThumbnailCache>(cache_dir.empty() ? ThumbnailCache::get_default_root() : cache_dir,
+                                          ThumbnailCache::flavor_from_string(cache_size),
+                                          options.str());
+}
+
+namespace {
+
+/** Copies the cached thumbnail of \a input_filename to \a output_filename,
+    re-encoding it when the output isn't PNG */
+void install_cached_thumbnail(ThumbnailCache const& cache, ImageWriter const& writer,
+                              std::string const& input_filename, std::string const& output_filename)
+{
+  if (output_filename.empty())
+  {
+    return;
+  }
+
+  std::string const thumbnail_filename = cache.get_thumbnail_filename(input_filename);
+  if (writer.get_format(output_filename) == ImageFormat::kPNG)
+  {
+    std::filesystem::copy_file(thumbnail_filename, output_filename,
+                               std::filesystem::copy_options::overwrite_existing);
+  }
+  else
+  {
+    writer.write(Cairo::ImageSurface::create_from_png(thumbnail_filename), output_filename);
+  }
+}
+
+/** Thumbnails a single file, returns the error on failure, \a stats
+    may be nullptr, so may \a cancel, which stops the capture once set */
+CaptureError process_file(Options const& opts, ThumbnailCache const* cache,
+                          std::shared_ptr<CaptureStats> const& stats,
+                          std::atomic<bool> const* cancel,
+                          Glib::RefPtr<Glib::MainLoop> const& mainloop,
+                          std::string const& input_filename, std::string const& output_filename)
+{
+  log_info("input:  {}", input_filename);
+  log_info("output: {}", output_filename);
+
+  TraceSpan span("process_file");
+  span.set_arg("file", input_filename);
+
   try
   {
-    Options opts;
-    opts.parse_args(argc, argv);
+    std::unique_ptr<Thumbnailer> thumbnailer = opts.create_thumbnailer();
 
-    log_info("input:  {}", opts.input_filename);
-    log_info("output: {}", opts.output_filename);
+    ImageWriter const writer(opts.writer_opts);
+    // streaming the sheet to disk leaves no image behind for the cache
+    if (!cache)
+    {
+      thumbnailer->prepare(output_filename, writer);
+    }
 
-    std::unique_ptr<Thumbnailer> thumbnailer;
-    switch(opts.mode)
+    std::shared_ptr<KeyframeIndex const> keyframe_index;
+    if (opts.keyframe_index)
     {
-      case Options::kGridThumbnailer: {
-        int cols = 4;
-        int rows = 4;
-        opts.params.get("cols", &cols);
-        opts.params.get("rows", &rows);
-        thumbnailer.reset(new GridThumbnailer(cols, rows));
-        break;
+      keyframe_index = std::make_shared<KeyframeIndex>(KeyframeIndex::load_or_build(input_filename, opts.timeout));
+    }
+
+    // each pipeline captures a contiguous range of the positions, the
+    // decoding happens in the pipelines' streaming threads, so a single
+    // main loop is enough to drive all of them
+    FrameMerger merger(*thumbnailer, opts.pipelines);
+    std::vector<std::unique_ptr<RangeThumbnailer>> ranges;
+    std::vector<std::unique_ptr<CaptureEngine>> processors;
+    int running = opts.pipelines;
+    for(int range = 0; range < opts.pipelines; ++range)
+    {
+      ranges.push_back(std::make_unique<RangeThumbnailer>(merger, range));
+      processors.push_back(create_capture_engine(opts.engine, mainloop->get_context(), *ranges.back()));
+
+      CaptureEngine& processor = *processors.back();
+      processor.set_options(opts.vp_opts);
+      processor.set_timeout(opts.timeout);
+      processor.set_accurate(opts.accurate);
+      processor.set_keyframe_index(keyframe_index);
+      processor.set_stats(stats);
+      processor.set_pipeline_pool(opts.pipeline_pool);
+      processor.signal_finished().connect([&merger, &running, &mainloop, range]{
+        merger.finish_range(range);
+        running -= 1;
+        if (running == 0)
+        {
+          mainloop->quit();
+        }
+      });
+    }
+
+    for(auto& processor : processors)
+    {
+      processor->open(input_filename);
+    }
+
+    // the flag is set from another thread, the engines want to be
+    // cancelled from the main context
+    sigc::connection cancel_connection;
+    if (cancel)
+    {
+      cancel_connection = mainloop->get_context()->signal_timeout().connect([cancel, &processors]{
+        if (!*cancel)
+        {
+          return true;
+        }
+
+        for(auto& processor : processors)
+        {
+          processor->cancel();
+        }
+        return false;
+      }, 50);
+    }
+
+    mainloop->run();
+    cancel_connection.disconnect();
+
+    if (cancel && *cancel)
+    {
+      return { ErrorCode::kCancelled, "cancelled" };
+    }
+
+    // positions that only got a fallback frame or a placeholder, the
+    // engines count them relative to their range
+    std::string degraded;
+    for(int range = 0; range < opts.pipelines; ++range)
+    {
+      for(DegradedCell const& cell : processors[static_cast<size_t>(range)]->get_degraded())
+      {
+        int const index = merger.get_index(range, cell.index);
+        degraded += fmt::format("{}{} ({})", degraded.empty() ? "" : ", ", index, to_string(cell.fallback));
+        if (stats)
+        {
+          stats->add_degraded(index, to_string(cell.fallback));
+        }
       }
+    }
+
+    if (!degraded.empty())
+    {
+      log_warn("{}: degraded positions: {}", input_filename, degraded);
+    }
 
-      case Options::kDirectoryThumbnailer: {
-        int num = 16;
-        opts.params.get("num", &num);
-        thumbnailer.reset(new DirectoryThumbnailer(num));
+    CaptureError error;
+    for(auto const& processor : processors)
+    {
+      if (processor->has_error())
+      {
+        error = { processor->get_error_code(), processor->get_error() };
         break;
       }
+    }
 
-      case Options::kFourdThumbnailer: {
-        int slices = 100;
-        opts.params.get("slices", &slices);
-        thumbnailer.reset(new FourdThumbnailer(slices));
-        break;
+    auto const save_start = CaptureStats::Clock::now();
+    TraceSpan save_span("save");
+    // the output gets the full size image, partial or not, the cache
+    // only a downscaled copy of it
+    if (!output_filename.empty())
+    {
+      thumbnailer->save(output_filename, writer);
+    }
+
+    // partial thumbnails are never cached, a later run might do better
+    if (cache && !error.failed())
+    {
+      Cairo::RefPtr<Cairo::ImageSurface> img = thumbnailer->get_image();
+      if (!img)
+      {
+        return { ErrorCode::kFailed, "no image produced" };
       }
+      cache->store(input_filename, img);
+    }
 
-      default:
-        assert(!"never reached");
-        break;
+    if (stats)
+    {
+      stats->add_save(CaptureStats::Clock::now() - save_start);
     }
 
-    Gst::init(argc, argv);
+    return error;
+  }
+  catch(const std::exception& err)
+  {
+    return { ErrorCode::kFailed, err.what() };
+  }
+  catch(const Glib::Error& err)
+  {
+    return { error_code_from_gerror(err.domain(), err.code()), err.what().raw() };
+  }
+}
 
-    Glib::RefPtr<Glib::MainLoop> mainloop = Glib::MainLoop::create(false);
+/** Enforces --cache-max-size after a --serve job stored a thumbnail.
+    Eviction reads every thumbnail in the directory, so it runs at most
+    once a minute, whichever worker gets there first does it. */
+void evict_after_store(Options const& opts, ThumbnailCache const& cache)
+{
+  static std::mutex mutex;
+  static std::optional<std::chrono::steady_clock::time_point> last_eviction;
+
+  auto const now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (last_eviction && now - *last_eviction < std::chrono::minutes(1))
     {
-      VideoProcessor processor(mainloop, *thumbnailer);
-      processor.set_options(opts.vp_opts);
-      processor.set_timeout(opts.timeout);
-      processor.set_accurate(opts.accurate);
-      processor.open(opts.input_filename);
-      mainloop->run();
-      thumbnailer->save(opts.output_filename);
+      return;
     }
+    last_eviction = now;
+  }
+
+  cache.evict(opts.cache_max_size);
+}
+
+/** Runs a --serve request, \a base holds the defaults given on the
+    command line, the request overrides them */
+CaptureError serve_job(Options const& base, ThumbnailJob const& job,
+                       std::atomic<bool> const& cancel,
+                       Glib::RefPtr<Glib::MainLoop> const& mainloop)
+{
+  Options opts = base;
+  if (!job.mode.empty())
+  {
+    opts.mode = Options::mode_from_string(job.mode);
+  }
+
+  if (!job.params.empty())
+  {
+    opts.params.parse_string(job.params);
+    opts.params_string += opts.params_string.empty() ? "" : ",";
+    opts.params_string += job.params;
+  }
+
+  if (job.width)
+  {
+    opts.vp_opts.width = *job.width;
+  }
+
+  if (job.height)
+  {
+    opts.vp_opts.height = *job.height;
+  }
+
+  opts.resolve();
 
-    Gst::deinit();
+  if (opts.cache && opts.mode == Options::kDirectoryThumbnailer)
+  {
+    return { ErrorCode::kFailed, "--cache can't be used with --directory" };
+  }
+
+  if (job.output.empty() && !opts.cache)
+  {
+    return { ErrorCode::kFailed, "output filename required" };
+  }
+
+  // the cache key depends on the mode and parameters of the job
+  std::unique_ptr<ThumbnailCache> const cache = opts.create_cache();
+  if (cache && cache->lookup(job.input))
+  {
+    log_info("cache hit: {}", job.input);
+    install_cached_thumbnail(*cache, ImageWriter(opts.writer_opts), job.input, job.output);
+    return {};
+  }
+
+  std::shared_ptr<CaptureStats> const stats = opts.stats ? std::make_shared<CaptureStats>() : nullptr;
+  if (stats && opts.jobs == 1)
+  {
+    stats->reset_peak_rss();
+  }
+  CaptureError const error = process_file(opts, cache.get(), stats, &cancel, mainloop, job.input, job.output);
+  if (stats)
+  {
+    opts.stats->write(*stats, job.input, error);
+  }
+
+  if (cache && opts.cache_max_size && !error.failed())
+  {
+    evict_after_store(opts, *cache);
+  }
+  return error;
+}
+
+struct BatchItem
+{
+  std::string input_filename;
+  std::string output_filename;
+};
+
+class BatchRunner
+{
+private:
+  Options const& m_opts;
+  ThumbnailCache const* m_cache;
+  WorkQueue<BatchItem> m_queue;
+  std::mutex m_report_mutex;
+  int m_failures;
+  ErrorCode m_first_error;
+
+public:
+  BatchRunner(Options const& opts, ThumbnailCache const* cache, std::vector<BatchItem> items) :
+    m_opts(opts),
+    m_cache(cache),
+    m_queue(opts.jobs),
+    m_report_mutex(),
+    m_failures(0),
+    m_first_error(ErrorCode::kNone)
+  {
+    m_queue.push_all(std::move(items));
+  }
+
+  int get_failures() const { return m_failures; }
+
+  /** The category of the first failure reported, kNone if there were
+      none */
+  ErrorCode get_first_error() const { return m_first_error; }
+
+  /** Processes all items, returns the number of failed ones */
+  int run()
+  {
+    if (m_queue.get_num_workers() == 1)
+    {
+      run_worker(0);
+    }
+    else
+    {
+      std::vector<std::thread> threads;
+      for(int worker = 0; worker < m_queue.get_num_workers(); ++worker)
+      {
+        threads.emplace_back(&BatchRunner::run_worker, this, worker);
+      }
+
+      for(auto& thread : threads)
+      {
+        thread.join();
+      }
+    }
+
+    return m_failures;
+  }
+
+private:
+  void run_worker(int worker)
+  {
+    Tracer::set_thread_name(fmt::format("worker {}", worker));
+
+    // every worker drives its pipelines from its own main context, the
+    // pipeline bus watches attach to the thread-default context
+    Glib::RefPtr<Glib::MainContext> context = Glib::MainContext::create();
+    g_main_context_push_thread_default(context->gobj());
+
+    Glib::RefPtr<Glib::MainLoop> mainloop = Glib::MainLoop::create(context, false);
+    while(std::optional<BatchItem> item = m_queue.pop(worker))
+    {
+      std::shared_ptr<CaptureStats> const stats = m_opts.stats ? std::make_shared<CaptureStats>() : nullptr;
+      if (stats && m_opts.jobs == 1)
+      {
+        stats->reset_peak_rss();
+      }
+      CaptureError const error = process_file(m_opts, m_cache, stats, nullptr, mainloop,
+                                              item->input_filename, item->output_filename);
+      if (stats)
+      {
+        m_opts.stats->write(*stats, item->input_filename, error);
+      }
+      report(*item, error);
+    }
+
+    g_main_context_pop_thread_default(context->gobj());
+  }
+
+public:
+  void report(BatchItem const& item, CaptureError const& error)
+  {
+    std::lock_guard<std::mutex> lock(m_report_mutex);
+    if (!error.failed())
+    {
+      if (m_opts.is_batch())
+      {
+        // stdout is left to --stats -
+        std::cerr << "ok: " << item.input_filename << " -> " << item.output_filename << std::endl;
+      }
+    }
+    else
+    {
+      m_failures += 1;
+      if (m_first_error == ErrorCode::kNone)
+      {
+        m_first_error = error.code;
+      }
+      std::cerr << "failed: " << item.input_filename << ": "
+                << to_string(error.code) << ": " << error.message << std::endl;
+    }
+  }
+
+private:
+  BatchRunner(const BatchRunner&) = delete;
+  BatchRunner& operator=(const BatchRunner&) = delete;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  ErrorCode first_error = ErrorCode::kNone;
+
+  try
+  {
+    Options opts;
+    opts.parse_args(argc, argv);
+
+    if (!opts.serve_socket.empty())
+    {
+      // GStreamer and its plugin registry are loaded once for all
+      // requests, the pipelines are kept around between them
+      Gst::init(argc, argv);
+      opts.pipeline_pool = std::make_shared<PipelinePool>(opts.jobs * opts.pipelines);
+      ThumbnailServer server(opts.serve_socket, opts.jobs,
+                             [&opts](ThumbnailJob const& job, std::atomic<bool> const& cancel,
+                                     Glib::RefPtr<Glib::MainLoop> const& mainloop) {
+                               return serve_job(opts, job, cancel, mainloop);
+                             });
+      server.run();
+      return EXIT_SUCCESS;
+    }
+
+    if (!opts.trace_filename.empty())
+    {
+      Tracer::start(opts.trace_filename);
+    }
+
+    std::unique_ptr<ThumbnailCache> cache = opts.create_cache();
+
+    std::vector<BatchItem> items;
+    std::vector<BatchItem> cached_items;
+    for(size_t i = 0; i < opts.input_filenames.size(); ++i)
+    {
+      std::string const& input_filename = opts.input_filenames[i];
+      BatchItem item{input_filename,
+                     expand_output_template(opts.output_filename, input_filename, static_cast<int>(i))};
+
+      if (cache && cache->lookup(input_filename))
+      {
+        log_info("cache hit: {}", input_filename);
+        cached_items.push_back(std::move(item));
+      }
+      else
+      {
+        items.push_back(std::move(item));
+      }
+    }
+
+    bool const need_gstreamer = !items.empty();
+    BatchRunner runner(opts, cache.get(), std::move(items));
+    for(auto const& item : cached_items)
+    {
+      CaptureError error;
+      try
+      {
+        install_cached_thumbnail(*cache, ImageWriter(opts.writer_opts), item.input_filename, item.output_filename);
+      }
+      catch(std::exception const& err)
+      {
+        error = { ErrorCode::kFailed, err.what() };
+      }
+      runner.report(item, error);
+    }
+
+    // cache hits don't need GStreamer at all
+    if (need_gstreamer)
+    {
+      Gst::init(argc, argv);
+      opts.pipeline_pool = std::make_shared<PipelinePool>(opts.jobs * opts.pipelines);
+      runner.run();
+      opts.pipeline_pool.reset();
+      Gst::deinit();
+    }
+    Tracer::stop();
+    first_error = runner.get_first_error();
+
+    if (cache && opts.cache_max_size)
+    {
+      cache->evict(opts.cache_max_size);
+    }
   }
   catch(const std::exception& err)
   {
     std::cerr << "error: " << err.what() << std::endl;
+    return EXIT_FAILURE;
   }
   catch(...)
   {
     std::cerr << "error: unknown exception: " << std::endl;
+    return EXIT_FAILURE;
   }
 
-  return 0;
+  // the exit status tells why the first failed file failed, the
+  // others are in the output
+  return static_cast<int>(first_error);
 }
 
 /* EOF */
@@ -0,0 +1,77 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "webp_writer.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#ifdef HAVE_WEBP
+#  include <webp/encode.h>
+#endif
+
+#include "image_writer.hpp"
+
+void
+write_webp(Cairo::RefPtr<Cairo::ImageSurface> const& img,
+           const std::string& filename,
+           int quality)
+{
+#ifdef HAVE_WEBP
+  if (img->get_format() != Cairo::FORMAT_RGB24 &&
+      img->get_format() != Cairo::FORMAT_ARGB32)
+  {
+    throw std::runtime_error("write_webp: unsupported surface format");
+  }
+
+  img->flush();
+
+  int const width = img->get_width();
+  int const height = img->get_height();
+
+  // the x byte of RGB24 is undefined, so it can't go in as alpha
+  std::vector<uint8_t> rgb(static_cast<size_t>(width) * static_cast<size_t>(height) * 3);
+  for(int y = 0; y < height; ++y)
+  {
+    convert_row_to_rgb(img->get_data() + y * img->get_stride(),
+                       rgb.data() + static_cast<size_t>(y) * static_cast<size_t>(width) * 3,
+                       width);
+  }
+
+  uint8_t* output = nullptr;
+  size_t const size = (quality >= 100) ?
+    WebPEncodeLosslessRGB(rgb.data(), width, height, width * 3, &output) :
+    WebPEncodeRGB(rgb.data(), width, height, width * 3, static_cast<float>(quality), &output);
+  if (size == 0)
+  {
+    WebPFree(output);
+    throw std::runtime_error("failed to encode " + filename);
+  }
+
+  std::vector<uint8_t> data(output, output + size);
+  WebPFree(output);
+
+  write_file(filename, data);
+#else
+  (void)img;
+  (void)quality;
+  throw std::runtime_error("can't write " + filename + ": built without WebP support");
+#endif
+}
+
+/* EOF */
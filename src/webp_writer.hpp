@@ -0,0 +1,33 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_WEBP_WRITER_HPP
+#define HEADER_WEBP_WRITER_HPP
+
+#include <cairomm/cairomm.h>
+#include <string>
+
+/** Writes \a img as lossy WebP, or lossless for a \a quality of 100.
+    Throws when vidthumb was built without libwebp. */
+void write_webp(Cairo::RefPtr<Cairo::ImageSurface> const& img,
+                const std::string& filename,
+                int quality);
+
+#endif
+
+/* EOF */
@@ -0,0 +1,102 @@
+/*
+**  VidThumb - Video Thumbnailer
+**  Copyright (C) 2026 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_WORK_QUEUE_HPP
+#define HEADER_WORK_QUEUE_HPP
+
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/** A set of per-worker queues, each worker takes work from the front
+    of its own queue and steals from the back of the other workers'
+    queues once its own queue runs dry. Items are distributed
+    round-robin up front, so a single slow item only delays the items
+    that nobody else got around to stealing. */
+template<typename T>
+class WorkQueue
+{
+private:
+  struct Lane
+  {
+    std::mutex mutex;
+    std::deque<T> items;
+  };
+
+private:
+  std::vector<Lane> m_lanes;
+
+public:
+  WorkQueue(int num_workers) :
+    m_lanes(static_cast<size_t>(num_workers))
+  {}
+
+  int get_num_workers() const { return static_cast<int>(m_lanes.size()); }
+
+  /** Distributes \a items round-robin over the workers' queues */
+  void push_all(std::vector<T> items)
+  {
+    for(size_t i = 0; i < items.size(); ++i)
+    {
+      Lane& lane = m_lanes[i % m_lanes.size()];
+      std::lock_guard<std::mutex> lock(lane.mutex);
+      lane.items.push_back(std::move(items[i]));
+    }
+  }
+
+  /** Returns the next item for \a worker or nothing when all queues
+      are empty */
+  std::optional<T> pop(int worker)
+  {
+    { // own queue first
+      Lane& lane = m_lanes[static_cast<size_t>(worker)];
+      std::lock_guard<std::mutex> lock(lane.mutex);
+      if (!lane.items.empty())
+      {
+        T item = std::move(lane.items.front());
+        lane.items.pop_front();
+        return item;
+      }
+    }
+
+    // steal from the back of the other queues, starting with the
+    // neighbour to spread the contention
+    for(size_t i = 1; i < m_lanes.size(); ++i)
+    {
+      Lane& lane = m_lanes[(static_cast<size_t>(worker) + i) % m_lanes.size()];
+      std::lock_guard<std::mutex> lock(lane.mutex);
+      if (!lane.items.empty())
+      {
+        T item = std::move(lane.items.back());
+        lane.items.pop_back();
+        return item;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+private:
+  WorkQueue(const WorkQueue&) = delete;
+  WorkQueue& operator=(const WorkQueue&) = delete;
+};
+
+#endif
+
+/* EOF */
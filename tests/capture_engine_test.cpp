@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "capture_engine.hpp"
+
+TEST(CaptureEngineTest, next_seek_fallback)
+{
+  EXPECT_EQ(get_next_seek_fallback(std::nullopt), SeekFallback::kKeyUnit);
+  EXPECT_EQ(get_next_seek_fallback(SeekFallback::kKeyUnit), SeekFallback::kNeighbour);
+  EXPECT_EQ(get_next_seek_fallback(SeekFallback::kNeighbour), SeekFallback::kSkipped);
+  EXPECT_EQ(get_next_seek_fallback(SeekFallback::kSkipped), SeekFallback::kSkipped);
+}
+
+TEST(CaptureEngineTest, neighbour_pos_stays_in_cell)
+{
+  gint64 const duration = 16 * GST_SECOND;
+  int const n = 16;
+  gint64 const spacing = duration / n;
+
+  for(int i = 0; i < n; ++i)
+  {
+    gint64 const pos = spacing / 2 + spacing * i;
+    gint64 const neighbour = get_neighbour_pos(pos, duration, n);
+    EXPECT_NE(neighbour, pos) << i;
+    EXPECT_EQ(neighbour, pos - spacing / 4) << i;
+    EXPECT_GE(neighbour, spacing * i) << i;
+  }
+}
+
+TEST(CaptureEngineTest, neighbour_pos_bounds)
+{
+  gint64 const duration = 10 * GST_SECOND;
+
+  // nothing before the start, look after it instead
+  EXPECT_EQ(get_neighbour_pos(0, duration, 4), duration / 4 / 4);
+
+  // a single position covers the whole file
+  EXPECT_EQ(get_neighbour_pos(duration / 2, duration, 1), duration / 2 - duration / 4);
+
+  // no positions at all doesn't divide by zero
+  EXPECT_EQ(get_neighbour_pos(duration / 2, duration, 0), duration / 2 - duration / 4);
+}
+
+TEST(CaptureEngineTest, gop_probe)
+{
+  VideoProcessorOptions opts;
+  opts.seek_deadline = 250;
+  EXPECT_EQ(get_gop_probe_deadline(opts), 250);
+
+  // the probe still needs a deadline when seeks have none
+  opts.seek_deadline = -1;
+  EXPECT_GT(get_gop_probe_deadline(opts), 0);
+
+  Gst::SeekFlags const flags = get_gop_probe_seek_flags(opts);
+  EXPECT_TRUE((flags & Gst::SEEK_FLAG_KEY_UNIT) == Gst::SEEK_FLAG_KEY_UNIT);
+  EXPECT_TRUE((flags & Gst::SEEK_FLAG_SNAP_AFTER) == Gst::SEEK_FLAG_SNAP_AFTER);
+  EXPECT_FALSE((flags & Gst::SEEK_FLAG_ACCURATE) == Gst::SEEK_FLAG_ACCURATE);
+}
+
+/* EOF */
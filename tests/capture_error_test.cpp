@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "capture_error.hpp"
+
+TEST(CaptureErrorTest, to_string)
+{
+  EXPECT_EQ(std::string(to_string(ErrorCode::kNone)), "none");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kFailed)), "failed");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kUnreadable)), "unreadable");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kMissingPlugin)), "missing-plugin");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kNoVideo)), "no-video");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kCorrupt)), "corrupt");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kPrerollBudget)), "preroll-budget");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kTimeout)), "timeout");
+  EXPECT_EQ(std::string(to_string(ErrorCode::kCancelled)), "cancelled");
+}
+
+TEST(CaptureErrorTest, exit_status)
+{
+  // the values are documented as exit status, they must not move
+  EXPECT_EQ(static_cast<int>(ErrorCode::kNone), 0);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kFailed), 1);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kUnreadable), 2);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kMissingPlugin), 3);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kNoVideo), 4);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kCorrupt), 5);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kPrerollBudget), 6);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kTimeout), 7);
+  EXPECT_EQ(static_cast<int>(ErrorCode::kCancelled), 8);
+}
+
+TEST(CaptureErrorTest, error_code_from_gerror)
+{
+  EXPECT_EQ(error_code_from_gerror(GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN), ErrorCode::kMissingPlugin);
+  EXPECT_EQ(error_code_from_gerror(GST_CORE_ERROR, GST_CORE_ERROR_FAILED), ErrorCode::kFailed);
+
+  EXPECT_EQ(error_code_from_gerror(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NOT_FOUND), ErrorCode::kUnreadable);
+  EXPECT_EQ(error_code_from_gerror(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_OPEN_READ), ErrorCode::kUnreadable);
+  EXPECT_EQ(error_code_from_gerror(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ), ErrorCode::kUnreadable);
+  EXPECT_EQ(error_code_from_gerror(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NOT_AUTHORIZED), ErrorCode::kUnreadable);
+  EXPECT_EQ(error_code_from_gerror(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NO_SPACE_LEFT), ErrorCode::kFailed);
+
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_CODEC_NOT_FOUND), ErrorCode::kMissingPlugin);
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_TYPE_NOT_FOUND), ErrorCode::kCorrupt);
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_WRONG_TYPE), ErrorCode::kCorrupt);
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_DECODE), ErrorCode::kCorrupt);
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_DEMUX), ErrorCode::kCorrupt);
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_FORMAT), ErrorCode::kCorrupt);
+  EXPECT_EQ(error_code_from_gerror(GST_STREAM_ERROR, GST_STREAM_ERROR_FAILED), ErrorCode::kFailed);
+
+  EXPECT_EQ(error_code_from_gerror(G_FILE_ERROR, G_FILE_ERROR_NOENT), ErrorCode::kUnreadable);
+  EXPECT_EQ(error_code_from_gerror(g_quark_from_static_string("unknown-error-quark"), 1), ErrorCode::kFailed);
+
+  // errors posted by vidthumb itself carry the ErrorCode as code
+  EXPECT_EQ(error_code_from_gerror(vidthumb_error_quark(), static_cast<int>(ErrorCode::kPrerollBudget)),
+            ErrorCode::kPrerollBudget);
+  EXPECT_EQ(error_code_from_gerror(vidthumb_error_quark(), static_cast<int>(ErrorCode::kNoVideo)),
+            ErrorCode::kNoVideo);
+}
+
+/* EOF */
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "json.hpp"
+
+TEST(JsonTest, quote)
+{
+  EXPECT_EQ(json_quote("plain"), "\"plain\"");
+  EXPECT_EQ(json_quote("a\"b\\c"), "\"a\\\"b\\\\c\"");
+  EXPECT_EQ(json_quote("line\nbreak\t\x01"), "\"line\\nbreak\\t\\u0001\"");
+  EXPECT_EQ(json_quote("\xc3\xa9"), "\"\xc3\xa9\"");
+}
+
+TEST(JsonTest, parse_object)
+{
+  JsonValue const value = JsonValue::parse(
+    " {\"input\": \"/tmp/a.mkv\", \"width\": 320, \"scale\": -1.5e2,"
+    "  \"stream\": true, \"cache\": false, \"extra\": null,"
+    "  \"list\": [1, [2], {}], \"nested\": {\"key\": \"value\"}} ");
+
+  ASSERT_TRUE(value.is_object());
+  EXPECT_EQ(value.as_object().size(), 8u);
+  EXPECT_EQ(value.get("input")->as_string(), "/tmp/a.mkv");
+  EXPECT_EQ(value.get("width")->as_number(), 320.0);
+  EXPECT_EQ(value.get("scale")->as_number(), -150.0);
+  EXPECT_TRUE(value.get("stream")->as_bool());
+  EXPECT_FALSE(value.get("cache")->as_bool());
+  EXPECT_TRUE(value.get("extra")->is_null());
+  EXPECT_EQ(value.get("list")->as_array().size(), 3u);
+  EXPECT_TRUE(value.get("list")->as_array()[2].is_object());
+  EXPECT_EQ(value.get("nested")->get("key")->as_string(), "value");
+  EXPECT_EQ(value.get("missing"), nullptr);
+  EXPECT_EQ(value.get("input")->get("input"), nullptr);
+}
+
+TEST(JsonTest, parse_string_escapes)
+{
+  EXPECT_EQ(JsonValue::parse("\"a\\\"b\\\\c\\/d\\n\"").as_string(), "a\"b\\c/d\n");
+  EXPECT_EQ(JsonValue::parse("\"\\u00e9\"").as_string(), "\xc3\xa9");
+  EXPECT_EQ(JsonValue::parse("\"\\u20AC\"").as_string(), "\xe2\x82\xac");
+  EXPECT_EQ(JsonValue::parse("\"\\ud83d\\ude00\"").as_string(), "\xf0\x9f\x98\x80");
+
+  // what json_quote() produces parses back to the original
+  std::string const text = "tab\there \"quoted\" \\ \x02 \xc3\xa9";
+  EXPECT_EQ(JsonValue::parse(json_quote(text)).as_string(), text);
+}
+
+TEST(JsonTest, parse_errors)
+{
+  char const* const invalid[] = {
+    "", "{", "{\"a\"}", "{\"a\":1,}", "[1,]", "[1 2]", "tru", "nul",
+    "01x", "-", ".5", "\"unterminated", "\"bad \\x escape\"", "\"\\ud83d\"",
+    "{\"a\":1} trailing", "\"raw\ncontrol\"", "{1:2}"
+  };
+  for(char const* text : invalid)
+  {
+    EXPECT_THROW(JsonValue::parse(text), std::runtime_error) << text;
+  }
+
+  std::string deep(1000, '[');
+  EXPECT_THROW(JsonValue::parse(deep), std::runtime_error);
+}
+
+TEST(JsonTest, type_mismatch)
+{
+  JsonValue const value = JsonValue::parse("{\"n\": 1}");
+  EXPECT_THROW(value.as_string(), std::runtime_error);
+  EXPECT_THROW(value.get("n")->as_string(), std::runtime_error);
+  EXPECT_THROW(value.get("n")->as_bool(), std::runtime_error);
+}
+
+/* EOF */
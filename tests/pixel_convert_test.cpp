@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "pixel_convert.hpp"
+
+namespace {
+
+struct TestImage
+{
+  PixelFormat format;
+  int width;
+  int height;
+  std::vector<std::vector<uint8_t>> planes;
+  std::vector<int> strides;
+
+  SourceImage get_source() const
+  {
+    SourceImage src;
+    src.format = format;
+    src.width = width;
+    src.height = height;
+    for(size_t i = 0; i < planes.size(); ++i)
+    {
+      src.planes[i] = planes[i].data();
+      src.strides[i] = strides[i];
+    }
+    return src;
+  }
+};
+
+/** Random samples, with strides padded past the row size like a
+    decoder would */
+TestImage make_random_image(PixelFormat format, int width, int height, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  TestImage img{ format, width, height, {}, {} };
+  int const cw = (width + 1) / 2;
+  int const ch = (height + 1) / 2;
+
+  auto add_plane = [&](int row_bytes, int rows) {
+    int const stride = row_bytes + 24;
+    std::vector<uint8_t> data(static_cast<size_t>(stride * rows));
+    for(auto& v : data)
+    {
+      v = static_cast<uint8_t>(dist(rng));
+    }
+    img.planes.push_back(std::move(data));
+    img.strides.push_back(stride);
+  };
+
+  switch(format)
+  {
+    case PixelFormat::kI420:
+      add_plane(width, height);
+      add_plane(cw, ch);
+      add_plane(cw, ch);
+      break;
+
+    case PixelFormat::kNV12:
+      add_plane(width, height);
+      add_plane(cw * 2, ch);
+      break;
+
+    case PixelFormat::kP010:
+      add_plane(width * 2, height);
+      add_plane(cw * 4, ch);
+      break;
+
+    case PixelFormat::kBGRx:
+      add_plane(width * 4, height);
+      break;
+  }
+
+  return img;
+}
+
+std::vector<uint8_t> convert(SourceImage const& src, int width, int height, SimdLevel simd)
+{
+  std::vector<uint8_t> out(static_cast<size_t>(width * height * 4));
+  TargetImage dst;
+  dst.data = out.data();
+  dst.width = width;
+  dst.height = height;
+  dst.stride = width * 4;
+  convert_downscale(src, dst, simd);
+  return out;
+}
+
+} // namespace
+
+TEST(PixelConvertTest, simd_matches_scalar)
+{
+  struct Case { int src_w; int src_h; int dst_w; int dst_h; };
+  std::vector<Case> const cases = {
+    { 64, 48, 16, 12 },
+    { 333, 187, 47, 29 },
+    { 1920, 1080, 320, 180 },
+    { 17, 9, 40, 20 },  // upscaling
+    { 7, 5, 7, 5 },
+  };
+
+  for(PixelFormat format : { PixelFormat::kI420, PixelFormat::kNV12, PixelFormat::kP010, PixelFormat::kBGRx })
+  {
+    for(Case const& c : cases)
+    {
+      TestImage const img = make_random_image(format, c.src_w, c.src_h, 1234);
+      std::vector<uint8_t> const expected = convert(img.get_source(), c.dst_w, c.dst_h, SimdLevel::kScalar);
+
+      for(SimdLevel simd : { SimdLevel::kSSE2, SimdLevel::kAVX2 })
+      {
+        if (simd > get_simd_level())
+        {
+          continue;
+        }
+
+        EXPECT_EQ(expected, convert(img.get_source(), c.dst_w, c.dst_h, simd))
+          << "format " << static_cast<int>(format) << ", simd " << static_cast<int>(simd)
+          << ", " << c.src_w << "x" << c.src_h << " -> " << c.dst_w << "x" << c.dst_h;
+      }
+    }
+  }
+}
+
+TEST(PixelConvertTest, area_average)
+{
+  // 2x2 BGRx blocks average into single pixels, rounding to nearest
+  std::vector<uint8_t> pixels = {
+    10, 20, 30, 0,   12, 22, 32, 0,   100, 0, 0, 0,   101, 0, 0, 0,
+    14, 24, 34, 0,   16, 26, 36, 0,   100, 0, 0, 0,   101, 0, 0, 0,
+  };
+
+  SourceImage src;
+  src.format = PixelFormat::kBGRx;
+  src.width = 4;
+  src.height = 2;
+  src.planes[0] = pixels.data();
+  src.strides[0] = 16;
+
+  std::vector<uint8_t> const expected = {
+    13, 23, 33, 255,   101, 0, 0, 255,
+  };
+  EXPECT_EQ(expected, convert(src, 2, 1, SimdLevel::kScalar));
+  EXPECT_EQ(expected, convert(src, 2, 1, get_simd_level()));
+}
+
+TEST(PixelConvertTest, yuv_gray)
+{
+  // limited range mid-gray maps onto full range mid-gray
+  std::vector<uint8_t> luma(16 * 8, 126);
+  std::vector<uint8_t> chroma(8 * 4 * 2, 128);
+
+  SourceImage src;
+  src.format = PixelFormat::kNV12;
+  src.width = 16;
+  src.height = 8;
+  src.planes[0] = luma.data();
+  src.strides[0] = 16;
+  src.planes[1] = chroma.data();
+  src.strides[1] = 16;
+
+  std::vector<uint8_t> const out = convert(src, 4, 2, get_simd_level());
+  for(size_t i = 0; i < out.size(); i += 4)
+  {
+    EXPECT_EQ(128, out[i + 0]);
+    EXPECT_EQ(128, out[i + 1]);
+    EXPECT_EQ(128, out[i + 2]);
+    EXPECT_EQ(255, out[i + 3]);
+  }
+}
+
+/* EOF */
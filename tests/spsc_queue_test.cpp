@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.hpp"
+
+TEST(SPSCQueueTest, try_push_pop)
+{
+  SPSCQueue<int> queue(2);
+  int value = 1;
+  EXPECT_TRUE(queue.try_push(value));
+  value = 2;
+  EXPECT_TRUE(queue.try_push(value));
+  value = 3;
+  EXPECT_FALSE(queue.try_push(value));
+  EXPECT_EQ(value, 3);
+
+  int out = 0;
+  EXPECT_TRUE(queue.try_pop(out));
+  EXPECT_EQ(out, 1);
+  EXPECT_TRUE(queue.try_push(value));
+  EXPECT_TRUE(queue.try_pop(out));
+  EXPECT_EQ(out, 2);
+  EXPECT_TRUE(queue.try_pop(out));
+  EXPECT_EQ(out, 3);
+  EXPECT_FALSE(queue.try_pop(out));
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SPSCQueueTest, releases_popped_values)
+{
+  auto ptr = std::make_shared<int>(5);
+  SPSCQueue<std::shared_ptr<int>> queue(4);
+  EXPECT_TRUE(queue.push(ptr));
+  EXPECT_EQ(ptr.use_count(), 2);
+
+  std::shared_ptr<int> out;
+  EXPECT_TRUE(queue.pop(out));
+  out.reset();
+  EXPECT_EQ(ptr.use_count(), 1);
+}
+
+TEST(SPSCQueueTest, order_and_back_pressure)
+{
+  SPSCQueue<int> queue(3);
+  int const count = 100000;
+
+  std::thread producer([&queue]{
+    for(int i = 0; i < count; ++i)
+    {
+      queue.push(i);
+    }
+    queue.close();
+  });
+
+  std::vector<int> received;
+  int value;
+  while(queue.pop(value))
+  {
+    received.push_back(value);
+  }
+  producer.join();
+
+  ASSERT_EQ(received.size(), static_cast<size_t>(count));
+  for(int i = 0; i < count; ++i)
+  {
+    ASSERT_EQ(received[static_cast<size_t>(i)], i);
+  }
+}
+
+TEST(SPSCQueueTest, close_drains_and_rejects)
+{
+  SPSCQueue<int> queue(2);
+  EXPECT_TRUE(queue.push(1));
+  queue.close();
+  EXPECT_FALSE(queue.push(2));
+
+  int out = 0;
+  EXPECT_TRUE(queue.pop(out));
+  EXPECT_EQ(out, 1);
+  EXPECT_FALSE(queue.pop(out));
+}
+
+/* EOF */